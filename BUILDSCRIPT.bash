@@ -34,7 +34,7 @@ CXXARCH="${CXXARCH:--march=native}"
 CXXSTD="${CXXSTD:--std=c++2b}"
 CXXFLAGSEXTRA="${CXXFLAGSEXTRA:-}"
 LDFLAGS="${LDFLAGS:--Wall -Wextra -Wl,--as-needed -Wl,-z,now -O3 -flto=auto -s}"
-LDLIBS="${LDLIBS:-$PKG_CONFIG___LIBS_DBUS__ -lcrypto -lsqlite3}"
+LDLIBS="${LDLIBS:-$PKG_CONFIG___LIBS_DBUS__ -lcrypto -lsqlite3 -pthread}"
 BIN="${BIN:-signalbackup-tools}"
 
 # CONFIG: brew
@@ -81,7 +81,7 @@ fi
 # CONFIG: without_dbus
 if [ "$CONFIG" = "without_dbus" ] ; then
   CXXFLAGS="-Wall -Wextra -Woverloaded-virtual -Wshadow -pedantic -DWITHOUT_DBUS -O3 -flto"
-  LDLIBS="-lcrypto -lsqlite3"
+  LDLIBS="-lcrypto -lsqlite3 -pthread"
 fi
 
 SRC=("keyvalueframe/statics.cc"
@@ -89,7 +89,6 @@ SRC=("keyvalueframe/statics.cc"
      "signalbackup/tgbuildbody.cc"
      "signalbackup/checkdbintegrity.cc"
      "signalbackup/mergegroups.cc"
-     "signalbackup/writeencryptedframe.cc"
      "signalbackup/scanself.cc"
      "signalbackup/applyranges.cc"
      "signalbackup/prepareoutputdirectory.cc"
@@ -127,6 +126,7 @@ SRC=("keyvalueframe/statics.cc"
      "signalbackup/unescapexmlstring.cc"
      "signalbackup/getrecipientidfrom.cc"
      "signalbackup/compactids.cc"
+     "signalbackup/remapids.cc"
      "signalbackup/importfromdesktop.cc"
      "signalbackup/htmlwritecalllog.cc"
      "signalbackup/exporttxt.cc"
@@ -178,6 +178,9 @@ SRC=("keyvalueframe/statics.cc"
      "signalbackup/getthreadidfromrecipient.cc"
      "signalbackup/cleanattachments.cc"
      "signalbackup/exporthtml.cc"
+     "signalbackup/exporthtmlthread.cc"
+     "signalbackup/setthreadattachments.cc"
+     "signalbackup/createmessagecountstable.cc"
      "signalbackup/buildsqlstatementframe.cc"
      "signalbackup/htmlescapeurl.cc"
      "signalbackup/gettranslatedname.cc"
@@ -232,6 +235,9 @@ SRC=("keyvalueframe/statics.cc"
      "sqlcipherdecryptor/gethmackey.cc"
      "sqlcipherdecryptor/sqlcipherdecryptor.cc"
      "sqlcipherdecryptor/decryptdata.cc"
+     "sqlcipherdecryptor/decryptpage.cc"
+     "sqlcipherdecryptor/page.cc"
+     "sqlcipherdecryptor/readwal.cc"
      "framewithattachment/setattachmentdata.cc"
      "sharedprefframe/statics.cc"
      "avatarframe/statics.cc"
@@ -241,6 +247,7 @@ SRC=("keyvalueframe/statics.cc"
      "backupframe/init.cc"
      "desktopattachmentreader/getencryptedattachment.cc"
      "memfiledb/statics.cc"
+     "sqlcipherfiledb/statics.cc"
      "sqlitedb/valueasstring.cc"
      "sqlitedb/prettyprint.cc"
      "sqlitedb/renamecolumn.cc"
@@ -266,6 +273,7 @@ SRC=("keyvalueframe/statics.cc"
      "desktopdatabase/getsecrets_linux_kwallet.cc"
      "desktopdatabase/getkeyfromencrypted_mac_linux.cc"
      "reactionlist/setauthor.cc"
+     "bytetrie/bytetrie.cc"
      "jsondatabase/jsondatabase.cc"
      "attachmentmetadata/getattachmentmetadata.cc"
      "fileencryptor/init.cc"
@@ -277,17 +285,27 @@ SRC=("keyvalueframe/statics.cc"
      "filedecryptor/filedecryptor.cc"
      "filedecryptor/customs.cc"
      "filedecryptor/initbackupframe.cc"
+     "filedecryptor/getframethreaded.cc"
+     "filedecryptor/startthreads.cc"
+     "filedecryptor/scanframes.cc"
+     "filedecryptor/processframes.cc"
      "arg/usage.cc"
      "arg/arg.cc"
      "cryptbase/getbackupkey.cc"
-     "cryptbase/getcipherandmac.cc")
+     "cryptbase/getcipherandmac.cc"
+     "mappedfile/mappedfile.cc"
+     "backupfilewriter/backupfilewriter.cc"
+     "backupfilewriter/writeframe.cc"
+     "backupfilewriter/encryptframes.cc"
+     "backupfilewriter/writefinishedframes.cc"
+     "backupfilewriter/writejob.cc"
+     "backupfilewriter/writejobdirect.cc")
 
 OBJ=("keyvalueframe/o/statics.o"
      "signalbackup/o/tgmapcontacts.o"
      "signalbackup/o/tgbuildbody.o"
      "signalbackup/o/checkdbintegrity.o"
      "signalbackup/o/mergegroups.o"
-     "signalbackup/o/writeencryptedframe.o"
      "signalbackup/o/scanself.o"
      "signalbackup/o/applyranges.o"
      "signalbackup/o/prepareoutputdirectory.o"
@@ -325,6 +343,7 @@ OBJ=("keyvalueframe/o/statics.o"
      "signalbackup/o/unescapexmlstring.o"
      "signalbackup/o/getrecipientidfrom.o"
      "signalbackup/o/compactids.o"
+     "signalbackup/o/remapids.o"
      "signalbackup/o/importfromdesktop.o"
      "signalbackup/o/htmlwritecalllog.o"
      "signalbackup/o/exporttxt.o"
@@ -376,6 +395,9 @@ OBJ=("keyvalueframe/o/statics.o"
      "signalbackup/o/getthreadidfromrecipient.o"
      "signalbackup/o/cleanattachments.o"
      "signalbackup/o/exporthtml.o"
+     "signalbackup/o/exporthtmlthread.o"
+     "signalbackup/o/setthreadattachments.o"
+     "signalbackup/o/createmessagecountstable.o"
      "signalbackup/o/buildsqlstatementframe.o"
      "signalbackup/o/htmlescapeurl.o"
      "signalbackup/o/gettranslatedname.o"
@@ -430,6 +452,9 @@ OBJ=("keyvalueframe/o/statics.o"
      "sqlcipherdecryptor/o/gethmackey.o"
      "sqlcipherdecryptor/o/sqlcipherdecryptor.o"
      "sqlcipherdecryptor/o/decryptdata.o"
+     "sqlcipherdecryptor/o/decryptpage.o"
+     "sqlcipherdecryptor/o/page.o"
+     "sqlcipherdecryptor/o/readwal.o"
      "framewithattachment/o/setattachmentdata.o"
      "sharedprefframe/o/statics.o"
      "avatarframe/o/statics.o"
@@ -439,6 +464,7 @@ OBJ=("keyvalueframe/o/statics.o"
      "backupframe/o/init.o"
      "desktopattachmentreader/o/getencryptedattachment.o"
      "memfiledb/o/statics.o"
+     "sqlcipherfiledb/o/statics.o"
      "sqlitedb/o/valueasstring.o"
      "sqlitedb/o/prettyprint.o"
      "sqlitedb/o/renamecolumn.o"
@@ -464,6 +490,7 @@ OBJ=("keyvalueframe/o/statics.o"
      "desktopdatabase/o/getsecrets_linux_kwallet.o"
      "desktopdatabase/o/getkeyfromencrypted_mac_linux.o"
      "reactionlist/o/setauthor.o"
+     "bytetrie/o/bytetrie.o"
      "jsondatabase/o/jsondatabase.o"
      "attachmentmetadata/o/getattachmentmetadata.o"
      "fileencryptor/o/init.o"
@@ -475,10 +502,21 @@ OBJ=("keyvalueframe/o/statics.o"
      "filedecryptor/o/filedecryptor.o"
      "filedecryptor/o/customs.o"
      "filedecryptor/o/initbackupframe.o"
+     "filedecryptor/o/getframethreaded.o"
+     "filedecryptor/o/startthreads.o"
+     "filedecryptor/o/scanframes.o"
+     "filedecryptor/o/processframes.o"
      "arg/o/usage.o"
      "arg/o/arg.o"
      "cryptbase/o/getbackupkey.o"
-     "cryptbase/o/getcipherandmac.o")
+     "cryptbase/o/getcipherandmac.o"
+     "mappedfile/o/mappedfile.o"
+     "backupfilewriter/o/backupfilewriter.o"
+     "backupfilewriter/o/writeframe.o"
+     "backupfilewriter/o/encryptframes.o"
+     "backupfilewriter/o/writefinishedframes.o"
+     "backupfilewriter/o/writejob.o"
+     "backupfilewriter/o/writejobdirect.o")
 
 num_jobs=${#SRC[@]}
 
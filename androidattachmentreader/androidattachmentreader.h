@@ -29,6 +29,8 @@
 #include "../baseattachmentreader/baseattachmentreader.h"
 #include "../framewithattachment/framewithattachment.h"
 #include "../cryptbase/cryptbase.h"
+#include "../cryptcontext/cryptcontext.h"
+#include "../mappedfile/mappedfile.h"
 
 class AndroidAttachmentReader : public AttachmentReader<AndroidAttachmentReader>
 {
@@ -36,37 +38,35 @@ class AndroidAttachmentReader : public AttachmentReader<AndroidAttachmentReader>
   uint64_t d_filepos;
   uint32_t d_iv_size;
   unsigned char *d_iv;
-  uint64_t d_mackey_size;
-  unsigned char *d_mackey;
-  uint64_t d_cipherkey_size;
-  unsigned char *d_cipherkey;
+  CryptContext d_cryptcontext;
   std::string d_filename;
+  std::shared_ptr<MappedFile> d_mappedfile; // if set, data is read from here, not from d_filename
  public:
-  inline AndroidAttachmentReader(unsigned char const *iv, uint32_t iv_size,
-                                 unsigned char const *mackey, uint64_t mackey_size,
-                                 unsigned char const *cipherkey, uint64_t cipherkey_size,
-                                 uint32_t attsize, std::string const &filename, uint64_t filepos);
+  inline AndroidAttachmentReader(unsigned char const *iv, uint32_t iv_size, CryptContext const &cryptcontext,
+                                 uint32_t attsize, std::string const &filename,
+                                 std::shared_ptr<MappedFile> const &mappedfile, uint64_t filepos);
   inline AndroidAttachmentReader(AndroidAttachmentReader const &other);
   inline AndroidAttachmentReader(AndroidAttachmentReader &&other);
   inline AndroidAttachmentReader &operator=(AndroidAttachmentReader const &other);
   inline AndroidAttachmentReader &operator=(AndroidAttachmentReader &&other);
   inline virtual ~AndroidAttachmentReader() override;
   inline virtual int getAttachment(FrameWithAttachment *frame,  bool verbose) override;
+  inline virtual bool canStream() const override;
+  inline virtual int streamAttachment(Sink const &sink, bool verbose) override;
+  inline virtual int checkMac(bool verbose) override;
+ private:
+  inline int decryptAttachment(unsigned char *out, Sink const *sink, bool verbose) const;
 };
 
-inline AndroidAttachmentReader::AndroidAttachmentReader(unsigned char const *iv, uint32_t iv_size,
-                                                        unsigned char const *mackey, uint64_t mackey_size,
-                                                        unsigned char const *cipherkey, uint64_t cipherkey_size,
-                                                        uint32_t attsize, std::string const &filename, uint64_t filepos)
+inline AndroidAttachmentReader::AndroidAttachmentReader(unsigned char const *iv, uint32_t iv_size, CryptContext const &cryptcontext,
+                                                        uint32_t attsize, std::string const &filename,
+                                                        std::shared_ptr<MappedFile> const &mappedfile, uint64_t filepos)
   :
   d_attachmentdata_size(0),
   d_filepos(0),
   d_iv_size(0),
   d_iv(nullptr),
-  d_mackey_size(0),
-  d_mackey(nullptr),
-  d_cipherkey_size(0),
-  d_cipherkey(nullptr)
+  d_cryptcontext(cryptcontext)
 {
   d_iv_size = iv_size;
   if (iv)
@@ -75,23 +75,10 @@ inline AndroidAttachmentReader::AndroidAttachmentReader(unsigned char const *iv,
     std::memcpy(d_iv, iv, d_iv_size);
   }
 
-  d_cipherkey_size = cipherkey_size;
-  if (cipherkey)
-  {
-    d_cipherkey = new unsigned char[d_cipherkey_size];
-    std::memcpy(d_cipherkey, cipherkey, d_cipherkey_size);
-  }
-
-  d_mackey_size = mackey_size;
-  if (mackey)
-  {
-    d_mackey = new unsigned char[d_mackey_size];
-    std::memcpy(d_mackey, mackey, d_mackey_size);
-  }
-
   d_attachmentdata_size = attsize;
 
   d_filename = filename;
+  d_mappedfile = mappedfile;
   d_filepos = filepos;
 }
 
@@ -102,29 +89,15 @@ inline AndroidAttachmentReader::AndroidAttachmentReader(AndroidAttachmentReader
   d_filepos(other.d_filepos),
   d_iv_size(other.d_iv_size),
   d_iv(nullptr),
-  d_mackey_size(other.d_mackey_size),
-  d_mackey(nullptr),
-  d_cipherkey_size(other.d_cipherkey_size),
-  d_cipherkey(nullptr),
-  d_filename(other.d_filename)
+  d_cryptcontext(other.d_cryptcontext),
+  d_filename(other.d_filename),
+  d_mappedfile(other.d_mappedfile)
 {
   if (other.d_iv)
   {
     d_iv = new unsigned char[d_iv_size];
     std::memcpy(d_iv, other.d_iv, d_iv_size);
   }
-
-  if (other.d_mackey)
-  {
-    d_mackey = new unsigned char[d_mackey_size];
-    std::memcpy(d_mackey, other.d_mackey, d_mackey_size);
-  }
-
-  if (other.d_cipherkey)
-  {
-    d_cipherkey = new unsigned char[d_cipherkey_size];
-    std::memcpy(d_cipherkey, other.d_cipherkey, d_cipherkey_size);
-  }
 }
 
 inline AndroidAttachmentReader::AndroidAttachmentReader(AndroidAttachmentReader &&other)
@@ -134,19 +107,13 @@ inline AndroidAttachmentReader::AndroidAttachmentReader(AndroidAttachmentReader
   d_filepos(std::move(other.d_filepos)),
   d_iv_size(std::move(other.d_iv_size)),
   d_iv(std::move(other.d_iv)),
-  d_mackey_size(std::move(other.d_mackey_size)),
-  d_mackey(std::move(other.d_mackey)),
-  d_cipherkey_size(std::move(other.d_cipherkey_size)),
-  d_cipherkey(std::move(other.d_cipherkey)),
-  d_filename(std::move(other.d_filename))
+  d_cryptcontext(std::move(other.d_cryptcontext)),
+  d_filename(std::move(other.d_filename)),
+  d_mappedfile(std::move(other.d_mappedfile))
 {
   other.d_attachmentdata_size = 0;
   other.d_iv_size = 0;
   other.d_iv = nullptr;
-  other.d_mackey_size = 0;
-  other.d_mackey = nullptr;
-  other.d_cipherkey_size = 0;
-  other.d_cipherkey = nullptr;
 }
 
 inline AndroidAttachmentReader &AndroidAttachmentReader::operator=(AndroidAttachmentReader const &other)
@@ -154,12 +121,8 @@ inline AndroidAttachmentReader &AndroidAttachmentReader::operator=(AndroidAttach
   if (this != &other)
   {
     bepaald::destroyPtr(&d_iv, &d_iv_size);
-    bepaald::destroyPtr(&d_mackey, &d_mackey_size);
-    bepaald::destroyPtr(&d_cipherkey, &d_cipherkey_size);
 
     d_iv_size = other.d_iv_size;
-    d_mackey_size = other.d_mackey_size;
-    d_cipherkey_size = other.d_cipherkey_size;
 
     if (other.d_iv)
     {
@@ -167,19 +130,9 @@ inline AndroidAttachmentReader &AndroidAttachmentReader::operator=(AndroidAttach
       std::memcpy(d_iv, other.d_iv, d_iv_size);
     }
 
-    if (other.d_mackey)
-    {
-      d_mackey = new unsigned char[d_mackey_size];
-      std::memcpy(d_mackey, other.d_mackey, d_mackey_size);
-    }
-
-    if (other.d_cipherkey)
-    {
-      d_cipherkey = new unsigned char[d_cipherkey_size];
-      std::memcpy(d_cipherkey, other.d_cipherkey, d_cipherkey_size);
-    }
-
+    d_cryptcontext = other.d_cryptcontext;
     d_filename = other.d_filename;
+    d_mappedfile = other.d_mappedfile;
     d_filepos = other.d_filepos;
     d_attachmentdata_size = other.d_attachmentdata_size;
   }
@@ -192,27 +145,19 @@ inline AndroidAttachmentReader &AndroidAttachmentReader::operator=(AndroidAttach
   {
     // destroy any data this already owns
     bepaald::destroyPtr(&d_iv, &d_iv_size);
-    bepaald::destroyPtr(&d_mackey, &d_mackey_size);
-    bepaald::destroyPtr(&d_cipherkey, &d_cipherkey_size);
 
     // take over other's data
     d_iv = std::move(other.d_iv);
     d_iv_size = std::move(other.d_iv_size);
-    d_mackey = std::move(other.d_mackey);
-    d_mackey_size = std::move(other.d_mackey_size);
-    d_cipherkey = std::move(other.d_cipherkey);
-    d_cipherkey_size = std::move(other.d_cipherkey_size);
+    d_cryptcontext = std::move(other.d_cryptcontext);
     d_filename = std::move(other.d_filename);
+    d_mappedfile = std::move(other.d_mappedfile);
     d_filepos = std::move(other.d_filepos);
     d_attachmentdata_size = std::move(other.d_attachmentdata_size);
 
     // invalidate other
     other.d_iv = nullptr;
     other.d_iv_size = 0;
-    other.d_mackey = nullptr;
-    other.d_mackey_size = 0;
-    other.d_cipherkey = nullptr;
-    other.d_cipherkey_size = 0;
   }
   return *this;
 }
@@ -220,19 +165,63 @@ inline AndroidAttachmentReader &AndroidAttachmentReader::operator=(AndroidAttach
 inline AndroidAttachmentReader::~AndroidAttachmentReader()
 {
   bepaald::destroyPtr(&d_iv, &d_iv_size);
-  bepaald::destroyPtr(&d_mackey, &d_mackey_size);
-  bepaald::destroyPtr(&d_cipherkey, &d_cipherkey_size);
 }
 
 inline int AndroidAttachmentReader::getAttachment(FrameWithAttachment *frame, bool verbose) // virtual
 {
   //std::cout << " *** REALLY GETTING ATTACHMENT (ANDROID) ***" << std::endl;
 
-  std::ifstream file(d_filename, std::ios_base::binary | std::ios_base::in);
-  if (!file.is_open())
-  {
-    Logger::error("Failed to open backup file '", d_filename, "' for reading attachment");
+  std::unique_ptr<unsigned char[]> decryptedattachmentdata(new unsigned char[d_attachmentdata_size]); // to hold the data
+  int result = decryptAttachment(decryptedattachmentdata.get(), nullptr, verbose);
+  if (result == 1) [[unlikely]]
     return 1;
+
+  if (frame->setAttachmentDataBacked(decryptedattachmentdata.release(), d_attachmentdata_size))
+    return result; // 0, or -1 on bad mac
+  return 1;
+}
+
+inline bool AndroidAttachmentReader::canStream() const // virtual
+{
+  return true;
+}
+
+inline int AndroidAttachmentReader::streamAttachment(Sink const &sink, bool verbose) // virtual
+{
+  return decryptAttachment(nullptr, &sink, verbose);
+}
+
+inline int AndroidAttachmentReader::checkMac(bool verbose) // virtual
+{
+  return decryptAttachment(nullptr, nullptr, verbose);
+}
+
+/*
+  Decrypts the attachment data in chunks, either straight into 'out'
+  (which must be large enough to hold all data), or into a small buffer
+  which is passed to 'sink' after every chunk. If neither is given, the
+  data is not decrypted at all, only the MAC is checked.
+  returns 0 on success, 1 on error, -1 on bad mac
+*/
+inline int AndroidAttachmentReader::decryptAttachment(unsigned char *out, Sink const *sink, bool verbose) const
+{
+  std::ifstream file;
+  if (d_mappedfile) [[likely]]
+  {
+    if (d_filepos + d_attachmentdata_size + CryptBase::MACSIZE > d_mappedfile->size()) [[unlikely]]
+    {
+      Logger::error("STOPPING BEFORE END OF ATTACHMENT!!! (EOF) ");
+      return 1;
+    }
+  }
+  else
+  {
+    file.open(d_filename, std::ios_base::binary | std::ios_base::in);
+    if (!file.is_open())
+    {
+      Logger::error("Failed to open backup file '", d_filename, "' for reading attachment");
+      return 1;
+    }
   }
 
   if (d_attachmentdata_size == 0) [[unlikely]]
@@ -242,46 +231,34 @@ inline int AndroidAttachmentReader::getAttachment(FrameWithAttachment *frame, bo
     Logger::message("Decrypting attachment data, length: ", d_attachmentdata_size);
 
   //std::cout << "Getting attachment: " << frame->filepos() << " + " << frame->length() << std::endl;
-  file.seekg(d_filepos, std::ios_base::beg);
-
-  // to decrypt the data
-  // create context
-  std::unique_ptr<EVP_CIPHER_CTX, decltype(&::EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), &::EVP_CIPHER_CTX_free);
+  if (d_mappedfile) [[likely]]
+    d_mappedfile->prefetch(d_filepos, d_attachmentdata_size + CryptBase::MACSIZE); // let the os read ahead while we decrypt
+  else
+    file.seekg(d_filepos, std::ios_base::beg);
 
-  // disable padding
-  EVP_CIPHER_CTX_set_padding(ctx.get(), 0);
+  // get contexts (copied from the already keyed ones, so this reader can be used from any thread,
+  // and the readers do not keep any working contexts around after reading)
+  CryptContext cryptcontext(d_cryptcontext);
 
-  // init
-  if (EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_ctr(), nullptr, d_cipherkey, d_iv) != 1)
+  // to decrypt the data
+  EVP_CIPHER_CTX *ctx = cryptcontext.cipher(d_iv);
+  if (!ctx)
   {
     Logger::error("CTX INIT FAILED");
     return 1;
   }
 
   // to calculate the MAC
-#if OPENSSL_VERSION_NUMBER >= 0x30000000L
-  std::unique_ptr<EVP_MAC, decltype(&::EVP_MAC_free)> mac(EVP_MAC_fetch(nullptr, "hmac", nullptr), &::EVP_MAC_free);
-  std::unique_ptr<EVP_MAC_CTX, decltype(&::EVP_MAC_CTX_free)> hctx(EVP_MAC_CTX_new(mac.get()), &::EVP_MAC_CTX_free);
-  char digest[] = "SHA256";
-  OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string("digest", digest, 0), OSSL_PARAM_construct_end()};
-#else
-  std::unique_ptr<HMAC_CTX, decltype(&::HMAC_CTX_free)> hctx(HMAC_CTX_new(), &::HMAC_CTX_free);
-#endif
-
-
-#if OPENSSL_VERSION_NUMBER >= 0x30000000L
-  if (EVP_MAC_init(hctx.get(), d_mackey, d_mackey_size, params) != 1)
-#else
-  if (HMAC_Init_ex(hctx.get(), d_mackey, d_mackey_size, EVP_sha256(), nullptr) != 1)
-#endif
+  CryptContext::HmacCtx *hctx = cryptcontext.hmac();
+  if (!hctx)
   {
     Logger::error("Failed to initialize HMAC context");
     return 1;
   }
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L
-  if (EVP_MAC_update(hctx.get(), d_iv, d_iv_size) != 1)
+  if (EVP_MAC_update(hctx, d_iv, d_iv_size) != 1)
 #else
-  if (HMAC_Update(hctx.get(), d_iv, d_iv_size) != 1)
+  if (HMAC_Update(hctx, d_iv, d_iv_size) != 1)
 #endif
   {
     Logger::error("Failed to update HMAC");
@@ -291,37 +268,55 @@ inline int AndroidAttachmentReader::getAttachment(FrameWithAttachment *frame, bo
   // read and process attachment data in 8MB chunks
   uint32_t const BUFFERSIZE = 8 * 1024;
   unsigned char encrypteddatabuffer[BUFFERSIZE];
+  unsigned char decrypteddatabuffer[BUFFERSIZE]; // only used when streaming
   uint32_t processed = 0;
   uint32_t size = d_attachmentdata_size;
-  std::unique_ptr<unsigned char[]> decryptedattachmentdata(new unsigned char[size]); // to hold the data
   while (processed < size)
   {
-    if (!file.read(reinterpret_cast<char *>(encrypteddatabuffer), std::min(size - processed, BUFFERSIZE)))
+    // from mapped file, data is used in place (range was checked above)
+    unsigned char const *encrypteddata = encrypteddatabuffer;
+    uint32_t read = std::min(size - processed, BUFFERSIZE);
+    if (d_mappedfile) [[likely]]
+      encrypteddata = d_mappedfile->data() + d_filepos + processed;
+    else
     {
-      Logger::error("STOPPING BEFORE END OF ATTACHMENT!!!", (file.eof() ? " (EOF) " : ""));
-      return 1;
+      if (!file.read(reinterpret_cast<char *>(encrypteddatabuffer), read))
+      {
+        Logger::error("STOPPING BEFORE END OF ATTACHMENT!!!", (file.eof() ? " (EOF) " : ""));
+        return 1;
+      }
+      read = file.gcount();
     }
-    uint32_t read = file.gcount();
 
     // update MAC with read data
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L
-    if (EVP_MAC_update(hctx.get(), encrypteddatabuffer, read) != 1)
+    if (EVP_MAC_update(hctx, encrypteddata, read) != 1)
 #else
-    if (HMAC_Update(hctx.get(), encrypteddatabuffer, read) != 1)
+    if (HMAC_Update(hctx, encrypteddata, read) != 1)
 #endif
     {
       Logger::error("Failed to update HMAC");
       return 1;
     }
 
+    if (!out && !sink) // only checking mac
+    {
+      processed += read;
+      continue;
+    }
+
     // decrypt the read data;
-    int spaceleft = size - processed;
-    if (EVP_DecryptUpdate(ctx.get(), decryptedattachmentdata.get() + processed, &spaceleft, encrypteddatabuffer, read) != 1)
+    unsigned char *decrypteddata = out ? out + processed : decrypteddatabuffer;
+    int spaceleft = out ? size - processed : BUFFERSIZE;
+    if (EVP_DecryptUpdate(ctx, decrypteddata, &spaceleft, encrypteddata, read) != 1)
     {
       Logger::error("Failed to decrypt data");
       return 1;
     }
 
+    if (sink && !(*sink)(decrypteddata, read)) [[unlikely]]
+      return 1;
+
     processed += read;
     //return;
   }
@@ -330,11 +325,11 @@ inline int AndroidAttachmentReader::getAttachment(FrameWithAttachment *frame, bo
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L
   unsigned long int digest_size = SHA256_DIGEST_LENGTH;
   unsigned char hash[SHA256_DIGEST_LENGTH];
-  if (EVP_MAC_final(hctx.get(), hash, nullptr, digest_size) != 1)
+  if (EVP_MAC_final(hctx, hash, nullptr, digest_size) != 1)
 #else
   unsigned int digest_size = SHA256_DIGEST_LENGTH;
   unsigned char hash[SHA256_DIGEST_LENGTH];
-  if (HMAC_Final(hctx.get(), hash, &digest_size) != 1)
+  if (HMAC_Final(hctx, hash, &digest_size) != 1)
 #endif
   {
     Logger::error("Failed to finalize MAC");
@@ -342,7 +337,9 @@ inline int AndroidAttachmentReader::getAttachment(FrameWithAttachment *frame, bo
   }
 
   unsigned char theirMac[CryptBase::MACSIZE];
-  if (!file.read(reinterpret_cast<char *>(theirMac), CryptBase::MACSIZE))
+  if (d_mappedfile) [[likely]]
+    std::memcpy(theirMac, d_mappedfile->data() + d_filepos + size, CryptBase::MACSIZE);
+  else if (!file.read(reinterpret_cast<char *>(theirMac), CryptBase::MACSIZE))
   {
     Logger::error("STOPPING BEFORE END OF ATTACHMENT!!! 2 ");
     return 1;
@@ -350,24 +347,13 @@ inline int AndroidAttachmentReader::getAttachment(FrameWithAttachment *frame, bo
   DEBUGOUT("theirMac         : ", bepaald::bytesToHexString(theirMac, CryptBase::MACSIZE));
   DEBUGOUT("ourMac           : ", bepaald::bytesToHexString(hash, SHA256_DIGEST_LENGTH));
 
-  bool badmac = false;
-
   if (std::memcmp(theirMac, hash, CryptBase::MACSIZE) != 0)
   {
     Logger::warning("Bad MAC in attachmentdata: theirMac: ", bepaald::bytesToHexString(theirMac, CryptBase::MACSIZE));
     Logger::warning_indent("                             ourMac: ", bepaald::bytesToHexString(hash, SHA256_DIGEST_LENGTH));
-    badmac = true;
-  }
-  else
-    badmac = false;
-
-  if (frame->setAttachmentDataBacked(decryptedattachmentdata.release(), d_attachmentdata_size))
-  {
-    if (badmac)
-      return -1;
-    return 0;
+    return -1;
   }
-  return 1;
+  return 0;
 }
 
 #endif
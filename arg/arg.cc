@@ -146,6 +146,7 @@ Arg::Arg(int argc, char *argv[])
   d_listxmlcontacts(std::string()),
   d_selectxmlchats(std::vector<std::string>()),
   d_linkify(false),
+  d_jobs(1),
   d_input_required(false)
 {
   // vector to hold arguments
@@ -1734,6 +1735,23 @@ bool Arg::parseArgs(std::vector<std::string> const &arguments)
       d_linkify = false;
       continue;
     }
+    if (option == "--jobs")
+    {
+      if (i < arguments.size() - 1)
+      {
+        if (!ston(&d_jobs, arguments[++i]))
+        {
+          std::cerr << "[ Error parsing command line option `" << option << "': Bad argument. ]" << std::endl;
+          ok = false;
+        }
+      }
+      else
+      {
+        std::cerr << "[ Error parsing command line option `" << option << "': Missing argument. ]" << std::endl;
+        ok = false;
+      }
+      continue;
+    }
     if (option[0] != '-')
     {
       if (d_positionals >= 2)
@@ -130,6 +130,8 @@ R"*(
    --originalfilenames                   Optional modifier for `--exporthtml'. Use the original filenames
                                          for attached media when available. This option can not be used
                                          together with `--append'.
+   --jobs <N>                            Optional modifier for `--exporthtml'. Export up to N conversations
+                                         simultaneously. By default, N is 1.
    --allhtmlpages                        Optional modifier for `--exporthtml'. Convenience option that
                                          enables all the modifying options for `--exporthtml' listed below.
    --themeswitching                      Optional modifier for `--exporthtml'. Adds a button to the HTML
@@ -189,7 +191,8 @@ R"*(
                                          is in a non-standard location <DIR> can be provided. See the README
                                          for more information about default locations.
    --ignorewal                           Optional modifier for `--importfromdesktop' and `--dumpdesktopdb`.
-                                         Ignores an existing WAL file when opening Signal Desktop database.
+                                         Ignores an existing WAL file when opening Signal Desktop database
+                                         (by default, the changes it contains are applied).
    --limittodates <LIST_OF_DATES>        Optional modifier for `--importfromdesktop'. Limit the messages
                                          imported to the specified date ranges. The format of the list of
                                          list of dates is the same as `--croptodates'.
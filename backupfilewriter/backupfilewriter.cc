@@ -0,0 +1,85 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "backupfilewriter.ih"
+
+BackupFileWriter::BackupFileWriter(std::ofstream &outputfile, FileEncryptor *fe, bool verbose)
+  :
+  d_outputfile(outputfile),
+  d_fe(fe),
+  d_nextcounter(fe->counter()),
+  d_queuedbytes(0),
+  d_ok(true)
+{
+  // the writing thread encrypts frames when there is nothing to write, so
+  // use one worker less than available cores. In verbose mode, frames are
+  // encrypted and written one by one (keeping the output in order).
+  unsigned int numthreads = std::thread::hardware_concurrency();
+  if (numthreads <= 1 || verbose)
+    return;
+
+  d_threads.reset(new WriterThreads);
+  d_threads->nextjob = 0;
+  d_threads->stop = false;
+  for (unsigned int i = 0; i < numthreads - 1; ++i)
+    d_threads->workers.emplace_back(&BackupFileWriter::encryptFrames, this, FileEncryptor(*d_fe));
+}
+
+BackupFileWriter::~BackupFileWriter()
+{
+  stopThreads();
+}
+
+void BackupFileWriter::stopThreads()
+{
+  if (!d_threads)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(d_threads->mutex);
+    d_threads->stop = true;
+  }
+  d_threads->workercv.notify_all();
+
+  for (auto &w : d_threads->workers)
+    if (w.joinable())
+      w.join();
+
+  d_threads.reset();
+}
+
+// write all remaining frames
+bool BackupFileWriter::finish()
+{
+  if (d_threads)
+  {
+    while (d_ok)
+    {
+      {
+        std::lock_guard<std::mutex> lock(d_threads->mutex);
+        if (d_threads->queue.empty())
+          break;
+      }
+      if (!writeFinishedFrames(true))
+        d_ok = false;
+    }
+    stopThreads();
+  }
+  return d_ok;
+}
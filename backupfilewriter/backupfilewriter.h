@@ -0,0 +1,97 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BACKUPFILEWRITER_H_
+#define BACKUPFILEWRITER_H_
+
+#include <fstream>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "../fileencryptor/fileencryptor.h"
+
+class BackupFrame;
+class FrameWithAttachment;
+
+/*
+  Encrypts and writes frames (including their attachment data) to a
+  backup file. The IV of every frame follows from its position in the
+  file, so frames can be encrypted by worker threads independently,
+  while the results are written strictly in order.
+*/
+class BackupFileWriter
+{
+  // a frame waiting to be encrypted by a worker, or written by the writer
+  struct Job
+  {
+    std::pair<std::shared_ptr<unsigned char[]>, uint64_t> framedata;
+    FrameWithAttachment *attachment;                 // nullptr if frame has no attachment data
+    uint32_t attachmentsize;
+    uint64_t counter;                                // encryption counter of the frame (its attachment uses counter + 1)
+    std::unique_ptr<unsigned char[]> encrypted;      // encrypted frame + encrypted attachment data + mac
+    uint64_t encryptedsize;
+    bool clearattachment;                            // clear the attachment data from memory after writing
+    bool direct;                                     // not encrypted by a worker, but when writing
+    bool badmac;
+    bool failed;
+    bool done;
+  };
+
+  struct WriterThreads
+  {
+    std::deque<std::unique_ptr<Job>> queue;
+    std::deque<std::unique_ptr<Job>>::size_type nextjob;
+    std::mutex mutex;
+    std::condition_variable workercv;
+    std::condition_variable writercv;
+    bool stop;
+    std::vector<std::thread> workers;
+  };
+  static unsigned int constexpr s_maxqueuedframes = 4096;
+  static uint64_t constexpr s_maxqueuedbytes = 128 * 1024 * 1024;      // encrypted data waiting to be written
+  static uint64_t constexpr s_maxthreadedattachmentsize = 16 * 1024 * 1024; // bigger attachments are streamed when writing
+
+  std::ofstream &d_outputfile;
+  FileEncryptor *d_fe;
+  uint64_t d_nextcounter;
+  uint64_t d_queuedbytes;
+  bool d_ok;
+  std::unique_ptr<WriterThreads> d_threads;
+
+ public:
+  BackupFileWriter(std::ofstream &outputfile, FileEncryptor *fe, bool verbose);
+  BackupFileWriter(BackupFileWriter const &other) = delete;
+  BackupFileWriter &operator=(BackupFileWriter const &other) = delete;
+  ~BackupFileWriter();
+  [[nodiscard]] bool writeFrame(BackupFrame *frame, bool clearattachmentdata = false);
+  [[nodiscard]] bool finish();
+
+ private:
+  void stopThreads();
+  void encryptFrames(FileEncryptor fe);
+  bool writeFinishedFrames(bool wait);
+  bool writeJob(Job *job);
+  bool writeJobDirect(Job *job);
+};
+
+#endif
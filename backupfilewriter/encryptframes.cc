@@ -0,0 +1,85 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "backupfilewriter.ih"
+
+/*
+  Runs in (possibly multiple) worker threads. Takes queued frames and
+  encrypts them (and their attachment data) using the counter assigned
+  to them. Failures are not reported here: the writer retries those
+  frames itself, on its own thread, when it gets to them.
+*/
+void BackupFileWriter::encryptFrames(FileEncryptor fe)
+{
+  while (true)
+  {
+    Job *job = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(d_threads->mutex);
+      d_threads->workercv.wait(lock, [&](){ return d_threads->stop || d_threads->nextjob < d_threads->queue.size(); });
+      if (d_threads->stop)
+        return;
+      job = d_threads->queue[d_threads->nextjob++].get();
+    }
+
+    if (job->direct)
+      continue;
+
+    fe.setCounter(job->counter);
+    std::pair<unsigned char *, uint64_t> encryptedframe = fe.encryptFrame(job->framedata);
+    if (!encryptedframe.first) [[unlikely]]
+      job->failed = true;
+    else if (!job->attachment)
+    {
+      job->encrypted.reset(encryptedframe.first);
+      job->encryptedsize = encryptedframe.second;
+    }
+    else
+    {
+      job->encryptedsize = encryptedframe.second + job->attachmentsize + CryptBase::MACSIZE;
+      job->encrypted.reset(new unsigned char[job->encryptedsize]);
+      std::memcpy(job->encrypted.get(), encryptedframe.first, encryptedframe.second);
+      delete[] encryptedframe.first;
+
+      uint64_t pos = encryptedframe.second;
+      uint64_t end = pos + job->attachmentsize;
+      int res = 1;
+      if (fe.encryptAttachmentStart(job->attachmentsize)) [[likely]]
+        res = job->attachment->streamAttachmentData([&](unsigned char *data, uint64_t size)
+        {
+          if (pos + size > end ||
+              !fe.encryptAttachmentUpdate(data, size, job->encrypted.get() + pos)) [[unlikely]]
+            return false;
+          pos += size;
+          return true;
+        });
+
+      if (res == -1) [[unlikely]]
+        job->badmac = true;
+      else if (res != 0 || pos != end || !fe.encryptAttachmentFinal(job->encrypted.get() + pos)) [[unlikely]]
+        job->failed = true;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(d_threads->mutex);
+      job->done = true;
+    }
+    d_threads->writercv.notify_one();
+  }
+}
@@ -0,0 +1,50 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "backupfilewriter.ih"
+
+/*
+  Writes the frames at the front of the queue that are done, in order.
+  If 'wait' is set, this waits for (at least) the first frame to be
+  finished.
+*/
+bool BackupFileWriter::writeFinishedFrames(bool wait)
+{
+  while (true)
+  {
+    std::unique_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(d_threads->mutex);
+      if (wait)
+        d_threads->writercv.wait(lock, [&](){ return d_threads->queue.empty() || d_threads->queue.front()->done; });
+      if (d_threads->queue.empty() || !d_threads->queue.front()->done)
+        return true;
+      job = std::move(d_threads->queue.front());
+      d_threads->queue.pop_front();
+      --d_threads->nextjob;
+    }
+    wait = false;
+
+    if (!job->direct)
+      d_queuedbytes -= job->framedata.second + job->attachmentsize;
+
+    if (!writeJob(job.get())) [[unlikely]]
+      return false;
+  }
+}
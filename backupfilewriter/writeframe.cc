@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "backupfilewriter.ih"
+
+bool BackupFileWriter::writeFrame(BackupFrame *frame, bool clearattachmentdata)
+{
+  if (!d_ok) [[unlikely]]
+    return false;
+
+  std::unique_ptr<Job> job(new Job);
+  {
+    std::pair<unsigned char *, uint64_t> framedataraw = frame->getData();
+    job->framedata.first.reset(framedataraw.first);
+    job->framedata.second = framedataraw.second;
+  }
+
+  if (!job->framedata.first) [[unlikely]]
+  {
+    Logger::error("Failed to get framedata from frame");
+    return (d_ok = false);
+  }
+
+  job->attachmentsize = frame->attachmentSize();
+  job->attachment = job->attachmentsize > 0 ? reinterpret_cast<FrameWithAttachment *>(frame) : nullptr;
+  job->counter = d_nextcounter;
+  job->encryptedsize = 0;
+  job->clearattachment = clearattachmentdata;
+  job->direct = !d_threads || job->attachmentsize > s_maxthreadedattachmentsize;
+  job->badmac = false;
+  job->failed = false;
+  job->done = job->direct;
+
+  d_nextcounter += (job->attachment ? 2 : 1);
+
+  if (!d_threads)
+    return (d_ok = writeJob(job.get()));
+
+  // make room in the queue
+  while (true)
+  {
+    {
+      std::lock_guard<std::mutex> lock(d_threads->mutex);
+      if (d_threads->queue.size() < s_maxqueuedframes && d_queuedbytes < s_maxqueuedbytes)
+        break;
+    }
+    if (!writeFinishedFrames(true)) [[unlikely]]
+      return (d_ok = false);
+  }
+
+  if (!job->direct)
+    d_queuedbytes += job->framedata.second + job->attachmentsize;
+  {
+    std::lock_guard<std::mutex> lock(d_threads->mutex);
+    d_threads->queue.emplace_back(std::move(job));
+  }
+  d_threads->workercv.notify_one();
+
+  // write what is done already
+  return (d_ok = writeFinishedFrames(false));
+}
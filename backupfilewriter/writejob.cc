@@ -0,0 +1,55 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "backupfilewriter.ih"
+
+bool BackupFileWriter::writeJob(Job *job)
+{
+  uint64_t const plannedcounters = job->attachment ? 2 : 1;
+  uint64_t const startcounter = d_fe->counter();
+
+  if (job->badmac) [[unlikely]]
+    Logger::warning("Corrupted data encountered. Skipping frame.");
+  else if (job->direct || job->failed || job->counter != startcounter) [[unlikely]]
+  {
+    // not encrypted yet, failed to encrypt in worker thread (retry here
+    // to get proper error messages), or encrypted with a counter that is
+    // no longer correct because an earlier frame was skipped.
+    if (!writeJobDirect(job))
+      return false;
+  }
+  else
+  {
+    if (!d_outputfile.write(reinterpret_cast<char *>(job->encrypted.get()), job->encryptedsize)) [[unlikely]]
+    {
+      Logger::error("Failed to write encrypted frame data to file");
+      return false;
+    }
+    d_fe->setCounter(startcounter + plannedcounters);
+  }
+
+  // if this frame was skipped, the frames queued after it were given too
+  // high a counter (and will be redone), fix it for new frames
+  d_nextcounter -= plannedcounters - (d_fe->counter() - startcounter);
+
+  job->encrypted.reset();
+  if (job->attachment && job->clearattachment)
+    job->attachment->clearData();
+  return true;
+}
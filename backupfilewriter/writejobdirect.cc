@@ -0,0 +1,85 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "backupfilewriter.ih"
+
+/*
+  Encrypts the frame with the writers own encryptor (at its current
+  counter) and writes it. Attachment data is transcoded in small chunks,
+  straight from the input to the output: every chunk is decrypted into a
+  small buffer, and re-encrypted in place, updating both the input and
+  output MAC along the way. The input MAC is checked before anything is
+  written, a frame with corrupted attachment data is skipped entirely.
+*/
+bool BackupFileWriter::writeJobDirect(Job *job)
+{
+  if (job->attachment)
+  {
+    int res = job->attachment->checkAttachmentMac();
+    if (res == -1) [[unlikely]]
+    {
+      Logger::warning("Corrupted data encountered. Skipping frame.");
+      return true;
+    }
+    if (res != 0) [[unlikely]]
+    {
+      Logger::error("Failed to read attachment data");
+      return false;
+    }
+  }
+
+  // write frame (the non-attachmentdata part)
+  std::pair<unsigned char *, uint64_t> encryptedframe = d_fe->encryptFrame(job->framedata);
+  if (!encryptedframe.first) [[unlikely]]
+  {
+    Logger::error("Failed to encrypt framedata");
+    return false;
+  }
+  bool writeok = !(d_outputfile.write(reinterpret_cast<char *>(encryptedframe.first), encryptedframe.second)).fail();
+  delete[] encryptedframe.first;
+  if (!writeok) [[unlikely]]
+  {
+    Logger::error("Failed to write encrypted frame data to file");
+    return false;
+  }
+
+  if (!job->attachment) // not an attachmentframe, done
+    return true;
+
+  // write attachment data
+  if (!d_fe->encryptAttachmentStart(job->attachmentsize)) [[unlikely]]
+    return false;
+
+  int res = job->attachment->streamAttachmentData([&](unsigned char *data, uint64_t size)
+  {
+    return d_fe->encryptAttachmentUpdate(data, size, data) &&
+      d_outputfile.write(reinterpret_cast<char *>(data), size);
+  });
+
+  // (a bad mac here, after it was checked above, means the input changed)
+  unsigned char mac[CryptBase::MACSIZE];
+  if (res != 0 ||
+      !d_fe->encryptAttachmentFinal(mac) ||
+      !d_outputfile.write(reinterpret_cast<char *>(mac), CryptBase::MACSIZE)) [[unlikely]]
+  {
+    Logger::error("Failed to write encrypted attachmentdata to file");
+    return false;
+  }
+  return true;
+}
@@ -20,11 +20,18 @@
 #ifndef BASEATTACHMENTREADER_H_
 #define BASEATTACHMENTREADER_H_
 
+#include <cstdint>
+#include <functional>
+
 class FrameWithAttachment;
 
 class BaseAttachmentReader
 {
  public:
+  // receives the attachment data chunk by chunk, returns false to abort reading.
+  // 'data' is a scratch buffer, the sink may modify it in place (eg to re-encrypt)
+  using Sink = std::function<bool(unsigned char *data, uint64_t size)>;
+
   BaseAttachmentReader() = default;
   BaseAttachmentReader(BaseAttachmentReader const &other) = default;
   BaseAttachmentReader(BaseAttachmentReader &&other) = default;
@@ -34,6 +41,15 @@ class BaseAttachmentReader
   virtual BaseAttachmentReader *clone() const = 0;
 
   inline virtual int getAttachment(FrameWithAttachment *frame, bool verbose) = 0;
+
+  // streaming: the data is passed to 'sink' in small chunks, it is never
+  // held in memory entirely. Note a bad MAC (return value -1) is only
+  // detected after all data has been passed on, use checkMac() first if
+  // (bad) data must not end up anywhere.
+  inline virtual bool canStream() const { return false; }
+  inline virtual int streamAttachment(Sink const &sink [[maybe_unused]], bool verbose [[maybe_unused]]) { return 1; }
+  // verifies the data without decrypting it: 0 if ok (or there is no MAC), 1 on error, -1 on bad mac
+  inline virtual int checkMac(bool verbose [[maybe_unused]]) { return 0; }
   //inline virtual void clearData() = 0;
 };
 
@@ -0,0 +1,56 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "bytetrie.ih"
+
+ByteTrie::ByteTrie(char const *const *strings, size_t count)
+  :
+  d_root{}
+{
+  // build a simple node-based trie first (node 0 is the root)...
+  std::vector<std::map<unsigned char, uint32_t>> children(1);
+  std::vector<bool> terminal(1, false);
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint32_t node = 0;
+    for (unsigned char const *c = reinterpret_cast<unsigned char const *>(strings[i]); *c; ++c)
+    {
+      auto [it, inserted] = children[node].try_emplace(*c, children.size());
+      if (inserted)
+      {
+        children.emplace_back();
+        terminal.push_back(false);
+      }
+      node = it->second;
+    }
+    terminal[node] = true;
+  }
+
+  // ... and flatten it. Node indices are kept as they are.
+  d_nodes.reserve(children.size());
+  d_edges.reserve(children.size() - 1);
+  for (uint32_t n = 0; n < children.size(); ++n)
+  {
+    d_nodes.push_back({static_cast<uint32_t>(d_edges.size()), static_cast<uint32_t>(children[n].size()), terminal[n]});
+    for (auto const &[byte, node] : children[n])
+      d_edges.push_back({byte, node});
+  }
+  for (auto const &[byte, node] : children[0])
+    d_root[byte] = node;
+}
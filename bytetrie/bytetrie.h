@@ -0,0 +1,87 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BYTETRIE_H_
+#define BYTETRIE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// A (read-only) trie over a fixed set of byte strings, used to find the longest
+// string from the set at a given position in a single pass over the input.
+// Nodes are stored flat: the outgoing edges of each node are a sorted range in
+// d_edges. The root gets a direct lookup table, since most input bytes will
+// not start a match at all.
+class ByteTrie
+{
+  struct Node
+  {
+    uint32_t firstedge;
+    uint32_t numedges;
+    bool terminal;
+  };
+
+  struct Edge
+  {
+    unsigned char byte;
+    uint32_t node;
+  };
+
+  std::vector<Node> d_nodes;
+  std::vector<Edge> d_edges;
+  std::array<uint32_t, 256> d_root;
+
+ public:
+  ByteTrie(char const *const *strings, size_t count);
+  inline unsigned int longestMatch(char const *data, size_t size) const;
+
+ private:
+  inline uint32_t child(uint32_t node, unsigned char c) const;
+};
+
+inline uint32_t ByteTrie::child(uint32_t node, unsigned char c) const
+{
+  auto begin = d_edges.begin() + d_nodes[node].firstedge;
+  auto end = begin + d_nodes[node].numedges;
+  auto it = std::lower_bound(begin, end, c, [](Edge const &e, unsigned char b) { return e.byte < b; });
+  return (it != end && it->byte == c) ? it->node : 0;
+}
+
+// returns the length of the longest string in the trie that 'data' starts with, or 0.
+inline unsigned int ByteTrie::longestMatch(char const *data, size_t size) const
+{
+  if (size == 0) [[unlikely]]
+    return 0;
+
+  unsigned int longest = 0;
+  uint32_t node = d_root[static_cast<unsigned char>(data[0])];
+  for (unsigned int i = 1; node != 0; ++i)
+  {
+    if (d_nodes[node].terminal)
+      longest = i;
+    if (i >= size)
+      break;
+    node = child(node, data[i]);
+  }
+  return longest;
+}
+
+#endif
@@ -77,6 +77,7 @@ namespace bepaald
   inline int strlitLength(std::string const &str);
   inline int numDigits(long long int num);
   inline std::string toDateString(std::time_t epoch, std::string const &format);
+  inline std::string strError(int errnum);
   inline std::string toLower(std::string s);
   inline std::string toUpper(std::string s);
   inline void replaceAll(std::string *in, char from, std::string const &to);
@@ -251,11 +252,37 @@ inline int bepaald::numDigits(long long int num)
 
 inline std::string bepaald::toDateString(std::time_t epoch, std::string const &format)
 {
+  // not std::localtime(), its result is shared between threads
+  std::tm tm{};
+#if defined(_WIN32) || defined(__MINGW64__)
+  localtime_s(&tm, &epoch);
+#else
+  localtime_r(&epoch, &tm);
+#endif
   std::ostringstream tmp;
-  tmp << std::put_time(std::localtime(&epoch), format.c_str());
+  tmp << std::put_time(&tm, format.c_str());
   return tmp.str();
 }
 
+inline std::string bepaald::strError(int errnum)
+{
+  // not std::strerror(), its result is shared between threads
+  char buf[256] = {};
+#if defined(_WIN32) || defined(__MINGW64__)
+  strerror_s(buf, sizeof(buf), errnum);
+  return buf;
+#else
+  // GNU strerror_r returns the message (not necessarily in buf), XSI strerror_r returns an int
+  return [&buf](auto result) -> char const *
+  {
+    if constexpr (std::is_same_v<decltype(result), int>)
+      return buf;
+    else
+      return result;
+  }(strerror_r(errnum, buf, sizeof(buf)));
+#endif
+}
+
 inline std::string bepaald::toLower(std::string s)
 {
   std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return std::tolower(c); });
@@ -25,6 +25,7 @@
 
 #include "../common_be.h"
 #include "../common_bytes.h"
+#include "../cryptcontext/cryptcontext.h"
 
 class CryptBase
 {
@@ -44,6 +45,7 @@ class CryptBase
   unsigned char *d_salt;
   uint64_t d_salt_size;
   uint64_t d_counter;
+  CryptContext d_cryptcontext;
  public:
   inline explicit CryptBase(bool verbose);
   inline CryptBase(CryptBase const &other);
@@ -90,7 +92,8 @@ inline CryptBase::CryptBase(CryptBase const &other)
   d_iv_size(other.d_iv_size),
   d_salt(nullptr),
   d_salt_size(other.d_salt_size),
-  d_counter(other.d_counter)
+  d_counter(other.d_counter),
+  d_cryptcontext(other.d_cryptcontext)
 {
   if (other.d_backupkey)
   {
@@ -169,6 +172,7 @@ inline CryptBase &CryptBase::operator=(CryptBase const &other)
       std::memcpy(d_salt, other.d_salt, d_salt_size);
     }
     d_counter = other.d_counter;
+    d_cryptcontext = other.d_cryptcontext;
     d_verbose = other.d_verbose;
     d_ok = other.d_ok;
   }
@@ -189,7 +193,8 @@ inline CryptBase::CryptBase(CryptBase &&other)
   d_iv_size(std::move(other.d_iv_size)),
   d_salt(std::move(other.d_salt)),
   d_salt_size(std::move(other.d_salt_size)),
-  d_counter(std::move(other.d_counter))
+  d_counter(std::move(other.d_counter)),
+  d_cryptcontext(std::move(other.d_cryptcontext))
 {
   other.d_backupkey = nullptr;
   other.d_backupkey_size = 0;
@@ -228,6 +233,7 @@ inline CryptBase &CryptBase::operator=(CryptBase &&other)
     d_salt = std::move(other.d_salt);
     d_salt_size = std::move(other.d_salt_size);
     d_counter = std::move(other.d_counter);
+    d_cryptcontext = std::move(other.d_cryptcontext);
 
     // invalidate other
     other.d_backupkey = nullptr;
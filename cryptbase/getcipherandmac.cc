@@ -56,5 +56,11 @@ bool CryptBase::getCipherAndMac(unsigned int hashoutputsize, size_t outputsize)
   d_mackey = new unsigned char[d_mackey_size];
   std::memcpy(d_mackey, derived.get() + hashoutputsize, hashoutputsize);
 
+  if (!d_cryptcontext.initHmac(d_mackey, d_mackey_size, EVP_sha256()))
+  {
+    Logger::error("Failed to initialize HMAC context");
+    return false;
+  }
+
   return true;
 }
@@ -0,0 +1,214 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CRYPTCONTEXT_H_
+#define CRYPTCONTEXT_H_
+
+#include <memory>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+/*
+  Holds a keyed HMAC context and a keyed cipher context, so they do not
+  have to be fetched, created and keyed again for every frame/page. The
+  keyed 'templates' are created once and shared (read-only) between
+  copies, each copy lazily duplicates its own working contexts from them.
+  Copying is cheap, so every thread should simply use its own copy.
+*/
+class CryptContext
+{
+ public:
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  using HmacCtx = EVP_MAC_CTX;
+#else
+  using HmacCtx = HMAC_CTX;
+#endif
+
+ private:
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  using HmacCtxPtr = std::unique_ptr<HmacCtx, decltype(&::EVP_MAC_CTX_free)>;
+#else
+  using HmacCtxPtr = std::unique_ptr<HmacCtx, decltype(&::HMAC_CTX_free)>;
+#endif
+  using CipherCtxPtr = std::unique_ptr<EVP_CIPHER_CTX, decltype(&::EVP_CIPHER_CTX_free)>;
+
+  std::shared_ptr<HmacCtx const> d_hmactemplate;
+  std::shared_ptr<EVP_CIPHER_CTX const> d_ciphertemplate;
+  HmacCtxPtr d_hmac;
+  CipherCtxPtr d_cipher;
+
+ public:
+  inline CryptContext();
+  inline CryptContext(CryptContext const &other);
+  inline CryptContext &operator=(CryptContext const &other);
+  inline CryptContext(CryptContext &&other) = default;
+  inline CryptContext &operator=(CryptContext &&other) = default;
+
+  inline bool initHmac(unsigned char const *key, uint64_t keysize, EVP_MD const *md);
+  inline bool initCipher(EVP_CIPHER const *type, unsigned char const *key, bool encrypt);
+  inline bool hasHmac() const;
+  inline bool hasCipher() const;
+
+  // get a context, ready to use, with the key set at init. Returns nullptr on error
+  inline HmacCtx *hmac();
+  inline EVP_CIPHER_CTX *cipher(unsigned char const *iv);
+
+ private:
+  inline static HmacCtxPtr newHmacCtx(HmacCtx *ctx = nullptr);
+  inline static CipherCtxPtr newCipherCtx(EVP_CIPHER_CTX *ctx = nullptr);
+};
+
+inline CryptContext::CryptContext()
+  :
+  d_hmac(newHmacCtx()),
+  d_cipher(newCipherCtx())
+{}
+
+inline CryptContext::CryptContext(CryptContext const &other)
+  :
+  d_hmactemplate(other.d_hmactemplate),
+  d_ciphertemplate(other.d_ciphertemplate),
+  d_hmac(newHmacCtx()),
+  d_cipher(newCipherCtx())
+{}
+
+inline CryptContext &CryptContext::operator=(CryptContext const &other)
+{
+  if (this != &other)
+  {
+    d_hmactemplate = other.d_hmactemplate;
+    d_ciphertemplate = other.d_ciphertemplate;
+    d_hmac.reset();
+    d_cipher.reset();
+  }
+  return *this;
+}
+
+inline CryptContext::HmacCtxPtr CryptContext::newHmacCtx(HmacCtx *ctx) // static
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  return HmacCtxPtr(ctx, &::EVP_MAC_CTX_free);
+#else
+  return HmacCtxPtr(ctx, &::HMAC_CTX_free);
+#endif
+}
+
+inline CryptContext::CipherCtxPtr CryptContext::newCipherCtx(EVP_CIPHER_CTX *ctx) // static
+{
+  return CipherCtxPtr(ctx, &::EVP_CIPHER_CTX_free);
+}
+
+inline bool CryptContext::initHmac(unsigned char const *key, uint64_t keysize, EVP_MD const *md)
+{
+  d_hmac.reset();
+  d_hmactemplate.reset();
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  std::unique_ptr<EVP_MAC, decltype(&::EVP_MAC_free)> mac(EVP_MAC_fetch(nullptr, "hmac", nullptr), &::EVP_MAC_free);
+  if (!mac) [[unlikely]]
+    return false;
+  HmacCtxPtr hctx(EVP_MAC_CTX_new(mac.get()), &::EVP_MAC_CTX_free);
+  OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string("digest", const_cast<char *>(EVP_MD_get0_name(md)), 0), OSSL_PARAM_construct_end()};
+  if (!hctx || EVP_MAC_init(hctx.get(), key, keysize, params) != 1) [[unlikely]]
+    return false;
+  d_hmactemplate.reset(hctx.release(), &::EVP_MAC_CTX_free);
+#else
+  HmacCtxPtr hctx(HMAC_CTX_new(), &::HMAC_CTX_free);
+  if (!hctx || HMAC_Init_ex(hctx.get(), key, keysize, md, nullptr) != 1) [[unlikely]]
+    return false;
+  d_hmactemplate.reset(hctx.release(), &::HMAC_CTX_free);
+#endif
+  return true;
+}
+
+inline bool CryptContext::initCipher(EVP_CIPHER const *type, unsigned char const *key, bool encrypt)
+{
+  d_cipher.reset();
+  d_ciphertemplate.reset();
+
+  CipherCtxPtr ctx(EVP_CIPHER_CTX_new(), &::EVP_CIPHER_CTX_free);
+  if (!ctx || EVP_CipherInit_ex(ctx.get(), type, nullptr, key, nullptr, encrypt ? 1 : 0) != 1) [[unlikely]]
+    return false;
+  // disable padding
+  EVP_CIPHER_CTX_set_padding(ctx.get(), 0);
+  d_ciphertemplate.reset(ctx.release(), &::EVP_CIPHER_CTX_free);
+  return true;
+}
+
+inline bool CryptContext::hasHmac() const
+{
+  return d_hmactemplate.get() != nullptr;
+}
+
+inline bool CryptContext::hasCipher() const
+{
+  return d_ciphertemplate.get() != nullptr;
+}
+
+inline CryptContext::HmacCtx *CryptContext::hmac()
+{
+  if (!d_hmactemplate) [[unlikely]]
+    return nullptr;
+
+  if (!d_hmac) [[unlikely]]
+  {
+    // first use, duplicate template (already keyed)
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    d_hmac = newHmacCtx(EVP_MAC_CTX_dup(d_hmactemplate.get()));
+#else
+    d_hmac = newHmacCtx(HMAC_CTX_new());
+    if (d_hmac && HMAC_CTX_copy(d_hmac.get(), const_cast<HMAC_CTX *>(d_hmactemplate.get())) != 1) [[unlikely]]
+      d_hmac.reset();
+#endif
+    return d_hmac.get();
+  }
+
+  // re-initialize with the same key
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  if (EVP_MAC_init(d_hmac.get(), nullptr, 0, nullptr) != 1) [[unlikely]]
+#else
+  if (HMAC_Init_ex(d_hmac.get(), nullptr, 0, nullptr, nullptr) != 1) [[unlikely]]
+#endif
+    return nullptr;
+  return d_hmac.get();
+}
+
+inline EVP_CIPHER_CTX *CryptContext::cipher(unsigned char const *iv)
+{
+  if (!d_ciphertemplate) [[unlikely]]
+    return nullptr;
+
+  if (!d_cipher) [[unlikely]]
+  {
+    d_cipher = newCipherCtx(EVP_CIPHER_CTX_new());
+    if (!d_cipher || EVP_CIPHER_CTX_copy(d_cipher.get(), d_ciphertemplate.get()) != 1) [[unlikely]]
+    {
+      d_cipher.reset();
+      return nullptr;
+    }
+  }
+
+  // only set new iv, keep cipher, key and direction
+  if (EVP_CipherInit_ex(d_cipher.get(), nullptr, nullptr, nullptr, iv, -1) != 1) [[unlikely]]
+    return nullptr;
+  return d_cipher.get();
+}
+
+#endif
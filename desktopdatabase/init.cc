@@ -19,6 +19,8 @@
 
 #include "desktopdatabase.ih"
 
+#include "../sqlcipherfiledb/sqlcipherfiledb.h"
+
 bool DesktopDatabase::init()
 {
   // get directories
@@ -33,18 +35,6 @@ bool DesktopDatabase::init()
     }
   }
 
-  // check if a wal (Write-Ahead Logging) file is present in path, and warn user to (cleanly) shut Signal Desktop down
-  if (!d_ignorewal &&
-      bepaald::fileOrDirExists(d_databasedir + "/sql/db.sqlite-wal"))
-  {
-    // warn
-    Logger::warning("Found Sqlite-WAL file (write-ahead logging).");
-    Logger::warning_indent("Desktop data may not be fully up-to-date.");
-    Logger::warning_indent("Maybe Signal Desktop has not cleanly shut down?");
-    Logger::warning_indent("(pass `--ignorewal' to disable this warning)");
-    return false;
-  }
-
   // get key
   if (d_hexkey.empty())
     if (!getKey())
@@ -56,28 +46,22 @@ bool DesktopDatabase::init()
   if (d_showkey)
     Logger::message("Signal Desktop key (hex): ", d_hexkey);
 
-  // decrypt the database
-  d_cipherdb.reset(new SqlCipherDecryptor(d_databasedir + "/sql/db.sqlite", d_hexkey, d_cipherversion, d_verbose));
+  // open the database, its pages are only decrypted when sqlite reads them. Unless ignored, the
+  // changes in the write-ahead log (db.sqlite-wal) are applied, so a running Signal Desktop
+  // does not have to be shut down (and checkpoint its log) first.
+  d_cipherdb.reset(new SqlCipherDecryptor(d_databasedir + "/sql/db.sqlite", d_hexkey, d_cipherversion, true /*lazy*/,
+                                          !d_ignorewal, d_verbose));
   if (!d_cipherdb->ok())
     return false;
 
-  // get the decrypted data
-  auto [data, size] = d_cipherdb->data(); // unsigned char *, uint64_t
-
-  // disable WAL (Write-Ahead Logging) on database, reading from memory
-  // otherwise will not work see https://www.sqlite.org/fileformat.html
-  if (data[0x12] == 2)
-    data[0x12] = 1;
-  if (data[0x13] == 2)
-    data[0x13] = 1;
-
-  std::pair<unsigned char *, uint64_t> desktopdata = {data, size};
-  d_database = MemSqliteDB(&desktopdata);
-  if (!d_database.ok())
+  // the database is read through the decryptor directly, swap it in instead of copying it to memory
+  MemSqliteDB database(SqlCipherFileDB::sqlite3_sqlcipherfilevfs(d_cipherdb.get()));
+  if (!database.ok())
   {
     Logger::error("Failed to open database");
     return false;
   }
+  d_database.swap(database);
 
   return true;
 }
@@ -26,13 +26,16 @@ FileDecryptor::FileDecryptor(std::string const &filename, std::string const &pas
   CryptBase(verbose),
   d_headerframe(nullptr),
   d_filename(filename),
+  d_mappedfile(nullptr),
   d_framecount(0),
   d_filesize(0),
   d_badmac(false),
   d_assumebadframesize(assumebadframesize),
   d_editattachments(editattachments),
   d_stoponerror(stoponerror),
-  d_backupfileversion(0)
+  d_backupfileversion(0),
+  d_numthreads(std::thread::hardware_concurrency()),
+  d_threads(nullptr)
 {
   std::ifstream file(d_filename, std::ios_base::binary | std::ios_base::in);
   if (!file.is_open())
@@ -46,6 +49,17 @@ FileDecryptor::FileDecryptor(std::string const &filename, std::string const &pas
   //file.seekg(0);
   d_filesize = bepaald::fileSize(d_filename);
 
+  // try to map the file, frames and attachments are then read straight from memory.
+  // if this fails (for example, a 32-bit system with a backup too large to map), the
+  // file is read normally
+  d_mappedfile = std::make_shared<MappedFile>(d_filename);
+  if (!d_mappedfile->ok() || d_mappedfile->size() != d_filesize) [[unlikely]]
+  {
+    if (d_verbose) [[unlikely]]
+      Logger::message("Failed to map backup file, reading normally");
+    d_mappedfile.reset();
+  }
+
   // read first four bytes, they are the header size of the file:
   int32_t headerlength = getNextFrameBlockSize(file);
   DEBUGOUT("headerlength: ", headerlength);
@@ -107,6 +121,13 @@ FileDecryptor::FileDecryptor(std::string const &filename, std::string const &pas
     return;
   }
 
+  if (!d_cryptcontext.initCipher(EVP_aes_256_ctr(), d_cipherkey, false))
+  {
+    Logger::error("Failed to initialize cipher context");
+    delete headerframe;
+    return;
+  }
+
   d_backupfileversion = reinterpret_cast<HeaderFrame *>(headerframe)->version();
 
   //headerframe->printInfo();
@@ -22,18 +22,69 @@
 
 #include <cstring>
 #include <fstream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <openssl/sha.h>
 
 #include "../common_be.h"
 #include "../backupframe/backupframe.h"
 #include "../framewithattachment/framewithattachment.h"
 #include "../cryptbase/cryptbase.h"
+#include "../mappedfile/mappedfile.h"
 #include "../invalidframe/invalidframe.h"
 #include "../logger/logger.h"
 
 class  FileDecryptor : public CryptBase
 {
+  // a frame read (and decrypted) by the scanner thread, waiting
+  // for its MAC to be checked and data parsed by a worker thread
+  struct ThreadedFrame
+  {
+    unsigned char const *encryptedframe;             // 4 bytes encrypted length + frame + MAC
+    std::unique_ptr<unsigned char[]> encryptedframebuffer; // holds encryptedframe if file is not mapped
+    uint32_t encryptedframelength;                   // length of frame + MAC
+    std::unique_ptr<unsigned char[]> decodedframe;
+    std::unique_ptr<BackupFrame> frame;
+    uint64_t framenumber;
+    uint64_t counter;                                // CTR counter of the frame (the attachment data uses counter + 1)
+    uint64_t nextcounter;                            // counter and framecount after this frame (as
+    uint64_t nextframecount;                         // when reading sequentially)
+    uint32_t attachmentsize;
+    uint64_t attachmentpos;
+    uint64_t filepos;                                // file position after this frame (and its attachment)
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    std::string error;                               // non-empty if scanner or worker failed at this frame
+    bool badlength;
+    bool badmac;
+    bool eof;
+    bool done;
+  };
+
+  struct FrameThreads
+  {
+    std::deque<std::unique_ptr<ThreadedFrame>> queue;
+    std::deque<std::unique_ptr<ThreadedFrame>>::size_type nextjob;
+    std::mutex mutex;
+    std::condition_variable scannercv;
+    std::condition_variable workercv;
+    std::condition_variable consumercv;
+    bool stop;
+    bool scandone;
+    uint64_t scancounter;    // counter and framecount of the next frame to scan (only used by the scanner)
+    uint64_t scanframecount;
+    uint64_t counter;        // counter and framecount after the last frame returned by getFrameThreaded(),
+    uint64_t framecount;     // copied to d_counter and d_framecount in stopThreads()
+    std::thread scanner;
+    std::vector<std::thread> workers;
+  };
+  static unsigned int constexpr s_maxqueuedframes = 4096;
+
   std::unique_ptr<BackupFrame> d_headerframe;
   std::string d_filename;
+  std::shared_ptr<MappedFile> d_mappedfile;
   uint64_t d_framecount;
   uint64_t d_filesize;
   bool d_badmac;
@@ -41,6 +92,8 @@ class  FileDecryptor : public CryptBase
   std::vector<long long int> d_editattachments;
   bool d_stoponerror;
   uint32_t d_backupfileversion;
+  unsigned int d_numthreads;
+  std::unique_ptr<FrameThreads> d_threads;
 
  public:
   FileDecryptor(std::string const &filename, std::string const &passphrase, bool verbose, bool stoponerror = false, bool assumebadframesize = false, std::vector<long long int> const &editattachments = std::vector<long long int>());
@@ -48,9 +101,11 @@ class  FileDecryptor : public CryptBase
   inline FileDecryptor &operator=(FileDecryptor const &other);
   inline FileDecryptor(FileDecryptor &&other);
   inline FileDecryptor &operator=(FileDecryptor &&other);
+  inline ~FileDecryptor();
 
   std::unique_ptr<BackupFrame> getFrameOld(std::ifstream &file);
   std::unique_ptr<BackupFrame> getFrame(std::ifstream &file);
+  std::unique_ptr<BackupFrame> getFrameThreaded(std::ifstream &file);
   inline uint64_t total() const;
   inline bool badMac() const;
 
@@ -71,6 +126,13 @@ class  FileDecryptor : public CryptBase
 
   std::unique_ptr<BackupFrame> bruteForceFrom(std::ifstream &file, uint64_t filepos, uint32_t previousframelength);
   std::unique_ptr<BackupFrame> getFrameBrute(std::ifstream &file, uint64_t offset, uint32_t previousframelength);
+
+  // threaded reading
+  void startThreads(uint64_t filepos);
+  void stopThreads();
+  void scanFrames(uint64_t filepos);
+  void processFrames();
+  inline bool useThreads() const;
 };
 
 inline FileDecryptor::FileDecryptor(FileDecryptor const &other)
@@ -78,13 +140,16 @@ inline FileDecryptor::FileDecryptor(FileDecryptor const &other)
   CryptBase(other),
   d_headerframe(nullptr),
   d_filename(other.d_filename),
+  d_mappedfile(other.d_mappedfile),
   d_framecount(other.d_framecount),
   d_filesize(other.d_filesize),
   d_badmac(other.d_badmac),
   d_assumebadframesize(other.d_assumebadframesize),
   d_editattachments(other.d_editattachments),
   d_stoponerror(other.d_stoponerror),
-  d_backupfileversion(other.d_backupfileversion)
+  d_backupfileversion(other.d_backupfileversion),
+  d_numthreads(other.d_numthreads),
+  d_threads(nullptr)
 {
   d_ok = false;
 
@@ -103,6 +168,7 @@ inline FileDecryptor &FileDecryptor::operator=(FileDecryptor const &other)
     if (other.d_headerframe)
       d_headerframe.reset(other.d_headerframe->clone());
     d_filename = other.d_filename;
+    d_mappedfile = other.d_mappedfile;
     d_framecount = other.d_framecount;
     d_filesize = other.d_filesize;
     d_badmac = other.d_badmac;
@@ -110,6 +176,7 @@ inline FileDecryptor &FileDecryptor::operator=(FileDecryptor const &other)
     d_editattachments = other.d_editattachments;
     d_stoponerror = other.d_stoponerror;
     d_backupfileversion = other.d_backupfileversion;
+    d_numthreads = other.d_numthreads;
     d_ok = other.d_ok;
   }
   return *this;
@@ -120,13 +187,16 @@ inline FileDecryptor::FileDecryptor(FileDecryptor &&other)
   CryptBase(std::move(other)),
   d_headerframe(std::move(other.d_headerframe)),
   d_filename(std::move(other.d_filename)),
+  d_mappedfile(std::move(other.d_mappedfile)),
   d_framecount(std::move(other.d_framecount)),
   d_filesize(std::move(other.d_filesize)),
   d_badmac(std::move(other.d_badmac)),
   d_assumebadframesize(std::move(other.d_assumebadframesize)),
   d_editattachments(std::move(other.d_editattachments)),
   d_stoponerror(std::move(other.d_stoponerror)),
-  d_backupfileversion(std::move(other.d_backupfileversion))
+  d_backupfileversion(std::move(other.d_backupfileversion)),
+  d_numthreads(std::move(other.d_numthreads)),
+  d_threads(nullptr) // running threads refer to other, they are not moved
 {}
 
 inline FileDecryptor &FileDecryptor::operator=(FileDecryptor &&other)
@@ -136,6 +206,7 @@ inline FileDecryptor &FileDecryptor::operator=(FileDecryptor &&other)
     CryptBase::operator=(std::move(other));
     d_headerframe = std::move(other.d_headerframe);
     d_filename = std::move(other.d_filename);
+    d_mappedfile = std::move(other.d_mappedfile);
     d_framecount = std::move(other.d_framecount);
     d_filesize = std::move(other.d_filesize);
     d_badmac = std::move(other.d_badmac);
@@ -143,10 +214,16 @@ inline FileDecryptor &FileDecryptor::operator=(FileDecryptor &&other)
     d_editattachments = std::move(other.d_editattachments);
     d_stoponerror = std::move(other.d_stoponerror);
     d_backupfileversion = std::move(other.d_backupfileversion);
+    d_numthreads = std::move(other.d_numthreads);
   }
   return *this;
 }
 
+inline FileDecryptor::~FileDecryptor()
+{
+  stopThreads();
+}
+
 inline uint64_t FileDecryptor::total() const
 {
   return d_filesize;
@@ -157,6 +234,13 @@ inline bool FileDecryptor::badMac() const
   return d_badmac;
 }
 
+// the threaded reader only handles the regular (version > 0) backups, when
+// nothing needs to be logged or edited per frame
+inline bool FileDecryptor::useThreads() const
+{
+  return d_numthreads > 1 && d_backupfileversion > 0 && !d_verbose && d_editattachments.empty();
+}
+
 // only used by getFrameOld(), used in older backups where frame length was not encrypted
 inline uint32_t FileDecryptor::getNextFrameBlockSize(std::ifstream &file)
 {
@@ -33,6 +33,7 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
   {
     if (d_verbose) [[unlikely]]
       Logger::message("Read entire backup file...");
+    stopThreads();
     return std::unique_ptr<BackupFrame>(nullptr);
   }
 
@@ -42,8 +43,22 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
     return std::unique_ptr<BackupFrame>(d_headerframe.release());
   }
 
+  if (useThreads())
+    return getFrameThreaded(file);
+
   uint32_t encrypted_encryptedframelength = 0;
-  if (!file.read(reinterpret_cast<char *>(&encrypted_encryptedframelength), sizeof(decltype(encrypted_encryptedframelength)))) [[unlikely]]
+  if (d_mappedfile) [[likely]]
+  {
+    if (filepos + sizeof(decltype(encrypted_encryptedframelength)) > d_mappedfile->size()) [[unlikely]]
+    {
+      Logger::error("Failed to read ", sizeof(decltype(encrypted_encryptedframelength)),
+                    " bytes from file to get next frame size... (", filepos,
+                    " / ", d_filesize, ")");
+      return std::unique_ptr<BackupFrame>(nullptr);
+    }
+    std::memcpy(&encrypted_encryptedframelength, d_mappedfile->data() + filepos, sizeof(decltype(encrypted_encryptedframelength)));
+  }
+  else if (!file.read(reinterpret_cast<char *>(&encrypted_encryptedframelength), sizeof(decltype(encrypted_encryptedframelength)))) [[unlikely]]
   {
     Logger::error("Failed to read ", sizeof(decltype(encrypted_encryptedframelength)),
                   " bytes from file to get next frame size... (", file.tellg(),
@@ -51,21 +66,9 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
     return std::unique_ptr<BackupFrame>(nullptr);
   }
 
-  // set up context for caclulating MAC
-#if OPENSSL_VERSION_NUMBER >= 0x30000000L
-  std::unique_ptr<EVP_MAC, decltype(&::EVP_MAC_free)> mac(EVP_MAC_fetch(nullptr, "hmac", nullptr), &::EVP_MAC_free);
-  std::unique_ptr<EVP_MAC_CTX, decltype(&::EVP_MAC_CTX_free)> hctx(EVP_MAC_CTX_new(mac.get()), &::EVP_MAC_CTX_free);
-  char digest[] = "SHA256";
-  OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string("digest", digest, 0), OSSL_PARAM_construct_end()};
-#else
-  std::unique_ptr<HMAC_CTX, decltype(&::HMAC_CTX_free)> hctx(HMAC_CTX_new(), &::HMAC_CTX_free);
-#endif
-
-#if OPENSSL_VERSION_NUMBER >= 0x30000000L
-  if (EVP_MAC_init(hctx.get(), d_mackey, d_mackey_size, params) != 1) [[unlikely]]
-#else
-  if (HMAC_Init_ex(hctx.get(), d_mackey, d_mackey_size, EVP_sha256(), nullptr) != 1) [[unlikely]]
-#endif
+  // get (cached) context for caclulating MAC
+  CryptContext::HmacCtx *hctx = d_cryptcontext.hmac();
+  if (!hctx) [[unlikely]]
   {
     Logger::error("Failed to initialize HMAC context");
     return std::unique_ptr<BackupFrame>(nullptr);
@@ -73,9 +76,9 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
 
   // update MAC with frame length
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L
-  if (EVP_MAC_update(hctx.get(), reinterpret_cast<unsigned char *>(&encrypted_encryptedframelength), sizeof(decltype(encrypted_encryptedframelength))) != 1) [[unlikely]]
+  if (EVP_MAC_update(hctx, reinterpret_cast<unsigned char *>(&encrypted_encryptedframelength), sizeof(decltype(encrypted_encryptedframelength))) != 1) [[unlikely]]
 #else
-  if (HMAC_Update(hctx.get(), reinterpret_cast<unsigned char *>(&encrypted_encryptedframelength), sizeof(decltype(encrypted_encryptedframelength))) != 1) [[unlikely]]
+  if (HMAC_Update(hctx, reinterpret_cast<unsigned char *>(&encrypted_encryptedframelength), sizeof(decltype(encrypted_encryptedframelength))) != 1) [[unlikely]]
 #endif
   {
     Logger::error("Failed to update HMAC");
@@ -85,12 +88,9 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
   // decrypt encrypted_encryptedframelength
   uintToFourBytes(d_iv, d_counter++);
 
-  // create context
-  std::unique_ptr<EVP_CIPHER_CTX, decltype(&::EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), &::EVP_CIPHER_CTX_free);
-  // disable padding
-  EVP_CIPHER_CTX_set_padding(ctx.get(), 0);
-
-  if (EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_ctr(), nullptr, d_cipherkey, d_iv) != 1) [[unlikely]]
+  // get (cached) context, set to the new iv
+  EVP_CIPHER_CTX *ctx = d_cryptcontext.cipher(d_iv);
+  if (!ctx) [[unlikely]]
   {
     Logger::error("CTX INIT FAILED");
     return nullptr;
@@ -98,7 +98,7 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
 
   uint32_t encryptedframelength = 0;
   int encryptedframelength_size = sizeof(decltype(encryptedframelength));
-  if (EVP_DecryptUpdate(ctx.get(), reinterpret_cast<unsigned char *>(&encryptedframelength), &encryptedframelength_size,
+  if (EVP_DecryptUpdate(ctx, reinterpret_cast<unsigned char *>(&encryptedframelength), &encryptedframelength_size,
                         reinterpret_cast<unsigned char *>(&encrypted_encryptedframelength),
                         sizeof(decltype(encrypted_encryptedframelength))) != 1) [[unlikely]]
   {
@@ -120,20 +120,36 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
     return std::unique_ptr<BackupFrame>(nullptr);
   }
 
-  // read in the encrypted frame data
-  std::unique_ptr<unsigned char[]> encryptedframe(new unsigned char[encryptedframelength]);
-
-  if (!getNextFrameBlock(file, encryptedframe.get(), encryptedframelength)) [[unlikely]]
+  // get the encrypted frame data, straight from the mapped file, or read it into a buffer
+  unsigned char const *encryptedframe = nullptr;
+  std::unique_ptr<unsigned char[]> encryptedframebuffer;
+  if (d_mappedfile) [[likely]]
   {
-    Logger::error("Failed to read next frame (", encryptedframelength, " bytes at filepos ", filepos, ")");
-    return std::unique_ptr<BackupFrame>(nullptr);
+    uint64_t framepos = filepos + sizeof(decltype(encrypted_encryptedframelength));
+    if (framepos + encryptedframelength > d_mappedfile->size()) [[unlikely]]
+    {
+      Logger::error("Failed to read next frame (", encryptedframelength, " bytes at filepos ", filepos, ")");
+      return std::unique_ptr<BackupFrame>(nullptr);
+    }
+    encryptedframe = d_mappedfile->data() + framepos;
+    file.seekg(framepos + encryptedframelength);
+  }
+  else
+  {
+    encryptedframebuffer.reset(new unsigned char[encryptedframelength]);
+    if (!getNextFrameBlock(file, encryptedframebuffer.get(), encryptedframelength)) [[unlikely]]
+    {
+      Logger::error("Failed to read next frame (", encryptedframelength, " bytes at filepos ", filepos, ")");
+      return std::unique_ptr<BackupFrame>(nullptr);
+    }
+    encryptedframe = encryptedframebuffer.get();
   }
 
   // update MAC with read data
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L
-  if (EVP_MAC_update(hctx.get(), encryptedframe.get(), encryptedframelength - MACSIZE) != 1)
+  if (EVP_MAC_update(hctx, encryptedframe, encryptedframelength - MACSIZE) != 1)
 #else
-  if (HMAC_Update(hctx.get(), encryptedframe.get(), encryptedframelength - MACSIZE) != 1)
+  if (HMAC_Update(hctx, encryptedframe, encryptedframelength - MACSIZE) != 1)
 #endif
   {
     Logger::error("Failed to update HMAC");
@@ -144,11 +160,11 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L
   unsigned long int digest_size = SHA256_DIGEST_LENGTH;
   unsigned char hash[SHA256_DIGEST_LENGTH];
-  if (EVP_MAC_final(hctx.get(), hash, nullptr, digest_size) != 1)
+  if (EVP_MAC_final(hctx, hash, nullptr, digest_size) != 1)
 #else
   unsigned int digest_size = SHA256_DIGEST_LENGTH;
   unsigned char hash[SHA256_DIGEST_LENGTH];
-  if (HMAC_Final(hctx.get(), hash, &digest_size) != 1)
+  if (HMAC_Final(hctx, hash, &digest_size) != 1)
 #endif
   {
     Logger::error("Failed to finalize MAC");
@@ -156,10 +172,10 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
   }
 
   // check MAC
-  if (std::memcmp(encryptedframe.get() + (encryptedframelength - MACSIZE), hash, 10) != 0) [[unlikely]]
+  if (std::memcmp(encryptedframe + (encryptedframelength - MACSIZE), hash, 10) != 0) [[unlikely]]
   {
     Logger::message("\n");
-    Logger::warning("Bad MAC in frame: theirMac: ", bepaald::bytesToHexString(encryptedframe.get() + (encryptedframelength - MACSIZE), MACSIZE),
+    Logger::warning("Bad MAC in frame: theirMac: ", bepaald::bytesToHexString(encryptedframe + (encryptedframelength - MACSIZE), MACSIZE),
                     "\n                              ourMac: ", bepaald::bytesToHexString(hash, SHA256_DIGEST_LENGTH));
 
     if (d_framecount == 1) [[unlikely]]
@@ -174,7 +190,7 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
     if (d_verbose) [[unlikely]]
     {
       Logger::message("Calculated mac: ", bepaald::bytesToHexString(hash, SHA256_DIGEST_LENGTH));
-      Logger::message("Mac in file   : ", bepaald::bytesToHexString(encryptedframe.get() + (encryptedframelength - MACSIZE), MACSIZE));
+      Logger::message("Mac in file   : ", bepaald::bytesToHexString(encryptedframe + (encryptedframelength - MACSIZE), MACSIZE));
     }
   }
 
@@ -182,14 +198,14 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
   int decodedframelength = encryptedframelength - MACSIZE;
   unsigned char *decodedframe = new unsigned char[decodedframelength];
 
-  if (EVP_DecryptUpdate(ctx.get(), decodedframe, &decodedframelength, encryptedframe.get(), encryptedframelength - MACSIZE) != 1) [[unlikely]]
+  if (EVP_DecryptUpdate(ctx, decodedframe, &decodedframelength, encryptedframe, encryptedframelength - MACSIZE) != 1) [[unlikely]]
   {
     Logger::error("Failed to decrypt data");
     delete[] decodedframe;
     return std::unique_ptr<BackupFrame>(nullptr);
   }
 
-  delete[] encryptedframe.release(); // free up already....
+  encryptedframebuffer.reset(); // free up already....
 
   std::unique_ptr<BackupFrame> frame(initBackupFrame(decodedframe, decodedframelength, d_framecount++));
 
@@ -247,7 +263,7 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrame(std::ifstream &file)
 
     uintToFourBytes(d_iv, d_counter++);
 
-    reinterpret_cast<FrameWithAttachment *>(frame.get())->setReader(new AndroidAttachmentReader(d_iv, d_iv_size, d_mackey, d_mackey_size, d_cipherkey, d_cipherkey_size, attsize, d_filename, file.tellg()));
+    reinterpret_cast<FrameWithAttachment *>(frame.get())->setReader(new AndroidAttachmentReader(d_iv, d_iv_size, d_cryptcontext, attsize, d_filename, d_mappedfile, file.tellg()));
 
     file.seekg(attsize + MACSIZE, std::ios_base::cur);
   }
@@ -437,7 +453,7 @@ std::unique_ptr<BackupFrame> FileDecryptor::getFrameOld(std::ifstream &file)
     uintToFourBytes(d_iv, d_counter++);
 
     //reinterpret_cast<FrameWithAttachment *>(frame.get())->setLazyData(d_iv, d_iv_size, d_mackey, d_mackey_size, d_cipherkey, d_cipherkey_size, attsize, d_filename, file.tellg());
-    reinterpret_cast<FrameWithAttachment *>(frame.get())->setReader(new AndroidAttachmentReader(d_iv, d_iv_size, d_mackey, d_mackey_size, d_cipherkey, d_cipherkey_size, attsize, d_filename, file.tellg()));
+    reinterpret_cast<FrameWithAttachment *>(frame.get())->setReader(new AndroidAttachmentReader(d_iv, d_iv_size, d_cryptcontext, attsize, d_filename, d_mappedfile, file.tellg()));
 
     file.seekg(attsize + MACSIZE, std::ios_base::cur);
   }
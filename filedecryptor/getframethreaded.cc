@@ -0,0 +1,88 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "filedecryptor.ih"
+
+/*
+  Returns the frames in order, as they come out of the scanner/worker
+  threads. After each frame, `file' is positioned at the start of the
+  next one, just like when reading sequentially.
+*/
+std::unique_ptr<BackupFrame> FileDecryptor::getFrameThreaded(std::ifstream &file)
+{
+  if (!d_threads)
+    startThreads(file.tellg());
+
+  std::unique_ptr<ThreadedFrame> f;
+  {
+    std::unique_lock<std::mutex> lock(d_threads->mutex);
+    d_threads->consumercv.wait(lock, [&](){ return !d_threads->queue.empty() && d_threads->queue.front()->done; });
+    f = std::move(d_threads->queue.front());
+    d_threads->queue.pop_front();
+    --d_threads->nextjob;
+  }
+  d_threads->scannercv.notify_one();
+
+  // a frame with a bad MAC is not parsed, so (as when reading sequentially) its
+  // attachment data, if any, is not skipped
+  file.seekg((f->badmac && f->attachmentsize > 0) ? f->attachmentpos : f->filepos);
+  d_threads->counter = f->badmac ? f->counter + 1 : f->nextcounter;
+  d_threads->framecount = f->badmac ? f->framenumber : f->nextframecount;
+
+  if (f->eof) [[unlikely]]
+  {
+    stopThreads();
+    return std::unique_ptr<BackupFrame>(nullptr);
+  }
+
+  if (!f->error.empty()) [[unlikely]]
+  {
+    Logger::error(f->error);
+    if (f->badlength && f->framenumber == 1)
+      Logger::message(Logger::Control::BOLD, " *** NOTE : IT IS LIKELY AN INCORRECT PASSPHRASE WAS PROVIDED ***", Logger::Control::NORMAL);
+    stopThreads();
+    return std::unique_ptr<BackupFrame>(nullptr);
+  }
+
+  unsigned char const *theirmac = f->encryptedframe + sizeof(uint32_t) + (f->encryptedframelength - MACSIZE);
+  if (f->badmac) [[unlikely]]
+  {
+    Logger::message("\n");
+    Logger::warning("Bad MAC in frame: theirMac: ", bepaald::bytesToHexString(theirmac, MACSIZE),
+                    "\n                              ourMac: ", bepaald::bytesToHexString(f->hash, SHA256_DIGEST_LENGTH));
+
+    if (f->framenumber == 1) [[unlikely]]
+      Logger::message(Logger::Control::BOLD, " *** NOTE : IT IS LIKELY AN INCORRECT PASSPHRASE WAS PROVIDED ***", Logger::Control::NORMAL);
+
+    d_badmac = true;
+    stopThreads();
+    return std::unique_ptr<BackupFrame>(nullptr);
+  }
+  d_badmac = false;
+
+  if (!f->frame) [[unlikely]]
+  {
+    Logger::error("Failed to get valid frame from decoded data...");
+    Logger::error_indent("Data was verified ok, but does not represent a valid frame... Don't know what happened, but it's bad... :(");
+    Logger::error_indent("Decrypted frame data: ", bepaald::bytesToHexString(f->decodedframe.get(), f->encryptedframelength - MACSIZE));
+    return std::make_unique<InvalidFrame>();
+  }
+
+  return std::move(f->frame);
+}
@@ -0,0 +1,99 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "filedecryptor.ih"
+
+/*
+  Runs in (possibly multiple) worker threads. Takes frames queued by the
+  scanner, checks their MAC, decrypts and parses the frame data and, for
+  frames carrying attachment data, sets up the reader for it.
+*/
+void FileDecryptor::processFrames()
+{
+  // own copy of the (keyed) contexts, for use in this thread
+  CryptContext cryptcontext(d_cryptcontext);
+  std::unique_ptr<unsigned char[]> iv(new unsigned char[d_iv_size]);
+  std::memcpy(iv.get(), d_iv, d_iv_size);
+
+  while (true)
+  {
+    ThreadedFrame *f = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(d_threads->mutex);
+      d_threads->workercv.wait(lock, [&](){ return d_threads->stop || d_threads->scandone ||
+                                                   d_threads->nextjob < d_threads->queue.size(); });
+      if (d_threads->stop ||
+          (d_threads->nextjob >= d_threads->queue.size() && d_threads->scandone))
+        return;
+      f = d_threads->queue[d_threads->nextjob++].get();
+    }
+
+    if (!f->eof && f->error.empty()) [[likely]]
+    {
+      // the MAC covers the encrypted frame length and the encrypted frame data
+      unsigned int const maclength = sizeof(uint32_t) + f->encryptedframelength - MACSIZE;
+      CryptContext::HmacCtx *hctx = cryptcontext.hmac();
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+      if (!hctx ||
+          EVP_MAC_update(hctx, f->encryptedframe, maclength) != 1 ||
+          EVP_MAC_final(hctx, f->hash, nullptr, SHA256_DIGEST_LENGTH) != 1) [[unlikely]]
+#else
+      unsigned int digest_size = SHA256_DIGEST_LENGTH;
+      if (!hctx ||
+          HMAC_Update(hctx, f->encryptedframe, maclength) != 1 ||
+          HMAC_Final(hctx, f->hash, &digest_size) != 1) [[unlikely]]
+#endif
+        f->error = "Failed to calculate MAC";
+      else if (std::memcmp(f->encryptedframe + maclength, f->hash, MACSIZE) != 0) [[unlikely]]
+        f->badmac = true;
+      else
+      {
+        // decrypt the frame data: the frame length and the data share the counter, so the
+        // (already known) length is run through the cipher first
+        uintToFourBytes(iv.get(), f->counter);
+        EVP_CIPHER_CTX *ctx = cryptcontext.cipher(iv.get());
+        uint32_t framelength = 0;
+        int framelength_size = sizeof(decltype(framelength));
+        int decodedframelength = f->encryptedframelength - MACSIZE;
+        f->decodedframe.reset(new unsigned char[decodedframelength]);
+        if (!ctx ||
+            EVP_DecryptUpdate(ctx, reinterpret_cast<unsigned char *>(&framelength), &framelength_size, f->encryptedframe, sizeof(decltype(framelength))) != 1 ||
+            EVP_DecryptUpdate(ctx, f->decodedframe.get(), &decodedframelength, f->encryptedframe + sizeof(decltype(framelength)),
+                              f->encryptedframelength - MACSIZE) != 1) [[unlikely]]
+          f->error = "Failed to decrypt data";
+        else
+        {
+          f->frame.reset(initBackupFrame(f->decodedframe.get(), decodedframelength, f->framenumber));
+          if (f->frame && f->attachmentsize > 0)
+          {
+            uintToFourBytes(iv.get(), f->counter + 1);
+            reinterpret_cast<FrameWithAttachment *>(f->frame.get())->setReader(new AndroidAttachmentReader(iv.get(), d_iv_size, d_cryptcontext, f->attachmentsize,
+                                                                                                           d_filename, d_mappedfile, f->attachmentpos));
+          }
+        }
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(d_threads->mutex);
+      f->done = true;
+    }
+    d_threads->consumercv.notify_one();
+  }
+}
@@ -0,0 +1,283 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "filedecryptor.ih"
+
+/*
+  Runs in its own thread. Reads the frames from the backup file one by one.
+  Only the frame length is decrypted here, and, for frames that carry
+  attachment data, just enough of the frame to find the size of the
+  attachment (it is needed to find the next frame). Checking the MAC,
+  decrypting the frame data and parsing it is left to the workers. The
+  CTR counter of every frame follows from the frame order, so the workers
+  can decrypt any frame on their own. If the file is mapped, the frames are
+  not copied, the workers get a pointer into the mapping.
+*/
+void FileDecryptor::scanFrames(uint64_t filepos)
+{
+  std::ifstream file;
+  if (!d_mappedfile)
+  {
+    file.open(d_filename, std::ios_base::binary | std::ios_base::in);
+    file.seekg(filepos);
+  }
+
+  CryptContext cryptcontext(d_cryptcontext); // own copy, for use in this thread
+  std::unique_ptr<unsigned char[]> iv(new unsigned char[d_iv_size]); // own iv, d_iv is not touched while the threads run
+  std::memcpy(iv.get(), d_iv, d_iv_size);
+
+  auto queueframe = [&](std::unique_ptr<ThreadedFrame> &&f)
+  {
+    // the counters as they would be after reading this frame sequentially
+    f->nextcounter = d_threads->scancounter;
+    f->nextframecount = d_threads->scanframecount;
+
+    bool last = f->eof || !f->error.empty();
+    {
+      std::lock_guard<std::mutex> lock(d_threads->mutex);
+      d_threads->queue.emplace_back(std::move(f));
+      if (last)
+        d_threads->scandone = true;
+    }
+    if (last)
+      d_threads->workercv.notify_all();
+    else
+      d_threads->workercv.notify_one();
+  };
+
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(d_threads->mutex);
+      d_threads->scannercv.wait(lock, [&](){ return d_threads->stop || d_threads->queue.size() < s_maxqueuedframes; });
+      if (d_threads->stop)
+        return;
+    }
+
+    std::unique_ptr<ThreadedFrame> f(new ThreadedFrame);
+    f->encryptedframe = nullptr;
+    f->encryptedframelength = 0;
+    f->framenumber = d_threads->scanframecount;
+    f->counter = d_threads->scancounter;
+    f->nextcounter = 0;
+    f->nextframecount = 0;
+    f->attachmentsize = 0;
+    f->attachmentpos = 0;
+    f->filepos = filepos;
+    f->badlength = false;
+    f->badmac = false;
+    f->eof = false;
+    f->done = false;
+
+    if (!d_mappedfile && !file.is_open()) [[unlikely]]
+    {
+      f->error = "Failed to open file '" + d_filename + "'";
+      queueframe(std::move(f));
+      return;
+    }
+
+    if (filepos == d_filesize) [[unlikely]]
+    {
+      f->eof = true;
+      queueframe(std::move(f));
+      return;
+    }
+
+    uint32_t encrypted_encryptedframelength = 0;
+    if (d_mappedfile) [[likely]]
+    {
+      if (filepos + sizeof(decltype(encrypted_encryptedframelength)) > d_mappedfile->size()) [[unlikely]]
+      {
+        f->error = "Failed to read " + bepaald::toString(sizeof(decltype(encrypted_encryptedframelength))) +
+          " bytes from file to get next frame size... (" + bepaald::toString(filepos) + " / " + bepaald::toString(d_filesize) + ")";
+        queueframe(std::move(f));
+        return;
+      }
+      std::memcpy(&encrypted_encryptedframelength, d_mappedfile->data() + filepos, sizeof(decltype(encrypted_encryptedframelength)));
+    }
+    else if (!file.read(reinterpret_cast<char *>(&encrypted_encryptedframelength), sizeof(decltype(encrypted_encryptedframelength)))) [[unlikely]]
+    {
+      f->error = "Failed to read " + bepaald::toString(sizeof(decltype(encrypted_encryptedframelength))) +
+        " bytes from file to get next frame size... (" + bepaald::toString(filepos) + " / " + bepaald::toString(d_filesize) + ")";
+      queueframe(std::move(f));
+      return;
+    }
+
+    // decrypt encrypted_encryptedframelength
+    uintToFourBytes(iv.get(), d_threads->scancounter++);
+    EVP_CIPHER_CTX *ctx = cryptcontext.cipher(iv.get());
+    if (!ctx) [[unlikely]]
+    {
+      f->error = "CTX INIT FAILED";
+      queueframe(std::move(f));
+      return;
+    }
+
+    uint32_t encryptedframelength = 0;
+    int encryptedframelength_size = sizeof(decltype(encryptedframelength));
+    if (EVP_DecryptUpdate(ctx, reinterpret_cast<unsigned char *>(&encryptedframelength), &encryptedframelength_size,
+                          reinterpret_cast<unsigned char *>(&encrypted_encryptedframelength),
+                          sizeof(decltype(encrypted_encryptedframelength))) != 1) [[unlikely]]
+    {
+      f->error = "Failed to decrypt data";
+      queueframe(std::move(f));
+      return;
+    }
+    encryptedframelength = bepaald::swap_endian<uint32_t>(encryptedframelength);
+
+    if (encryptedframelength > 115343360 /*110MB*/ || encryptedframelength < 11)
+    {
+      f->badlength = true;
+      f->error = "Failed to read next frame (" + bepaald::toString(encryptedframelength) + " bytes at filepos " + bepaald::toString(filepos) + ")";
+      queueframe(std::move(f));
+      return;
+    }
+
+    // get frame, the encrypted length is kept in front of it for calculating the MAC
+    f->encryptedframelength = encryptedframelength;
+    if (d_mappedfile) [[likely]]
+    {
+      if (filepos + sizeof(decltype(encrypted_encryptedframelength)) + encryptedframelength > d_mappedfile->size()) [[unlikely]]
+      {
+        f->error = "Failed to read next frame (" + bepaald::toString(encryptedframelength) + " bytes at filepos " + bepaald::toString(filepos) + ")";
+        queueframe(std::move(f));
+        return;
+      }
+      f->encryptedframe = d_mappedfile->data() + filepos;
+    }
+    else
+    {
+      f->encryptedframebuffer.reset(new unsigned char[encryptedframelength + sizeof(decltype(encrypted_encryptedframelength))]);
+      std::memcpy(f->encryptedframebuffer.get(), &encrypted_encryptedframelength, sizeof(decltype(encrypted_encryptedframelength)));
+      if (!file.read(reinterpret_cast<char *>(f->encryptedframebuffer.get() + sizeof(decltype(encrypted_encryptedframelength))), encryptedframelength)) [[unlikely]]
+      {
+        f->error = "Failed to read next frame (" + bepaald::toString(encryptedframelength) + " bytes at filepos " + bepaald::toString(filepos) + ")";
+        queueframe(std::move(f));
+        return;
+      }
+      f->encryptedframe = f->encryptedframebuffer.get();
+    }
+    filepos += sizeof(decltype(encrypted_encryptedframelength)) + encryptedframelength;
+    ++d_threads->scanframecount;
+
+    // frames with attachments need to be (partially) decoded here, to know the size of the
+    // attachment data to skip. The data is decrypted in small steps, only as far as needed.
+    unsigned char const *encrypteddata = f->encryptedframe + sizeof(decltype(encrypted_encryptedframelength));
+    unsigned int const datalength = encryptedframelength - MACSIZE;
+    std::vector<unsigned char> prefix;
+    auto decryptprefix = [&](unsigned int needed)
+    {
+      needed = std::min(needed, datalength);
+      unsigned int const have = prefix.size();
+      if (needed <= have)
+        return true;
+      prefix.resize(needed);
+      int outlength = needed - have;
+      return EVP_DecryptUpdate(ctx, prefix.data() + have, &outlength, encrypteddata + have, needed - have) == 1;
+    };
+    if (!decryptprefix(1)) [[unlikely]]
+    {
+      f->error = "Failed to decrypt data";
+      queueframe(std::move(f));
+      return;
+    }
+
+    int fieldnum = BackupFrame::getFieldnumber(prefix[0]);
+    if (fieldnum == BackupFrame::FRAMETYPE::ATTACHMENT ||
+        fieldnum == BackupFrame::FRAMETYPE::AVATAR ||
+        fieldnum == BackupFrame::FRAMETYPE::STICKER)
+    {
+      // the length field of the (embedded) attachment-, avatar- or stickerframe
+      unsigned int const lengthfield = (fieldnum == BackupFrame::FRAMETYPE::ATTACHMENT) ? 3 : 2;
+
+      // walk the fields of the embedded message, only decrypting what is needed
+      uint32_t attsize = 0;
+      unsigned int pos = 1;
+      if (!decryptprefix(pos + 10)) [[unlikely]] // max size of varint
+      {
+        f->error = "Failed to decrypt data";
+        queueframe(std::move(f));
+        return;
+      }
+      int64_t messagelength = BackupFrame::getLength(prefix.data(), &pos, prefix.size());
+      uint64_t messageend = pos + messagelength;
+      while (messagelength >= 0 && pos < messageend && pos < datalength)
+      {
+        if (!decryptprefix(pos + 1 + 10)) [[unlikely]] // field header + varint
+        {
+          f->error = "Failed to decrypt data";
+          queueframe(std::move(f));
+          return;
+        }
+        int field = BackupFrame::getFieldnumber(prefix[pos]);
+        unsigned int wiretype = BackupFrame::wiretype(prefix[pos]);
+        ++pos;
+        if (field < 0) [[unlikely]]
+          break;
+        if (wiretype == BackupFrame::WIRETYPE::VARINT)
+        {
+          int64_t value = BackupFrame::getVarint(prefix.data(), &pos, prefix.size());
+          if (value < 0) [[unlikely]]
+            break;
+          if (static_cast<unsigned int>(field) == lengthfield)
+          {
+            attsize = value;
+            break;
+          }
+        }
+        else if (wiretype == BackupFrame::WIRETYPE::LENGTHDELIM)
+        {
+          int64_t fieldlength = BackupFrame::getLength(prefix.data(), &pos, prefix.size());
+          if (fieldlength < 0) [[unlikely]]
+            break;
+          pos += fieldlength;
+        }
+        else if (wiretype == BackupFrame::WIRETYPE::FIXED64)
+          pos += 8;
+        else if (wiretype == BackupFrame::WIRETYPE::FIXED32)
+          pos += 4;
+        else [[unlikely]]
+          break;
+      }
+
+      if (attsize > 0)
+      {
+        if (attsize + filepos > d_filesize) [[unlikely]]
+          if (!d_assumebadframesize)
+          {
+            f->error = "Unexpectedly hit end of file while reading attachment!";
+            queueframe(std::move(f));
+            return;
+          }
+
+        // the reader for the attachment data is set up by the worker, after checking the MAC
+        f->attachmentsize = attsize;
+        f->attachmentpos = filepos;
+        ++d_threads->scancounter;
+
+        filepos += attsize + MACSIZE;
+        if (!d_mappedfile)
+          file.seekg(filepos);
+      }
+    }
+
+    f->filepos = filepos;
+    queueframe(std::move(f));
+  }
+}
@@ -0,0 +1,62 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "filedecryptor.ih"
+
+void FileDecryptor::startThreads(uint64_t filepos)
+{
+  d_threads.reset(new FrameThreads);
+  d_threads->nextjob = 0;
+  d_threads->stop = false;
+  d_threads->scandone = false;
+  d_threads->scancounter = d_threads->counter = d_counter;
+  d_threads->scanframecount = d_threads->framecount = d_framecount;
+
+  // one thread reads the frames from file and decrypts their length (it
+  // needs it to find the start of the next frame), the others check the
+  // MAC, decrypt and parse the frame data.
+  d_threads->scanner = std::thread(&FileDecryptor::scanFrames, this, filepos);
+  for (unsigned int i = 0; i < d_numthreads - 1; ++i)
+    d_threads->workers.emplace_back(&FileDecryptor::processFrames, this);
+}
+
+void FileDecryptor::stopThreads()
+{
+  if (!d_threads)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(d_threads->mutex);
+    d_threads->stop = true;
+  }
+  d_threads->scannercv.notify_all();
+  d_threads->workercv.notify_all();
+
+  if (d_threads->scanner.joinable())
+    d_threads->scanner.join();
+  for (auto &w : d_threads->workers)
+    if (w.joinable())
+      w.join();
+
+  // the scanner ran ahead, continue after the last frame that was actually returned
+  d_counter = d_threads->counter;
+  d_framecount = d_threads->framecount;
+
+  d_threads.reset();
+}
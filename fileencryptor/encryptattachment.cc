@@ -24,79 +24,117 @@ std::pair<unsigned char *, uint64_t> FileEncryptor::encryptAttachment(unsigned c
   if (!d_ok)
     return {nullptr, 0};
 
-  if (length == 0) [[unlikely]]
-  {
-    Logger::warning("Asked to encrypt a zero sized attachment.");
-    //return {nullptr, 0};
-  }
-
   if (d_verbose) [[unlikely]]
     Logger::message_start("Encrypting attachment. Length: ", length, "...");
 
+  std::unique_ptr<unsigned char[]> encryptedframe(new unsigned char[length + MACSIZE]);
+  if (!encryptAttachmentStart(length) ||
+      !encryptAttachmentUpdate(data, length, encryptedframe.get()) ||
+      !encryptAttachmentFinal(encryptedframe.get() + length)) [[unlikely]]
+    return {nullptr, 0};
+
+  if (d_verbose) [[unlikely]]
+    Logger::message_end("done!");
+
+  return {encryptedframe.release(), length + MACSIZE};
+}
+
+/*
+  Encrypting an attachment in parts: call encryptAttachmentStart() once,
+  then encryptAttachmentUpdate() for every consecutive part of the data,
+  and finally encryptAttachmentFinal() to get the MACSIZE bytes of MAC
+  that follow the data in the backup file. Data may be encrypted in place
+  (data == out).
+*/
+bool FileEncryptor::encryptAttachmentStart(uint64_t length)
+{
+  if (!d_ok)
+    return false;
+
+  if (length == 0) [[unlikely]]
+    Logger::warning("Asked to encrypt a zero sized attachment.");
+
   // update iv:
   uintToFourBytes(d_iv, d_counter++);
 
   // encryption context
-  std::unique_ptr<EVP_CIPHER_CTX, decltype(&::EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), &::EVP_CIPHER_CTX_free);
+  d_attachmentcipher = d_cryptcontext.cipher(d_iv);
+  if (!d_attachmentcipher) [[unlikely]]
+  {
+    Logger::error("CTX INIT FAILED");
+    return false;
+  }
 
-  // disable padding
-  EVP_CIPHER_CTX_set_padding(ctx.get(), 0);
+  // mac context
+  d_attachmenthmac = d_cryptcontext.hmac();
+  if (!d_attachmenthmac) [[unlikely]]
+  {
+    Logger::error("Failed to initialize HMAC");
+    return false;
+  }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  if (EVP_MAC_update(d_attachmenthmac, d_iv, d_iv_size) != 1) [[unlikely]]
+#else
+  if (HMAC_Update(d_attachmenthmac, d_iv, d_iv_size) != 1) [[unlikely]]
+#endif
+  {
+    Logger::error("Failed to update hmac");
+    return false;
+  }
+  return true;
+}
 
-  if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_ctr(), nullptr, d_cipherkey, d_iv) != 1) [[unlikely]]
+bool FileEncryptor::encryptAttachmentUpdate(unsigned char const *data, uint64_t length, unsigned char *out)
+{
+  if (!d_attachmentcipher || !d_attachmenthmac) [[unlikely]]
   {
-    Logger::error("CTX INIT FAILED");
-    return {nullptr, 0};
+    Logger::error("Attachment encryption was not started");
+    return false;
   }
 
-  std::unique_ptr<unsigned char[]> encryptedframe(new unsigned char[length + MACSIZE]);
   int l = static_cast<int>(length);
-  if (EVP_EncryptUpdate(ctx.get(), encryptedframe.get(), &l, data, length) != 1) [[unlikely]]
+  if (EVP_EncryptUpdate(d_attachmentcipher, out, &l, data, length) != 1) [[unlikely]]
   {
     Logger::error("ENCRYPT FAILED");
-    return {nullptr, 0};
+    return false;
   }
 
-  // calc mac
 #if OPENSSL_VERSION_NUMBER >= 0x30000000L
-  unsigned long int digest_size = SHA256_DIGEST_LENGTH;
-  unsigned char hash[SHA256_DIGEST_LENGTH];
-  std::unique_ptr<EVP_MAC, decltype(&::EVP_MAC_free)> mac(EVP_MAC_fetch(nullptr, "hmac", nullptr), &::EVP_MAC_free);
-  std::unique_ptr<EVP_MAC_CTX, decltype(&::EVP_MAC_CTX_free)> hctx(EVP_MAC_CTX_new(mac.get()), &::EVP_MAC_CTX_free);
-  char digest[] = "SHA256";
-  OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string("digest", digest, 0), OSSL_PARAM_construct_end()};
-  if (EVP_MAC_init(hctx.get(), d_mackey, d_mackey_size, params) != 1) [[unlikely]]
+  if (EVP_MAC_update(d_attachmenthmac, out, length) != 1) [[unlikely]]
+#else
+  if (HMAC_Update(d_attachmenthmac, out, length) != 1) [[unlikely]]
+#endif
   {
-    Logger::error("Failed to initialize HMAC");
-    return {nullptr, 0};
+    Logger::error("Failed to update hmac");
+    return false;
   }
-  if (EVP_MAC_update(hctx.get(), d_iv, d_iv_size) != 1 ||
-      EVP_MAC_update(hctx.get(), encryptedframe.get(), length) != 1 ||
-      EVP_MAC_final(hctx.get(), hash, nullptr, digest_size) != 1) [[unlikely]]
+  return true;
+}
+
+bool FileEncryptor::encryptAttachmentFinal(unsigned char *mac)
+{
+  if (!d_attachmentcipher || !d_attachmenthmac) [[unlikely]]
   {
-    Logger::error("Failed to update/finalize hmac");
-    return {nullptr, 0};
+    Logger::error("Attachment encryption was not started");
+    return false;
   }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  unsigned long int digest_size = SHA256_DIGEST_LENGTH;
+  unsigned char hash[SHA256_DIGEST_LENGTH];
+  if (EVP_MAC_final(d_attachmenthmac, hash, nullptr, digest_size) != 1) [[unlikely]]
 #else
   unsigned int digest_size = SHA256_DIGEST_LENGTH;
   unsigned char hash[SHA256_DIGEST_LENGTH];
-  std::unique_ptr<HMAC_CTX, decltype(&::HMAC_CTX_free)> hctx(HMAC_CTX_new(), &::HMAC_CTX_free);
-  if (HMAC_Init_ex(hctx.get(), d_mackey, d_mackey_size, EVP_sha256(), nullptr) != 1) [[unlikely]]
-  {
-    Logger::error("Failed to initialize HMAC context");
-    return {nullptr, 0};
-  }
-  if (HMAC_Update(hctx.get(), d_iv, d_iv_size) != 1 ||
-      HMAC_Update(hctx.get(), encryptedframe.get(), length) != 1 ||
-      HMAC_Final(hctx.get(), hash, &digest_size) != 1) [[unlikely]]
+  if (HMAC_Final(d_attachmenthmac, hash, &digest_size) != 1) [[unlikely]]
+#endif
   {
-    Logger::error("Failed to update/finalize hmac");
-    return {nullptr, 0};
+    Logger::error("Failed to finalize hmac");
+    return false;
   }
-#endif
-  std::memcpy(encryptedframe.get() + length, hash, 10);
+  std::memcpy(mac, hash, MACSIZE);
 
-  if (d_verbose) [[unlikely]]
-    Logger::message_end("done!");
-
-  return {encryptedframe.release(), length + MACSIZE};
+  d_attachmentcipher = nullptr;
+  d_attachmenthmac = nullptr;
+  return true;
 }
@@ -34,12 +34,8 @@ std::pair<unsigned char *, uint64_t> FileEncryptor::encryptFrame(unsigned char *
   uintToFourBytes(d_iv, d_counter++);
 
   // encryption context
-  std::unique_ptr<EVP_CIPHER_CTX, decltype(&::EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), &::EVP_CIPHER_CTX_free);
-
-  // disable padding
-  EVP_CIPHER_CTX_set_padding(ctx.get(), 0);
-
-  if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_ctr(), nullptr, d_cipherkey, d_iv) != 1)
+  EVP_CIPHER_CTX *ctx = d_cryptcontext.cipher(d_iv);
+  if (!ctx)
   {
     Logger::error("CTX INIT FAILED");
     return {nullptr, 0};
@@ -57,7 +53,7 @@ std::pair<unsigned char *, uint64_t> FileEncryptor::encryptFrame(unsigned char *
     if (d_verbose) [[unlikely]]
       Logger::message_start("Encrypting frame. Length: ", length, ", +macsize: ", (length + MACSIZE), ", swap_endian: ", length_data, " -> ");
 
-    if (EVP_EncryptUpdate(ctx.get(), encryptedframe.get(), &l, reinterpret_cast<unsigned char *>(&length_data), sizeof(uint32_t)) != 1)
+    if (EVP_EncryptUpdate(ctx, encryptedframe.get(), &l, reinterpret_cast<unsigned char *>(&length_data), sizeof(uint32_t)) != 1)
     {
       Logger::error("ENCRYPT FAILED");
       return {nullptr, 0};
@@ -77,19 +73,31 @@ std::pair<unsigned char *, uint64_t> FileEncryptor::encryptFrame(unsigned char *
   }
 
   int l = static_cast<int>(length);
-  if (EVP_EncryptUpdate(ctx.get(), encryptedframe.get() + encryptedframepos, &l, data, length) != 1)
+  if (EVP_EncryptUpdate(ctx, encryptedframe.get() + encryptedframepos, &l, data, length) != 1)
   {
     Logger::error("ENCRYPT FAILED");
     return {nullptr, 0};
   }
 
   // calc mac
-  unsigned int digest_size = SHA256_DIGEST_LENGTH;
   unsigned char hash[SHA256_DIGEST_LENGTH];
-  HMAC(EVP_sha256(), d_mackey, d_mackey_size,
-       encryptedframe.get() + (d_backupfileversion >= 1 ? 0 : sizeof(uint32_t)),
-       length + (d_backupfileversion >= 1 ? sizeof(uint32_t) : 0),
-       hash, &digest_size);
+  CryptContext::HmacCtx *hctx = d_cryptcontext.hmac();
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  if (!hctx ||
+      EVP_MAC_update(hctx, encryptedframe.get() + (d_backupfileversion >= 1 ? 0 : sizeof(uint32_t)),
+                     length + (d_backupfileversion >= 1 ? sizeof(uint32_t) : 0)) != 1 ||
+      EVP_MAC_final(hctx, hash, nullptr, SHA256_DIGEST_LENGTH) != 1) [[unlikely]]
+#else
+  unsigned int digest_size = SHA256_DIGEST_LENGTH;
+  if (!hctx ||
+      HMAC_Update(hctx, encryptedframe.get() + (d_backupfileversion >= 1 ? 0 : sizeof(uint32_t)),
+                  length + (d_backupfileversion >= 1 ? sizeof(uint32_t) : 0)) != 1 ||
+      HMAC_Final(hctx, hash, &digest_size) != 1) [[unlikely]]
+#endif
+  {
+    Logger::error("Failed to calculate hmac");
+    return {nullptr, 0};
+  }
   std::memcpy(encryptedframe.get() + sizeof(uint32_t) + length, hash, 10);
 
   //std::cout << "                                   : " << bepaald::bytesToHexString(hash, digest_size) << std::endl;
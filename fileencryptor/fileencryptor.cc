@@ -23,7 +23,9 @@ FileEncryptor::FileEncryptor(std::string const &passphrase, unsigned char const
   :
   CryptBase(verbose),
   d_passphrase(passphrase),
-  d_backupfileversion(backupfileversion)
+  d_backupfileversion(backupfileversion),
+  d_attachmentcipher(nullptr),
+  d_attachmenthmac(nullptr)
 {
   d_ok = init(salt, salt_size, iv, iv_size);
 }
@@ -32,11 +34,15 @@ FileEncryptor::FileEncryptor(std::string const &passphrase, uint32_t backupfilev
   :
   CryptBase(verbose),
   d_passphrase(passphrase),
-  d_backupfileversion(backupfileversion)
+  d_backupfileversion(backupfileversion),
+  d_attachmentcipher(nullptr),
+  d_attachmenthmac(nullptr)
 {}
 
 FileEncryptor::FileEncryptor()
   :
   CryptBase(false),
-  d_backupfileversion(-1)
+  d_backupfileversion(-1),
+  d_attachmentcipher(nullptr),
+  d_attachmenthmac(nullptr)
 {}
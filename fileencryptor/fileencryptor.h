@@ -30,6 +30,9 @@ class FileEncryptor : public CryptBase
 {
   std::string d_passphrase;
   uint32_t d_backupfileversion;
+  // working contexts (owned by d_cryptcontext) while encrypting an attachment in parts
+  EVP_CIPHER_CTX *d_attachmentcipher;
+  CryptContext::HmacCtx *d_attachmenthmac;
  public:
   FileEncryptor(std::string const &passphrase, unsigned char const *salt, uint64_t salt_size, unsigned char const *iv, uint64_t iv_size, uint32_t backupfileversion, bool verbose);
   explicit FileEncryptor(std::string const &passphrase, uint32_t backupfileversion, bool verbose);
@@ -44,13 +47,20 @@ class FileEncryptor : public CryptBase
   inline std::pair<unsigned char *, uint64_t> encryptFrame(std::pair<unsigned char *, uint64_t> const &data);
   std::pair<unsigned char *, uint64_t> encryptFrame(unsigned char *data, uint64_t length);
   std::pair<unsigned char *, uint64_t> encryptAttachment(unsigned char *data, uint64_t length);
+  bool encryptAttachmentStart(uint64_t length);
+  bool encryptAttachmentUpdate(unsigned char const *data, uint64_t length, unsigned char *out);
+  bool encryptAttachmentFinal(unsigned char *mac);
+  inline uint64_t counter() const;
+  inline void setCounter(uint64_t counter);
 };
 
 inline FileEncryptor::FileEncryptor(FileEncryptor const &other)
   :
   CryptBase(other),
   d_passphrase(other.d_passphrase),
-  d_backupfileversion(other.d_backupfileversion)
+  d_backupfileversion(other.d_backupfileversion),
+  d_attachmentcipher(nullptr),
+  d_attachmenthmac(nullptr)
 {}
 
 inline FileEncryptor &FileEncryptor::operator=(FileEncryptor const &other)
@@ -60,6 +70,8 @@ inline FileEncryptor &FileEncryptor::operator=(FileEncryptor const &other)
     CryptBase::operator=(other);
     d_passphrase = other.d_passphrase;
     d_backupfileversion = other.d_backupfileversion;
+    d_attachmentcipher = nullptr;
+    d_attachmenthmac = nullptr;
   }
   return *this;
 }
@@ -68,7 +80,9 @@ inline FileEncryptor::FileEncryptor(FileEncryptor &&other)
   :
   CryptBase(std::move(other)),
   d_passphrase(std::move(other.d_passphrase)),
-  d_backupfileversion(std::move(other.d_backupfileversion))
+  d_backupfileversion(std::move(other.d_backupfileversion)),
+  d_attachmentcipher(nullptr),
+  d_attachmenthmac(nullptr)
 {}
 
 inline FileEncryptor &FileEncryptor::operator=(FileEncryptor &&other)
@@ -78,6 +92,8 @@ inline FileEncryptor &FileEncryptor::operator=(FileEncryptor &&other)
     CryptBase::operator=(other);
     d_passphrase = std::move(other.d_passphrase);
     d_backupfileversion = std::move(other.d_backupfileversion);
+    d_attachmentcipher = nullptr;
+    d_attachmenthmac = nullptr;
   }
   return *this;
 }
@@ -100,4 +116,14 @@ inline std::pair<unsigned char *, uint64_t> FileEncryptor::encryptFrame(std::pai
   return encryptFrame(data.first.get(), data.second);
 }
 
+inline uint64_t FileEncryptor::counter() const
+{
+  return d_counter;
+}
+
+inline void FileEncryptor::setCounter(uint64_t counter)
+{
+  d_counter = counter;
+}
+
 #endif
@@ -50,6 +50,12 @@ bool FileEncryptor::init(unsigned char const *salt, uint64_t salt_size, unsigned
     return false;
   }
 
+  if (!d_cryptcontext.initCipher(EVP_aes_256_ctr(), d_cipherkey, true))
+  {
+    Logger::error("Failed to initialize cipher context");
+    return false;
+  }
+
   DEBUGOUT("IV: ", bepaald::bytesToHexString(d_iv, d_iv_size));
   DEBUGOUT("SALT: ", bepaald::bytesToHexString(d_salt, d_salt_size));
   DEBUGOUT("BACKUPKEY: ", bepaald::bytesToHexString(d_backupkey, d_backupkey_size));
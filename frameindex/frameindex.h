@@ -0,0 +1,217 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FRAMEINDEX_H_
+#define FRAMEINDEX_H_
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// A sorted, flat map of Key -> owned frame. Attachment and sticker frames are
+// read in (roughly) key order and then mostly looked up, so a contiguous
+// vector with binary search beats a node based std::map on both memory and
+// lookup speed. The interface mirrors the bits of std::map that are used.
+//
+// Note: keys must not be modified through iterators, use rekey() to change
+// keys in bulk. Frames are deep-copied when the index is copied.
+template <typename Key, typename T>
+class FrameIndex
+{
+ public:
+  using key_type = Key;
+  using value_type = std::pair<Key, std::unique_ptr<T>>;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+ private:
+  std::vector<value_type> d_data;
+
+ public:
+  inline FrameIndex() = default;
+  inline FrameIndex(FrameIndex const &other);
+  inline FrameIndex &operator=(FrameIndex const &other);
+  inline FrameIndex(FrameIndex &&other) = default;
+  inline FrameIndex &operator=(FrameIndex &&other) = default;
+
+  inline iterator begin() { return d_data.begin(); }
+  inline iterator end() { return d_data.end(); }
+  inline const_iterator begin() const { return d_data.begin(); }
+  inline const_iterator end() const { return d_data.end(); }
+  inline size_t size() const { return d_data.size(); }
+  inline bool empty() const { return d_data.empty(); }
+  inline void clear() { d_data.clear(); }
+  inline void reserve(size_t n) { d_data.reserve(n); }
+
+  inline iterator find(Key const &key);
+  inline const_iterator find(Key const &key) const;
+  inline bool contains(Key const &key) const;
+  inline std::unique_ptr<T> &at(Key const &key);
+  inline std::unique_ptr<T> const &at(Key const &key) const;
+
+  // like std::map::emplace: takes ownership of the frame, which is
+  // deleted if the key is already present
+  template <typename K, typename P>
+  inline std::pair<iterator, bool> emplace(K &&key, P &&frame);
+  template <typename K, typename P>
+  inline std::pair<iterator, bool> emplace(std::pair<K, P> &&keyframe);
+
+  inline iterator erase(const_iterator pos);
+  inline size_t erase(Key const &key);
+  template <typename Pred>
+  inline size_t erase_if(Pred pred);
+
+  // calls func(Key &, T *) for every entry, which may change the key (and
+  // the frame). Afterwards, the index is resorted. If keys collide, only one
+  // of the frames is kept.
+  template <typename Func>
+  inline void rekey(Func func);
+
+ private:
+  inline const_iterator lowerBound(Key const &key) const;
+};
+
+template <typename Key, typename T>
+inline FrameIndex<Key, T>::FrameIndex(FrameIndex const &other)
+{
+  d_data.reserve(other.d_data.size());
+  for (auto const &[key, frame] : other.d_data)
+    d_data.emplace_back(key, std::unique_ptr<T>(frame ? frame->clone() : nullptr));
+}
+
+template <typename Key, typename T>
+inline FrameIndex<Key, T> &FrameIndex<Key, T>::operator=(FrameIndex const &other)
+{
+  if (this != &other) [[likely]]
+  {
+    FrameIndex tmp(other);
+    d_data = std::move(tmp.d_data);
+  }
+  return *this;
+}
+
+template <typename Key, typename T>
+inline typename FrameIndex<Key, T>::const_iterator FrameIndex<Key, T>::lowerBound(Key const &key) const
+{
+  return std::lower_bound(d_data.begin(), d_data.end(), key,
+                          [](value_type const &v, Key const &k) { return v.first < k; });
+}
+
+template <typename Key, typename T>
+inline typename FrameIndex<Key, T>::const_iterator FrameIndex<Key, T>::find(Key const &key) const
+{
+  const_iterator it = lowerBound(key);
+  return (it != d_data.end() && it->first == key) ? it : d_data.end();
+}
+
+template <typename Key, typename T>
+inline typename FrameIndex<Key, T>::iterator FrameIndex<Key, T>::find(Key const &key)
+{
+  return d_data.begin() + (std::as_const(*this).find(key) - d_data.cbegin());
+}
+
+template <typename Key, typename T>
+inline bool FrameIndex<Key, T>::contains(Key const &key) const
+{
+  return find(key) != d_data.end();
+}
+
+template <typename Key, typename T>
+inline std::unique_ptr<T> const &FrameIndex<Key, T>::at(Key const &key) const
+{
+  const_iterator it = find(key);
+  if (it == d_data.end()) [[unlikely]]
+    throw std::out_of_range("FrameIndex::at");
+  return it->second;
+}
+
+template <typename Key, typename T>
+inline std::unique_ptr<T> &FrameIndex<Key, T>::at(Key const &key)
+{
+  return const_cast<std::unique_ptr<T> &>(std::as_const(*this).at(key));
+}
+
+template <typename Key, typename T>
+template <typename K, typename P>
+inline std::pair<typename FrameIndex<Key, T>::iterator, bool> FrameIndex<Key, T>::emplace(K &&key, P &&frame)
+{
+  Key k(std::forward<K>(key));
+  std::unique_ptr<T> f(std::forward<P>(frame));
+
+  // frames are mostly added in order, appending is the common case
+  if (d_data.empty() || d_data.back().first < k) [[likely]]
+  {
+    d_data.emplace_back(std::move(k), std::move(f));
+    return {std::prev(d_data.end()), true};
+  }
+
+  iterator it = d_data.begin() + (lowerBound(k) - d_data.cbegin());
+  if (it->first == k)
+    return {it, false};
+  return {d_data.emplace(it, std::move(k), std::move(f)), true};
+}
+
+template <typename Key, typename T>
+template <typename K, typename P>
+inline std::pair<typename FrameIndex<Key, T>::iterator, bool> FrameIndex<Key, T>::emplace(std::pair<K, P> &&keyframe)
+{
+  return emplace(std::move(keyframe.first), std::move(keyframe.second));
+}
+
+template <typename Key, typename T>
+inline typename FrameIndex<Key, T>::iterator FrameIndex<Key, T>::erase(const_iterator pos)
+{
+  return d_data.erase(pos);
+}
+
+template <typename Key, typename T>
+inline size_t FrameIndex<Key, T>::erase(Key const &key)
+{
+  const_iterator it = find(key);
+  if (it == d_data.end())
+    return 0;
+  d_data.erase(it);
+  return 1;
+}
+
+template <typename Key, typename T>
+template <typename Pred>
+inline size_t FrameIndex<Key, T>::erase_if(Pred pred)
+{
+  return std::erase_if(d_data, pred);
+}
+
+template <typename Key, typename T>
+template <typename Func>
+inline void FrameIndex<Key, T>::rekey(Func func)
+{
+  for (auto &[key, frame] : d_data)
+    func(key, frame.get());
+
+  auto keyless = [](value_type const &a, value_type const &b) { return a.first < b.first; };
+  if (!std::is_sorted(d_data.begin(), d_data.end(), keyless)) [[unlikely]]
+    std::sort(d_data.begin(), d_data.end(), keyless);
+  d_data.erase(std::unique(d_data.begin(), d_data.end(),
+                           [](value_type const &a, value_type const &b) { return a.first == b.first; }),
+               d_data.end());
+}
+
+#endif
@@ -20,6 +20,7 @@
 #ifndef FRAMEWITHATTACHMENT_H_
 #define FRAMEWITHATTACHMENT_H_
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include <fstream>
@@ -51,6 +52,8 @@ class FrameWithAttachment : public BackupFrame
   inline void setReader(BaseAttachmentReader *reader);
   inline BaseAttachmentReader *reader() const;
   inline unsigned char *attachmentData(bool *badmac = nullptr, bool verbose = false);
+  inline int streamAttachmentData(BaseAttachmentReader::Sink const &sink, bool verbose = false);
+  inline int checkAttachmentMac(bool verbose = false);
   inline void clearData();
 };
 
@@ -196,6 +199,47 @@ inline unsigned char *FrameWithAttachment::attachmentData(bool *badmac, bool ver
   return d_attachmentdata;
 }
 
+/*
+  Passes the attachment data to 'sink' without loading it into memory
+  entirely (if the reader supports it, otherwise the data is loaded and
+  passed in one go). Returns 0 on success, 1 on error, -1 on bad mac (in
+  which case, when streaming, the (bad) data has already been passed on).
+*/
+inline int FrameWithAttachment::streamAttachmentData(BaseAttachmentReader::Sink const &sink, bool verbose)
+{
+  if (d_attachmentdata || !d_attachmentreader || !d_attachmentreader->canStream())
+  {
+    bool badmac = false;
+    unsigned char *data = attachmentData(&badmac, verbose);
+    if (!data)
+      return badmac ? -1 : 1;
+
+    // the sink may modify the data it gets, so pass it copies
+    uint32_t const BUFFERSIZE = 8 * 1024;
+    unsigned char buffer[BUFFERSIZE];
+    for (uint32_t processed = 0; processed < d_attachmentdata_size; processed += BUFFERSIZE)
+    {
+      uint32_t size = std::min(d_attachmentdata_size - processed, BUFFERSIZE);
+      std::memcpy(buffer, data + processed, size);
+      if (!sink(buffer, size))
+        return 1;
+    }
+    return 0;
+  }
+  return d_attachmentreader->streamAttachment(sink, verbose);
+}
+
+/*
+  Verifies the attachment data (if it would be streamed) without
+  passing it anywhere. Returns 0 if ok, 1 on error, -1 on bad mac.
+*/
+inline int FrameWithAttachment::checkAttachmentMac(bool verbose)
+{
+  if (d_attachmentdata || !d_attachmentreader || !d_attachmentreader->canStream())
+    return 0; // loading the data (in streamAttachmentData()) checks the mac before any of it is passed on
+  return d_attachmentreader->checkMac(verbose);
+}
+
 inline void FrameWithAttachment::clearData()
 {
   if (d_noclear) [[unlikely]]
@@ -31,6 +31,7 @@
 #include <iomanip>
 #include <ctime>
 #include <algorithm>
+#include <mutex>
 
 #if defined(_WIN32) || defined(__MINGW64__)
 #include <windows.h>
@@ -78,6 +79,7 @@ class Logger
 
  private:
   static std::unique_ptr<Logger> s_instance;
+  static std::recursive_mutex s_mutex; // messages may come from multiple threads
   std::ofstream *d_file;
   std::ostringstream *d_strstreambackend;
   std::basic_ostream<std::ofstream::char_type, std::ofstream::traits_type> *d_currentoutput;
@@ -258,6 +260,7 @@ inline void Logger::messagePre() //static
 
 inline void Logger::setFile(std::string const &f) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   ensureLogger();
   if (s_instance->d_file)
     return;
@@ -273,6 +276,7 @@ inline void Logger::setFile(std::string const &f) // static
 
 inline void Logger::setTimestamp(bool val) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   ensureLogger();
   s_instance->d_usetimestamps = val;
   firstUse();
@@ -281,6 +285,7 @@ inline void Logger::setTimestamp(bool val) // static
 template <typename First, typename... Rest>
 inline void Logger::message_overwrite(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   ensureLogger();
   firstUse();
 
@@ -298,6 +303,7 @@ inline void Logger::message_overwrite(First const &f, Rest... r) // static
 template <typename First, typename... Rest>
 inline void Logger::message(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   messagePre();
   //outputHead("[MESSAGE] ", "[MESSAGE] ");
   s_instance->outputHead("", false, {"", ": "});
@@ -307,6 +313,7 @@ inline void Logger::message(First const &f, Rest... r) // static
 template <typename First, typename... Rest>
 inline void Logger::message_start(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   messagePre();
   s_instance->d_dangling = true;
   //outputHead("[MESSAGE] ", "[MESSAGE] ");
@@ -316,12 +323,14 @@ inline void Logger::message_start(First const &f, Rest... r) // static
 
 inline void Logger::message_start() // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   message_start("");
 }
 
 template <typename First, typename... Rest>
 inline void Logger::message_continue(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   s_instance->outputHead("", false, {"", ": "});
   s_instance->outputMsg(Flags::NONEWLINE, f, r...);
 }
@@ -329,6 +338,7 @@ inline void Logger::message_continue(First const &f, Rest... r) // static
 template <typename First, typename... Rest>
 inline void Logger::message_end(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   s_instance->d_dangling = false;
   s_instance->outputHead("", false, {"", ": "});
   s_instance->outputMsg(Flags::NONE, f, r...);
@@ -336,6 +346,7 @@ inline void Logger::message_end(First const &f, Rest... r) // static
 
 inline void Logger::message_end() // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   s_instance->d_dangling = false;
   message("");
 }
@@ -343,6 +354,7 @@ inline void Logger::message_end() // static
 template <typename First, typename... Rest>
 inline void Logger::warning(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   messagePre();
   //outputHead("[WARNING] ", "[\033[38;5;37mWARNING\033[0m] ");
   s_instance->outputHead("Warning", false, {"[", "]: "}, std::make_pair<std::string, std::string>("\033[1m", "\033[0m"));
@@ -352,6 +364,7 @@ inline void Logger::warning(First const &f, Rest... r) // static
 template <typename First, typename... Rest>
 inline void Logger::warning_start(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   messagePre();
   s_instance->outputHead("Warning", false, {"[", "]: "}, std::make_pair<std::string, std::string>("\033[1m", "\033[0m"));
   s_instance->outputMsg(Flags::NONEWLINE, f, r...);
@@ -360,6 +373,7 @@ inline void Logger::warning_start(First const &f, Rest... r) // static
 template <typename First, typename... Rest>
 inline void Logger::warning_indent(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   messagePre();
   s_instance->outputHead("       ", false, {" ", "   "});
   s_instance->outputMsg(Flags::NONE, f, r...);
@@ -368,6 +382,7 @@ inline void Logger::warning_indent(First const &f, Rest... r) // static
 template <typename First, typename... Rest>
 inline void Logger::error(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   messagePre();
   //outputHead("[ ERROR ] ", "[ \033[1;31mERROR\033[0m ] ");
   s_instance->outputHead("Error", false, {"[", "]: "}, std::make_pair<std::string, std::string>("\033[1m", "\033[0m"));
@@ -377,6 +392,7 @@ inline void Logger::error(First const &f, Rest... r) // static
 template <typename First, typename... Rest>
 inline void Logger::error_start(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   messagePre();
   s_instance->outputHead("Error", false, {"[", "]: "}, std::make_pair<std::string, std::string>("\033[1m", "\033[0m"));
   s_instance->outputMsg(Flags::NONEWLINE, f, r...);
@@ -385,6 +401,7 @@ inline void Logger::error_start(First const &f, Rest... r) // static
 template <typename First, typename... Rest>
 inline void Logger::error_indent(First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   messagePre();
   s_instance->outputHead("     ", false, {" ", "   "});
   s_instance->outputMsg(Flags::NONE, f, r...);
@@ -393,6 +410,7 @@ inline void Logger::error_indent(First const &f, Rest... r) // static
 template <typename First, typename... Rest>
 inline void Logger::output_indent(int indent, First const &f, Rest... r) // static
 {
+  std::lock_guard<std::recursive_mutex> lock(s_mutex);
   messagePre();
   s_instance->outputHead(std::string(indent, ' '));
   s_instance->outputMsg(Flags::NONE, f, r...);
@@ -20,3 +20,4 @@
 #include "logger.h"
 
 std::unique_ptr<Logger> Logger::s_instance(nullptr);
+std::recursive_mutex Logger::s_mutex;
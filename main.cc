@@ -168,7 +168,7 @@ int main(int argc, char *argv[])
                               (arg.split_bool() ? arg.split() : -1), arg.setselfid(),  arg.includecalllog(), arg.searchpage(),
                               arg.stickerpacks(), arg.migratedb(), arg.overwrite(), arg.append(), arg.light(), arg.themeswitching(),
                               arg.addexportdetails(), arg.includeblockedlist(), arg.includefullcontactlist(), false /*arg.includesettings()*/,
-                              arg.includereceipts(), arg.originalfilenames(), arg.linkify()))
+                              arg.includereceipts(), arg.originalfilenames(), arg.linkify(), arg.jobs()))
         return 1;
 
     if (!arg.exportdesktoptxt().empty())
@@ -195,7 +195,7 @@ int main(int argc, char *argv[])
                             (arg.split_bool() ? arg.split() : -1), arg.setselfid(), arg.includecalllog(), arg.searchpage(),
                             arg.stickerpacks(), arg.migratedb(), arg.overwrite(), arg.append(), arg.light(), arg.themeswitching(),
                             arg.addexportdetails(), arg.includeblockedlist(), arg.includefullcontactlist(), false /*arg.includesettings()*/,
-                            arg.includereceipts(), arg.originalfilenames(), arg.linkify()))
+                            arg.includereceipts(), arg.originalfilenames(), arg.linkify(), arg.jobs()))
       return 1;
   }
 
@@ -360,29 +360,20 @@ int main(int argc, char *argv[])
       if (!addThreadIdsFromString(&src, arg.importthreadsbyname(), &threads))
         return 1;
 
-    for (unsigned int i = 0; i < threads.size(); ++i)
+    if (!threads.empty())
     {
+      Logger::message("\nImporting ", threads.size(), " thread", (threads.size() != 1 ? "s" : ""), " from source file: ", arg.source());
 
-      MEMINFO("Before reading source: ", i + 1, "/", threads.size());
-
-      Logger::message("\nImporting thread ", threads[i], " (", i + 1, "/", threads.size(), ") from source file: ", arg.source());
-
-      SignalBackup sourcecopy(src);
-      if (!sourcecopy.ok())
+      // all threads are imported in one go, directly from src (which is modified in the process)
+      if (!src.ok())
       {
         Logger::error("Failed to open source database");
         return 1;
       }
-      // if (!sourcesummarized)
-      // {
-      //   source->summarize();
-      //   sourcesummarized = true;
-      // }
-      MEMINFO("After reading source: ", i + 1, "/", threads.size(), " before import");
-      if (!sb->importThread(&sourcecopy, threads[i]))
+      MEMINFO("Before import");
+      if (!sb->importThread(&src, threads))
       {
-        Logger::error("A fatal error occurred while trying to import thread ", threads[i], ". Aborting");
-        //std::cout << "A fatal error occurred while trying to import thread " << threads[i] << ". Aborting" << std::endl;
+        Logger::error("A fatal error occurred while trying to import threads ", threads, ". Aborting");
         return 1;
       }
       MEMINFO("After import");
@@ -488,7 +479,7 @@ int main(int argc, char *argv[])
     if (!sb->exportHtml(arg.exporthtml(), limittothreads, arg.limittodates(), arg.split_by(), (arg.split_bool() ? arg.split() : -1),
                         arg.setselfid(), arg.includecalllog(), arg.searchpage(), arg.stickerpacks(), arg.migratedb(), arg.overwrite(),
                         arg.append(), arg.light(), arg.themeswitching(), arg.addexportdetails(), arg.includeblockedlist(),
-                        arg.includefullcontactlist(), arg.includesettings(), arg.includereceipts(), arg.originalfilenames(), arg.linkify()))
+                        arg.includefullcontactlist(), arg.includesettings(), arg.includereceipts(), arg.originalfilenames(), arg.linkify(), arg.jobs()))
       return 1;
 
   if (!arg.exporttxt().empty())
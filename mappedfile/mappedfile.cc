@@ -0,0 +1,116 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "mappedfile.ih"
+
+#if !defined(_WIN32) && !defined(__MINGW64__)
+
+MappedFile::MappedFile(std::string const &filename)
+  :
+  d_data(nullptr),
+  d_size(0)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    return;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+      static_cast<uint64_t>(st.st_size) > static_cast<uint64_t>(SIZE_MAX)) // file does not fit address space (32-bit)
+  {
+    close(fd);
+    return;
+  }
+
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping remains valid after closing
+  if (data == MAP_FAILED)
+    return;
+
+  d_data = static_cast<unsigned char const *>(data);
+  d_size = st.st_size;
+}
+
+MappedFile::~MappedFile()
+{
+  if (d_data)
+    munmap(const_cast<unsigned char *>(d_data), d_size);
+}
+
+// hint the os the range will be needed soon, so it can be read in
+// while the caller is still busy with the data before it
+void MappedFile::prefetch(uint64_t offset, uint64_t length) const
+{
+  if (!d_data || offset >= d_size)
+    return;
+
+  // madvise needs a page aligned address
+  static uint64_t const pagesize = sysconf(_SC_PAGESIZE);
+  uint64_t start = offset - (offset % pagesize);
+  length = std::min(length + (offset - start), d_size - start);
+  posix_madvise(const_cast<unsigned char *>(d_data + start), length, POSIX_MADV_WILLNEED);
+}
+
+#else // windows
+
+MappedFile::MappedFile(std::string const &filename)
+  :
+  d_data(nullptr),
+  d_size(0)
+{
+  // allow others to keep writing to the file (Signal Desktop may have its database open)
+  HANDLE hFile = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return;
+
+  LARGE_INTEGER filesize;
+  if (!GetFileSizeEx(hFile, &filesize) || filesize.QuadPart <= 0 ||
+      static_cast<uint64_t>(filesize.QuadPart) > static_cast<uint64_t>(SIZE_MAX))
+  {
+    CloseHandle(hFile);
+    return;
+  }
+
+  HANDLE hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(hFile);
+  if (!hMapping)
+    return;
+
+  void *data = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(hMapping); // the view keeps the mapping alive
+  if (!data)
+    return;
+
+  d_data = static_cast<unsigned char const *>(data);
+  d_size = filesize.QuadPart;
+}
+
+MappedFile::~MappedFile()
+{
+  if (d_data)
+    UnmapViewOfFile(d_data);
+}
+
+void MappedFile::prefetch(uint64_t offset [[maybe_unused]], uint64_t length [[maybe_unused]]) const
+{
+  // PrefetchVirtualMemory() is not available on all supported versions, the
+  // os read-ahead on the mapped view will have to do.
+}
+
+#endif
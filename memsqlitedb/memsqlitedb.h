@@ -27,6 +27,8 @@ class MemSqliteDB : public SqliteDB
  public:
   inline MemSqliteDB();
   inline explicit MemSqliteDB(std::pair<unsigned char *, uint64_t> *data);
+  inline explicit MemSqliteDB(sqlite3_vfs *vfs);
+  inline explicit MemSqliteDB(std::pair<std::shared_ptr<unsigned char []>, uint64_t> const &snapshot);
   ~MemSqliteDB() = default;
 };
 
@@ -44,5 +46,15 @@ inline MemSqliteDB::MemSqliteDB(std::pair<unsigned char *, uint64_t> *data)
   exec("PRAGMA synchronous = OFF");
 }
 
+inline MemSqliteDB::MemSqliteDB(sqlite3_vfs *vfs)
+  :
+  SqliteDB(vfs)
+{}
+
+inline MemSqliteDB::MemSqliteDB(std::pair<std::shared_ptr<unsigned char []>, uint64_t> const &snapshot)
+  :
+  SqliteDB(snapshot)
+{}
+
 
 #endif
@@ -37,6 +37,8 @@ class RawFileAttachmentReader : public AttachmentReader<RawFileAttachmentReader>
   virtual ~RawFileAttachmentReader() override = default;
 
   inline virtual int getAttachment(FrameWithAttachment *frame, bool verbose) override;
+  inline virtual bool canStream() const override;
+  inline virtual int streamAttachment(Sink const &sink, bool verbose) override;
 };
 
 inline RawFileAttachmentReader::RawFileAttachmentReader(std::string const &filename)
@@ -77,4 +79,43 @@ int RawFileAttachmentReader::getAttachment(FrameWithAttachment *frame, bool verb
   return 0;
 }
 
+inline bool RawFileAttachmentReader::canStream() const // virtual
+{
+  return true;
+}
+
+inline int RawFileAttachmentReader::streamAttachment(Sink const &sink, bool verbose) // virtual
+{
+  std::ifstream file(std::filesystem::path(d_filename), std::ios_base::binary | std::ios_base::in);
+  if (!file.is_open())
+  {
+    Logger::error("Failed to open file '", d_filename, "' for reading attachment");
+    return 1;
+  }
+  uint64_t attachmentdata_size = bepaald::fileSize(d_filename);
+
+  if (attachmentdata_size == 0) [[unlikely]]
+    Logger::warning("Asked to read 0-byte attachment");
+
+  if (verbose) [[unlikely]]
+    Logger::message("Reading attachment data, length: ", attachmentdata_size);
+
+  uint32_t const BUFFERSIZE = 8 * 1024;
+  unsigned char buffer[BUFFERSIZE];
+  uint64_t processed = 0;
+  while (processed < attachmentdata_size)
+  {
+    uint64_t read = std::min(attachmentdata_size - processed, static_cast<uint64_t>(BUFFERSIZE));
+    if (!file.read(reinterpret_cast<char *>(buffer), read))
+    {
+      Logger::error("Failed to read raw attachment \"", d_filename, "\"");
+      return 1;
+    }
+    if (!sink(buffer, read))
+      return 1;
+    processed += read;
+  }
+  return 0;
+}
+
 #endif
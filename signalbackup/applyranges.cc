@@ -39,78 +39,87 @@
         emoji        space     placeholder
 
   idx0: '0xF0' => utf8 size == 4 => idx0->idx4
-               => utf16 size == 2 => range{start: 3 + (4 - 2)}
+               => utf16 size == 2 => utf16idx0->utf16idx2
   idx4: '0x20' => utf8 size == 1 => idx4->idx5
-               => utf16 size == 1 => range{start: 5 + (1 - 1)}
-  idx5: MATCH! adjust length at this position from utf16 codepoints to 8bit bytes and replace
+               => utf16 size == 1 => utf16idx2->utf16idx3
+  idx5: MATCH! (utf16idx == range.start) adjust length at this position from utf16 codepoints to 8bit bytes and replace
                => utf16 length 1 at idx 5 == 3 => replace 3 with 'AA'
                => 0xF0 0x9F 0x92 0xA9 0x20 0x41 0x41 ...
-               => idx5->idx7 (5 +
+               => idx5->idx8, utf16idx3->utf16idx4
  */
 
-void SignalBackup::applyRanges(std::string *body, std::vector<Range> *ranges, std::set<int> *positions_excluded_from_escape) const
+void SignalBackup::applyRanges(std::string *body, std::vector<Range> *ranges,
+                               std::vector<std::pair<unsigned int, unsigned int>> *positions_excluded_from_escape) const
 {
   // sort the ranges and adjust them
   // to deal with overlaps
   prepRanges(ranges);
 
+  if (ranges->empty())
+    return;
 
-  // then, apply the ranges:
+  // then, apply the ranges. The result is built in a new string, so the body is walked only once and
+  // the ranges do not need to be shifted after every change: 'bodyidx' is the index (in bytes) into
+  // the (unmodified) body, 'utf16idx' is the index the ranges are expressed in (a range that was
+  // applied counts as its own length, regardless of the length of its replacement).
+  std::string result;
+  result.reserve(body->size() + 64);
   unsigned int rangesidx = 0;
   unsigned int bodyidx = 0;
+  unsigned int copiedidx = 0; // all bytes before copiedidx are already in result
+  bool changed = false;
+  long long int utf16idx = 0;
   while (bodyidx < body->size() && rangesidx < ranges->size())
   {
     //std::cout << "Checking char idx: " << bodyidx << "('" << (*body)[bodyidx] << "') for range with start: " << (*ranges)[rangesidx].start << std::flush;
 
-    int charsizeinbytes = bytesToUtf8CharSize(*body, bodyidx);
-    int charsizeinutf16entities = utf16CharSize(*body, bodyidx);
-
-    //std::cout << ", charsize: " << charsizeinbytes << " codepoints: " << charsizeinutf16entities <<  std::endl;
-
-    if (bodyidx == (*ranges)[rangesidx].start)
+    if (utf16idx == (*ranges)[rangesidx].start)
     {
-      //int length = bytesToUtf8CharSize(*body, bodyidx, (*ranges)[rangesidx].length);
-      int length = numBytesInUtf16Substring(*body, bodyidx, (*ranges)[rangesidx].length);
-      std::string pre = (*ranges)[rangesidx].pre;
-      std::string replacement = (*ranges)[rangesidx].replacement;
-      std::string post = (*ranges)[rangesidx].post;
-
-      if (replacement.empty())
-        replacement = body->substr(bodyidx, length);
-
-      body->replace(bodyidx, length, pre + replacement + post);
-
-      for (unsigned int i = 0; i < pre.size(); ++i)
-        if (positions_excluded_from_escape)
-          positions_excluded_from_escape->insert(i + bodyidx);
-      for (unsigned int i = 0; i < post.size(); ++i)
-        if (positions_excluded_from_escape)
-          positions_excluded_from_escape->insert(i + bodyidx + pre.size() + replacement.size());
+      // copy the unchanged part before this range
+      result.append(*body, copiedidx, bodyidx - copiedidx);
 
-      //std::cout << "BODY: " << *body << std::endl;
-
-      for (unsigned int i = rangesidx + 1; i < ranges->size(); ++i)
-        (*ranges)[i].start += pre.size() + post.size() + (replacement.size() - (*ranges)[rangesidx].length);
-
-      // skip the just inserted string
-      bodyidx += pre.size() + post.size() + replacement.size();
+      //int length = bytesToUtf8CharSize(*body, bodyidx, (*ranges)[rangesidx].length);
+      unsigned int length = std::min(static_cast<std::string::size_type>(numBytesInUtf16Substring(*body, bodyidx, (*ranges)[rangesidx].length)),
+                                     body->size() - bodyidx);
+      Range const &r = (*ranges)[rangesidx];
+
+      if (positions_excluded_from_escape && !r.pre.empty())
+        positions_excluded_from_escape->emplace_back(result.size(), r.pre.size());
+      result += r.pre;
+      if (r.replacement.empty())
+        result.append(*body, bodyidx, length);
+      else
+        result += r.replacement;
+      if (positions_excluded_from_escape && !r.post.empty())
+        positions_excluded_from_escape->emplace_back(result.size(), r.post.size());
+      result += r.post;
+
+      // skip the replaced part of the body
+      bodyidx += length;
+      copiedidx = bodyidx;
+      changed = true;
+      utf16idx += r.length;
 
       // look for next range
       // while the prepwork should make sure it is the first one,
       // interactions with mention replacements might throw it off?
       // just to be sure, lets not just `++rangesidx'
-      while (++rangesidx < ranges->size() && (*ranges)[rangesidx].start < bodyidx)
+      while (++rangesidx < ranges->size() && (*ranges)[rangesidx].start < utf16idx)
         ;
       continue;
     }
 
-    // update all following ranges for multibyte char
-    for (unsigned int i = rangesidx; i < ranges->size(); ++i)
-      (*ranges)[i].start += (charsizeinbytes - charsizeinutf16entities);
-
     // next char...
-    bodyidx += charsizeinbytes;
+    utf16idx += utf16CharSize(*body, bodyidx);
+    bodyidx += bytesToUtf8CharSize(*body, bodyidx);
   }
+
+  if (!changed)
+    return;
+
+  if (copiedidx < body->size())
+    result.append(*body, copiedidx);
+  body->swap(result);
 }
 
 /*
@@ -101,3 +101,32 @@ SqlStatementFrame SignalBackup::buildSqlStatementFrame(std::string const &table,
 
   return newframe;
 }
+
+SqlStatementFrame SignalBackup::buildSqlStatementFrame(std::string const &table, SqliteDB::Cursor const &row) const
+{
+  SqlStatementFrame newframe;
+  std::string newstatement = "INSERT INTO " + table + " VALUES (";
+  for (int j = 0; j < row.columns(); ++j)
+  {
+    if (j < row.columns() - 1)
+      newstatement.append("?,");
+    else
+      newstatement.append("?)");
+
+    if (row.valueHasType<long long int>(j))
+      newframe.addIntParameter(row.getValueAs<long long int>(j));
+    else if (row.isNull(j))
+      newframe.addNullParameter();
+    else if (row.valueHasType<std::string>(j))
+      newframe.addStringParameter(row.getValueAs<std::string>(j));
+    else if (row.valueHasType<std::pair<std::shared_ptr<unsigned char []>, size_t>>(j))
+      newframe.addBlobParameter(row.getValueAs<std::pair<std::shared_ptr<unsigned char []>, size_t>>(j));
+    else if (row.valueHasType<double>(j))
+      newframe.addDoubleParameter(row.getValueAs<double>(j));
+    else
+      Logger::warning("UNHANDLED PARAMETER TYPE IN COLUMN ", j);
+  }
+  newframe.setStatementField(newstatement);
+
+  return newframe;
+}
@@ -21,37 +21,28 @@
 
 bool SignalBackup::cleanAttachments()
 {
-  //std::map<std::pair<uint64_t, uint64_t>, std::unique_ptr<AttachmentFrame>> d_attachments; //maps <rowid,uniqueid> to attachment
   // remove unused attachments
   Logger::message("  Deleting unused attachments...");
-  SqliteDB::QueryResults results;
-  int constexpr INVALID_ID = -10;
-  d_database.exec("SELECT _id,"
-                  + (d_database.tableContainsColumn(d_part_table, "unique_id") ? "unique_id"s : "-1 AS unique_id"s) +
-                  " FROM " + d_part_table, &results);
-  for (auto it = d_attachments.begin(); it != d_attachments.end();)
-  {
-    bool found = false;
-    for (unsigned int i = 0; i < results.rows(); ++i)
-    {
-      long long int rowid = INVALID_ID;
-      if (results.valueHasType<long long int>(i, "_id"))
-        rowid = results.getValueAs<long long int>(i, "_id");
-      long long int uniqueid = INVALID_ID;
-      if (results.valueHasType<long long int>(i, "unique_id"))
-        uniqueid = results.getValueAs<long long int>(i, "unique_id");
-
-      if (rowid != INVALID_ID && uniqueid != INVALID_ID &&
-          it->first.first == static_cast<uint64_t>(rowid) && it->first.second == static_cast<int64_t>(uniqueid))
-      {
-        found = true;
-        break;
-      }
-    }
-    if (!found)
-      it = d_attachments.erase(it);
-    else
-      ++it;
-  }
+
+  // get all (rowid, uniqueid) pairs still present in the database in one go,
+  // then drop every attachment that is not among them
+  AttachmentKeySet const partkeys(getPartKeys());
+  d_attachments.erase_if([&partkeys](auto const &att) { return !partkeys.contains(att.first); });
   return true;
 }
+
+SignalBackup::AttachmentKeySet SignalBackup::getPartKeys() const
+{
+  AttachmentKeySet partkeys;
+  SqliteDB::QueryResults results;
+  if (!d_database.exec("SELECT _id,"
+                       + (d_database.tableContainsColumn(d_part_table, "unique_id") ? "unique_id"s : "-1 AS unique_id"s) +
+                       " FROM " + d_part_table, &results))
+    return partkeys;
+
+  partkeys.reserve(results.rows());
+  for (unsigned int i = 0; i < results.rows(); ++i)
+    if (results.valueHasType<long long int>(i, 0) && results.valueHasType<long long int>(i, 1)) [[likely]]
+      partkeys.emplace(results.getValueAs<long long int>(i, 0), results.getValueAs<long long int>(i, 1));
+  return partkeys;
+}
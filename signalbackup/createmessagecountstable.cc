@@ -0,0 +1,43 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "signalbackup.ih"
+
+// creates (or recreates) temp.message_counts, holding the number of attachments, reactions and
+// mentions of every message that has any. exportTxt() joins its per-thread message queries on
+// this table, instead of aggregating the part, reaction and mention tables for every thread.
+bool SignalBackup::createMessageCountsTable() const
+{
+  if (!d_database.exec("DROP TABLE IF EXISTS temp.message_counts") ||
+      !d_database.exec("CREATE TEMP TABLE message_counts (message_id INTEGER PRIMARY KEY, attcount INTEGER, reactioncount INTEGER, mentioncount INTEGER)") ||
+      !d_database.exec("INSERT INTO temp.message_counts (message_id, attcount, reactioncount, mentioncount) "
+                       "SELECT message_id, SUM(att), SUM(rct), SUM(mnt) FROM "
+                       "("
+                       "SELECT " + d_part_mid + " AS message_id, 1 AS att, 0 AS rct, 0 AS mnt FROM " + d_part_table + " WHERE " + d_part_mid + " IS NOT NULL "
+                       "UNION ALL "
+                       "SELECT message_id, 0, 1, 0 FROM reaction WHERE message_id IS NOT NULL "
+                       "UNION ALL "
+                       "SELECT message_id, 0, 0, 1 FROM mention WHERE message_id IS NOT NULL"
+                       ") GROUP BY message_id")) [[unlikely]]
+  {
+    Logger::error("Failed to create table of per-message counts");
+    return false;
+  }
+  return true;
+}
@@ -59,7 +59,7 @@ bool SignalBackup::custom_hugogithubs()
   d_part_cl = "remote_location"; // dbv 215
 
   // remove unqiue ids from AttachmentFrames
-  std::map<std::pair<uint64_t, int64_t>, DeepCopyingUniquePtr<AttachmentFrame>> d_new_attachments;
+  decltype(d_attachments) d_new_attachments;
   for (auto const &a : d_attachments)
   {
     AttachmentFrame const *af = a.second.get();
@@ -101,7 +101,7 @@ bool SignalBackup::custom_hugogithubs()
     // std::cout << rit->first.first << " " << rit->first.second << std::endl;
     // rit->second->printInfo();
   }
-  d_attachments = d_new_attachments;
+  d_attachments = std::move(d_new_attachments);
 
 
   // adjust DatabaseVersionFrame
@@ -305,10 +305,17 @@ bool SignalBackup::dumpMedia(std::string const &dir, std::vector<std::string> co
     }
 
     ++count;
-    if (!attachmentstream.write(reinterpret_cast<char *>(a->attachmentData()), a->attachmentSize()))
+    if (a->streamAttachmentData([&](unsigned char const *data, uint64_t size)
+                                {
+                                  return static_cast<bool>(attachmentstream.write(reinterpret_cast<char const *>(data), size));
+                                }) != 0)
     {
       Logger::error("Failed to write data to file: '", targetdir, "/", filename, "'");
       a->clearData();
+      // do not leave a partial (or corrupted) file behind
+      attachmentstream.close();
+      std::error_code ec;
+      std::filesystem::remove(targetdir + "/" + filename, ec);
       continue;
     }
 
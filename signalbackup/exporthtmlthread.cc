@@ -0,0 +1,623 @@
+/*
+  Copyright (C) 2023-2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  Many thanks to Gertjan van den Burg (https://github.com/GjjvdBurg) for his
+  original project (used with permission) without which this function would
+  not have come together so quickly (if at all).
+*/
+
+#include "signalbackup.ih"
+
+#include <cerrno>
+
+// exports a single thread to its own subdirectory of 'directory'. Lines for the search index are
+// appended to searchidx_lines instead of written directly, so the caller can merge them when
+// multiple threads are exported simultaneously. Returns false on errors that should abort the
+// entire export.
+bool SignalBackup::exportHtmlThread(long long int t, long long int note_to_self_thread_id, std::string const &directory,
+                                    std::string const &datewhereclause,
+                                    std::vector<std::pair<std::string, std::string>> const &dateranges,
+                                    std::string const &periodsplitformat, long long int split, bool overwrite, bool append,
+                                    bool lighttheme, bool themeswitching, bool searchpage, bool addexportdetails,
+                                    std::string const &exportdetails_html, bool receipts, bool originalfilenames,
+                                    bool linkify, std::map<long long int, RecipientInfo> *recipient_info,
+                                    std::vector<std::string> *searchidx_lines, bool *excluded) const
+{
+  // if (t == releasechannel)
+  // {
+  //   std::cout << "INFO: Skipping releasechannel thread..." << std::endl;
+  //   continue;
+  // }
+
+  Logger::message("Dealing with thread ", t);
+
+  bool is_note_to_self = (t == note_to_self_thread_id);
+
+  // get recipient_id for thread;
+  SqliteDB::QueryResults recid;
+  long long int thread_recipient_id = -1;
+  if (!d_database.exec("SELECT _id," + d_thread_recipient_id + " FROM thread WHERE _id = ?", t, &recid) ||
+      recid.rows() != 1 || (thread_recipient_id = recid.valueAsInt(0, d_thread_recipient_id)) == -1)
+  {
+    Logger::error("Failed to find recipient_id for thread (", t, ")... skipping");
+    return true;
+  }
+  long long int thread_id = recid.getValueAs<long long int>(0, "_id");
+
+  bool isgroup = false;
+  SqliteDB::QueryResults groupcheck;
+  d_database.exec("SELECT group_id FROM recipient WHERE _id = ? AND group_id IS NOT NULL", thread_recipient_id, &groupcheck);
+  if (groupcheck.rows())
+    isgroup = true;
+
+  // now get all messages
+  std::string messagewhereclause = "thread_id = ?"
+    + datewhereclause +
+    + (d_database.tableContainsColumn(d_mms_table, "latest_revision_id") ? " AND latest_revision_id IS NULL " : " ") +
+    + (d_database.tableContainsColumn(d_mms_table, "story_type") ? " AND story_type = 0 OR story_type IS NULL " : ""); // storytype NONE(0), STORY_WITH(OUT)_REPLIES(1/2), TEXT_...(3/4)
+  SqliteDB::QueryResults messages;
+  d_database.exec("SELECT "s
+                  "_id, " + d_mms_recipient_id + ", body, "
+                  "MIN(date_received, " + d_mms_date_sent + ") AS bubble_date, "
+                  "date_received, " + d_mms_date_sent + ", " + d_mms_type + ", "
+                  + (!periodsplitformat.empty() ? "strftime('" + periodsplitformat + "', IFNULL(date_received, 0) / 1000, 'unixepoch', 'localtime')" : "''") + " AS periodsplit, "
+                  "quote_id, quote_author, quote_body, quote_mentions, quote_missing, "
+                  + d_mms_delivery_receipts + ", " + d_mms_read_receipts + ", IFNULL(remote_deleted, 0) AS remote_deleted, "
+                  "IFNULL(view_once, 0) AS view_once, expires_in, " + d_mms_ranges + ", shared_contacts, "
+                  + (d_database.tableContainsColumn(d_mms_table, "original_message_id") ? "original_message_id, " : "") +
+                  + (d_database.tableContainsColumn(d_mms_table, "revision_number") ? "revision_number, " : "") +
+                  + (d_database.tableContainsColumn(d_mms_table, "parent_story_id") ? "parent_story_id, " : "") +
+                  + (d_database.tableContainsColumn(d_mms_table, "message_extras") ? "message_extras, " : "") +
+                  + (d_database.tableContainsColumn(d_mms_table, "receipt_timestamp") ? "receipt_timestamp, " : "-1 AS receipt_timestamp, ") + // introduced in 117
+                  "json_extract(link_previews, '$[0].title') AS link_preview_title, "
+                  "json_extract(link_previews, '$[0].description') AS link_preview_description "
+                  "FROM " + d_mms_table + " "
+                  "WHERE " + messagewhereclause +
+                  " ORDER BY date_received ASC", t, &messages);
+  if (messages.rows() == 0)
+  {
+    if (d_verbose) [[unlikely]]
+      Logger::message("Thread appears empty. Skipping...");
+    *excluded = true;
+    return true;
+  }
+
+  // get all recipients in thread (group member (past and present), quote/reaction authors, mentions)
+  std::set<long long int> all_recipients_ids = getAllThreadRecipients(t);
+
+  //try to set any missing info on recipients
+  setRecipientInfo(all_recipients_ids, recipient_info);
+
+  //for (auto const &ri : recipient_info)
+  //  std::cout << ri.first << ": " << ri.second.display_name << std::endl;
+
+  // get conversation name, sanitize it and create dir
+  if (!bepaald::contains(recipient_info, thread_recipient_id))
+  {
+    Logger::error("Failed set recipient info for thread (", t, ")... skipping");
+    return true;
+  }
+
+  std::string threaddir = (is_note_to_self ? "Note to self (_id"s + bepaald::toString(thread_id) + ")"
+                           : sanitizeFilename((*recipient_info)[thread_recipient_id].display_name + " (_id" + bepaald::toString(thread_id) + ")"));
+
+  //if (!append)
+  //  makeFilenameUnique(directory, &threaddir);
+
+  if (bepaald::fileOrDirExists(directory + "/" + threaddir))
+  {
+    if (!bepaald::isDir(directory + "/" + threaddir))
+    {
+      Logger::error("dir is regular file");
+      return false;
+    }
+    if (!append && !overwrite) // should be impossible at this point....
+    {
+      Logger::error("Refusing to overwrite existing directory");
+      return false;
+    }
+  }
+  else if (!bepaald::createDir(directory + "/" + threaddir)) // try to create it
+  {
+    Logger::error("Failed to create directory `", directory, "/", threaddir, "'",
+                  " (errno: ", bepaald::strError(errno), ")"); // note: errno is not required to be set by std
+    // temporary !!
+    {
+      std::error_code ec;
+      std::filesystem::space_info const si = std::filesystem::space(directory, ec);
+      if (!ec)
+      {
+        Logger::message("Available: ", static_cast<std::intmax_t>(si.available));
+        Logger::message(" Filesize: ", d_fd->total());
+      }
+    }
+    return false;
+  }
+
+  // now append messages to html
+  std::map<long long int, std::string> written_avatars; // maps recipient_ids to the path of a written avatar file.
+  unsigned int messagecount = 0; // current message
+  unsigned int max_msg_per_page = messages.rows();
+  int pagenumber = 0; // current page
+  int totalpages = 1;
+  if (split > 0)
+  {
+    totalpages = (messages.rows() / split) + (messages.rows() % split > 0 ? 1 : 0);
+    max_msg_per_page = messages.rows() / totalpages + (messages.rows() % totalpages ? 1 : 0);
+  }
+  if (!periodsplitformat.empty())
+    totalpages = d_database.getSingleResultAs<long long int>("SELECT COUNT(DISTINCT strftime('" + periodsplitformat +  "', IFNULL(date_received, 0) / 1000, 'unixepoch', 'localtime')) "
+                                                             "FROM message WHERE thread_id = ?" + datewhereclause, t, 1);
+
+  // std::cout << "Split: " << split << std::endl;
+  // std::cout << "N MSG: " << messages.rows() << std::endl;
+  // std::cout << "MAX PER PAGE: " << max_msg_per_page << std::endl;
+  // std::cout << "N PAGES: " << totalpages << std::endl;
+
+  // get the attachments, quote attachments, mentions, reactions and edit revisions of all messages
+  // in this thread at once, instead of running five queries for every message. Every result is ordered
+  // by message id (the last column) first, so the rows of a single message are consecutive and can be
+  // taken out as a slice (see getRows()).
+  std::string threadmessages = "IN (SELECT _id FROM " + d_mms_table + " WHERE " + messagewhereclause + ")";
+  auto groupByMessage = [](SqliteDB::QueryResults *results)
+  {
+    std::unordered_map<long long int, std::pair<unsigned int, unsigned int>> index; // message_id -> (first row, rowcount)
+    if (results->rows() == 0)
+      return index;
+    unsigned int idcolumn = results->columns() - 1;
+    for (unsigned int i = 0; i < results->rows(); ++i)
+      ++(index.try_emplace(results->getValueAs<long long int>(i, idcolumn), i, 0).first->second.second);
+    results->removeColumn(idcolumn);
+    return index;
+  };
+  auto messageRows = [](SqliteDB::QueryResults const &results,
+                        std::unordered_map<long long int, std::pair<unsigned int, unsigned int>> const &index,
+                        long long int msg_id)
+  {
+    auto it = index.find(msg_id);
+    return (it == index.end()) ? SqliteDB::QueryResults() : results.getRows(it->second.first, it->second.second);
+  };
+
+  SqliteDB::QueryResults all_attachments;
+  SqliteDB::QueryResults all_quote_attachments;
+  for (int quote : {0, 1})
+    d_database.exec("SELECT " +
+                    d_part_table + "._id, " +
+                    (d_database.tableContainsColumn(d_part_table, "unique_id") ? "unique_id"s : "-1 AS unique_id") + ", " +
+                    d_part_ct + ", "
+                    "file_name, "
+                    + d_part_pending + ", " +
+                    (d_database.tableContainsColumn(d_part_table, "caption") ? "caption, "s : std::string()) +
+                    "sticker_pack_id, " +
+                    d_mms_table + ".date_received AS date_received, " +
+                    d_part_table + "." + d_part_mid + " AS message_id "
+                    "FROM " + d_part_table + " "
+                    "LEFT JOIN " + d_mms_table + " ON " + d_mms_table + "._id = " + d_part_table + "." + d_part_mid + " "
+                    "WHERE " + d_part_table + "." + d_part_mid + " " + threadmessages + " "
+                    "AND quote IS ? "
+                    " ORDER BY " + d_part_table + "." + d_part_mid + ", display_order ASC, " + d_part_table + "._id ASC",
+                    {t, quote}, quote ? &all_quote_attachments : &all_attachments);
+  std::unordered_map<long long int, std::pair<unsigned int, unsigned int>> attachment_index = groupByMessage(&all_attachments);
+  std::unordered_map<long long int, std::pair<unsigned int, unsigned int>> quote_attachment_index = groupByMessage(&all_quote_attachments);
+
+  SqliteDB::QueryResults all_mentions;
+  d_database.exec("SELECT recipient_id, range_start, range_length, message_id FROM mention "
+                  "WHERE message_id " + threadmessages + " ORDER BY message_id, _id", t, &all_mentions);
+  std::unordered_map<long long int, std::pair<unsigned int, unsigned int>> mention_index = groupByMessage(&all_mentions);
+
+  SqliteDB::QueryResults all_reactions;
+  d_database.exec("SELECT emoji, author_id, DATETIME(date_sent / 1000, 'unixepoch', 'localtime') AS 'date_sent', DATETIME(date_received / 1000, 'unixepoch', 'localtime') AS 'date_received', message_id "
+                  "FROM reaction WHERE message_id " + threadmessages + " ORDER BY message_id, _id", t, &all_reactions);
+  std::unordered_map<long long int, std::pair<unsigned int, unsigned int>> reaction_index = groupByMessage(&all_reactions);
+
+  // revisions are grouped by the original_message_id they belong to
+  SqliteDB::QueryResults all_revisions;
+  if (d_database.tableContainsColumn(d_mms_table, "original_message_id") && d_database.tableContainsColumn(d_mms_table, "revision_number"))
+    d_database.exec("SELECT revision._id, revision.body, revision.date_received, revision." + d_mms_date_sent + ", revision.revision_number, originals.original_message_id "
+                    "FROM (SELECT DISTINCT original_message_id FROM " + d_mms_table + " WHERE _id " + threadmessages + " AND original_message_id IS NOT NULL) AS originals "
+                    "JOIN " + d_mms_table + " AS revision ON revision._id = originals.original_message_id OR revision.original_message_id = originals.original_message_id "
+                    "ORDER BY originals.original_message_id, revision." + d_mms_date_sent + " ASC", t, &all_revisions);
+  std::unordered_map<long long int, std::pair<unsigned int, unsigned int>> revision_index = groupByMessage(&all_revisions);
+
+  unsigned int daterangeidx = 0;
+
+  while (true)
+  {
+    std::string previous_period_split_string(messages(messagecount, "periodsplit"));
+    std::string previous_day_change;
+    // create output-file
+    std::string raw_base_filename = (is_note_to_self ? "Note to self" : (*recipient_info)[thread_recipient_id].display_name);
+    std::string filename = sanitizeFilename(raw_base_filename + (pagenumber > 0 ? "_" + bepaald::toString(pagenumber) : "") + ".html");
+    std::ofstream htmloutput(directory + "/" + threaddir + "/" + filename, std::ios_base::binary);
+    if (!htmloutput.is_open())
+    {
+      Logger::error("Failed to open '", directory, "/", threaddir, "/", filename, " for writing.");
+      return false;
+    }
+
+    // create start of html (css, head, start of body
+    HTMLwriteStart(htmloutput, thread_recipient_id, directory, threaddir, isgroup, is_note_to_self,
+                   all_recipients_ids, recipient_info, &written_avatars, overwrite, append,
+                   lighttheme, themeswitching, searchpage, addexportdetails);
+    while (messagecount < (max_msg_per_page * (pagenumber + 1)) &&
+           messages(messagecount, "periodsplit") == previous_period_split_string)
+    {
+      long long int msg_id = messages.getValueAs<long long int>(messagecount, "_id");
+      long long int msg_recipient_id = messages.valueAsInt(messagecount, d_mms_recipient_id);
+      if (msg_recipient_id == -1) [[unlikely]]
+      {
+        Logger::warning("Failed to get message recipient id. Skipping.");
+        continue;
+      }
+      long long int original_message_id = (d_database.tableContainsColumn(d_mms_table, "original_message_id") ?
+                                           messages.valueAsInt(messagecount, "original_message_id") :
+                                           -1);
+      std::string readable_date =
+        bepaald::toDateString(messages.getValueAs<long long int>(messagecount, "bubble_date") / 1000, //(/*(original_message_id != -1) ? "date_received" : */d_mms_date_sent)) / 1000,
+                              "%b %d, %Y %H:%M:%S");
+      std::string readable_date_day =
+        bepaald::toDateString(messages.getValueAs<long long int>(messagecount, "bubble_date") / 1000, //(/*(original_message_id != -1) ? "date_received" : */d_mms_date_sent)) / 1000,
+                              "%b %d, %Y");
+      bool incoming = !Types::isOutgoing(messages.getValueAs<long long int>(messagecount, d_mms_type));
+      bool is_deleted = messages.getValueAs<long long int>(messagecount, "remote_deleted") == 1;
+      bool is_viewonce = messages.getValueAs<long long int>(messagecount, "view_once") == 1;
+      std::string body = messages.valueAsString(messagecount, "body");
+      std::string shared_contacts = messages.valueAsString(messagecount, "shared_contacts");
+      std::string quote_body = messages.valueAsString(messagecount, "quote_body");
+      long long int expires_in = messages.getValueAs<long long int>(messagecount, "expires_in");
+      long long int type = messages.getValueAs<long long int>(messagecount, d_mms_type);
+      bool hasquote = !messages.isNull(messagecount, "quote_id") && messages.getValueAs<long long int>(messagecount, "quote_id");
+      bool quote_missing = messages.valueAsInt(messagecount, "quote_missing", 0) != 0;
+      bool story_reply = (d_database.tableContainsColumn(d_mms_table, "parent_story_id") ? messages.valueAsInt(messagecount, "parent_story_id", 0) : 0);
+      SqliteDB::QueryResults attachment_results(messageRows(all_attachments, attachment_index, msg_id));
+
+      // check attachments for long message body -> replace cropped body & remove from attachment results
+      setLongMessageBody(&body, &attachment_results);
+
+      SqliteDB::QueryResults quote_attachment_results(messageRows(all_quote_attachments, quote_attachment_index, msg_id));
+      SqliteDB::QueryResults mention_results(messageRows(all_mentions, mention_index, msg_id));
+      SqliteDB::QueryResults reaction_results(messageRows(all_reactions, reaction_index, msg_id));
+
+      SqliteDB::QueryResults edit_revisions;
+      if (original_message_id != -1)
+        edit_revisions = messageRows(all_revisions, revision_index, original_message_id);
+
+      bool issticker = (attachment_results.rows() == 1 && !attachment_results.isNull(0, "sticker_pack_id"));
+
+      IconType icon = IconType::NONE;
+      if (Types::isStatusMessage(type))
+      {
+        // decode from body if (body not empty) OR (message_extras not available)
+        if (!body.empty() ||
+            !(d_database.tableContainsColumn(d_mms_table, "message_extras") &&
+              messages.valueHasType<std::pair<std::shared_ptr<unsigned char []>, size_t>>(messagecount, "message_extras")))
+          body = decodeStatusMessage(body, messages.getValueAs<long long int>(messagecount, "expires_in"),
+                                     type, getRecipientInfoFromMap(recipient_info, msg_recipient_id).display_name, &icon);
+        else if (d_database.tableContainsColumn(d_mms_table, "message_extras") &&
+                 messages.valueHasType<std::pair<std::shared_ptr<unsigned char []>, size_t>>(messagecount, "message_extras"))
+          body = decodeStatusMessage(messages.getValueAs<std::pair<std::shared_ptr<unsigned char []>, size_t>>(messagecount, "message_extras"),
+                                     messages.getValueAs<long long int>(messagecount, "expires_in"), type,
+                                     getRecipientInfoFromMap(recipient_info, msg_recipient_id).display_name, &icon);
+      }
+
+      // prep body (scan emoji? -> in <span>) and handle mentions...
+      // if (prepbody)
+      std::vector<std::tuple<long long int, long long int, long long int>> mentions;
+      for (unsigned int mi = 0; mi < mention_results.rows(); ++mi)
+        mentions.emplace_back(std::make_tuple(mention_results.getValueAs<long long int>(mi, "recipient_id"),
+                                              mention_results.getValueAs<long long int>(mi, "range_start"),
+                                              mention_results.getValueAs<long long int>(mi, "range_length")));
+      std::pair<std::shared_ptr<unsigned char []>, size_t> brdata(nullptr, 0);
+      if (!messages.isNull(messagecount, d_mms_ranges))
+        brdata = messages.getValueAs<std::pair<std::shared_ptr<unsigned char []>, size_t>>(messagecount, d_mms_ranges);
+
+      bool only_emoji = HTMLprepMsgBody(&body, mentions, recipient_info, incoming, brdata, linkify, false /*isquote*/);
+
+      bool nobackground = false;
+      if ((only_emoji && !hasquote && !attachment_results.rows()) ||  // if no quote etc
+          issticker) // or sticker
+        nobackground = true;
+
+      // same for quote_body!
+      mentions.clear();
+      std::pair<std::shared_ptr<unsigned char []>, size_t> quote_mentions{nullptr, 0};
+      if (!messages.isNull(messagecount, "quote_mentions"))
+        quote_mentions = messages.getValueAs<std::pair<std::shared_ptr<unsigned char []>, size_t>>(messagecount, "quote_mentions");
+      HTMLprepMsgBody(&quote_body, mentions, recipient_info, incoming, quote_mentions, linkify, true);
+
+      // insert date-change message
+      if (readable_date_day != previous_day_change)
+      {
+        htmloutput << R"(          <div class="msg msg-date-change">
+            <p>
+              )" << readable_date_day << R"(
+            </p>
+          </div>)" << std::endl << std::endl;
+      }
+      previous_day_change = readable_date_day;
+      previous_period_split_string = messages(messagecount, "periodsplit");
+
+      /*
+
+        LINKIFY?
+
+        Notes:
+        - currently this matches 'yes.combine them please' as 'yes.com'. (maybe try to match per word?)
+        - dont copy entire body, just match on stringview, and update it from suffix start?
+        - this interacts with prepbody/escapehtml
+
+      std::regex url_regex("(?:(?:(?:(?:(?:http|ftp|https|localhost):\\/\\/)|(?:www\\.)|(?:xn--)){1}(?:[\\w_-]+(?:(?:\\.[\\w_-]+)+))(?:[\\w.,@?^=%&:\\/~+#-]*[\\w@?^=%&\\/~+#-])?)|(?:(?:[\\w_-]{2,200}(?:(?:\\.[\\w_-]+)*))(?:(?:\\.[\\w_-]+\\/(?:[\\w.,@?^=%&:\\/~+#-]*[\\w@?^=%&\\/~+#-])?)|(?:\\.(?:(?:org|com|net|edu|gov|mil|int|arpa|biz|info|unknown|one|ninja|network|host|coop|tech)|(?:jp|br|it|cn|mx|ar|nl|pl|ru|tr|tw|za|be|uk|eg|es|fi|pt|th|nz|cz|hu|gr|dk|il|sg|uy|lt|ua|ie|ir|ve|kz|ec|rs|sk|py|bg|hk|eu|ee|md|is|my|lv|gt|pk|ni|by|ae|kr|su|vn|cy|am|ke))))))(?!(?:(?:(?:ttp|tp|ttps):\\/\\/)|(?:ww\\.)|(?:n--)))");
+      std::smatch url_match_result;
+      std::string body2 = body;
+      while (std::regex_search(body2, url_match_result, url_regex))
+      {
+        for (const auto &res : url_match_result)
+          std::cout << "FOUND URL: " << res << std::endl;
+        body2 = url_match_result.suffix();
+      }
+       */
+
+      // collect data needed by writeMessage()
+      HTMLMessageInfo msg_info({only_emoji,
+                                is_deleted,
+                                is_viewonce,
+                                isgroup,
+                                incoming,
+                                nobackground,
+                                hasquote,
+                                quote_missing,
+                                originalfilenames,
+                                overwrite,
+                                append,
+                                story_reply,
+                                type,
+                                expires_in,
+                                msg_id,
+                                msg_recipient_id,
+                                original_message_id,
+                                messagecount,
+
+                                &messages,
+                                &quote_attachment_results,
+                                &attachment_results,
+                                &reaction_results,
+                                &edit_revisions,
+
+                                body,
+                                quote_body,
+                                readable_date,
+                                directory,
+                                threaddir,
+                                filename,
+                                messages(messagecount, "link_preview_title"),
+                                messages(messagecount, "link_preview_description"),
+                                shared_contacts,
+
+                                icon
+        });
+      HTMLwriteMessage(htmloutput, msg_info, recipient_info, searchpage, receipts);
+
+      if (searchpage && (!Types::isStatusMessage(msg_info.type) && !msg_info.body.empty()))
+      {
+        // because the body is already escaped for html at this point, we get it fresh from database (and have sqlite do the json formatting)
+        SqliteDB::QueryResults search_idx_results;
+        if (!d_database.exec("SELECT json_object("
+                             "'id', " + d_mms_table + "._id, "
+                             "'b', " + d_mms_table + ".body, "
+                             "'f', " + d_mms_table + "." + d_mms_recipient_id + ", "
+                             "'tr', thread." + d_thread_recipient_id + ", "
+                             "'o', (" + d_mms_table + "." + d_mms_type + " & 0x1F) IN (2,11,21,22,23,24,25,26), "
+                             "'d', (" + d_mms_table + ".date_received / 1000 - 1404165600), " // loose the last three digits (miliseconds, they are never displayed anyway).
+                                                                                              // subtract "2014-07-01". Signals initial release was 2014-07-29, negative numebrs should work otherwise anyway.
+                             "'p', " + "SUBSTR(\"" + msg_info.threaddir + "/" + msg_info.filename + "\", 1, LENGTH(\"" + msg_info.threaddir + "/" + msg_info.filename + "\") - 5)" + ") AS line, " // all pages end in ".html", slice it off
+                             + d_part_table + "._id AS rowid, " +
+                             (d_database.tableContainsColumn(d_part_table, "unique_id") ?
+                              d_part_table + ".unique_id AS uniqueid" : "-1 AS uniqueid") +
+                             " FROM " + d_mms_table + " "
+                             "LEFT JOIN thread ON thread._id IS " + d_mms_table + ".thread_id "
+                             "LEFT JOIN " + d_part_table + " ON " + d_part_table + "." + d_part_mid + " IS " + d_mms_table + "._id AND " + d_part_table + "." + d_part_ct + " = 'text/x-signal-plain' AND " + d_part_table + ".quote = 0 "
+                             "WHERE " + d_mms_table + "._id = ?",
+                             msg_info.msg_id, &search_idx_results) ||
+            search_idx_results.rows() < 1) [[unlikely]]
+        {
+          Logger::warning("Search_idx query failed or no results");
+        }
+        else
+        {
+          if (search_idx_results.rows() > 1) [[unlikely]]
+            Logger::warning("Unexpected number of results from search_idx query (",
+                            search_idx_results.rows(), " results, using first)");
+
+          std::string line = search_idx_results("line");
+          if (!line.empty()) [[likely]]
+          {
+            if (search_idx_results.valueAsInt(0, "rowid") != -1
+                /* && search_idx_results.valueAsInt(0, "uniqueid") != -1*/)
+            {
+              long long int rowid = search_idx_results.valueAsInt(0, "rowid");
+              long long int uniqueid = search_idx_results.valueAsInt(0, "uniqueid");
+              AttachmentFrame *a = d_attachments.at({rowid, uniqueid}).get();
+              std::string longbody = std::string(reinterpret_cast<char *>(a->attachmentData()), a->attachmentSize());
+              a->clearData();
+
+              longbody = d_database.getSingleResultAs<std::string>("SELECT json_set(?, '$.b', ?)", {line, longbody}, std::string());
+              if (!longbody.empty()) [[likely]]
+                line = longbody;
+            }
+
+            searchidx_lines->emplace_back(std::move(line));
+          }
+        }
+      }
+
+      // set daterangeidx (which range were we in for the just written message...)
+      for (unsigned int dri = 0; dri < dateranges.size(); ++dri)
+        if (messages.getValueAs<long long int>(messagecount, "date_received") > bepaald::toNumber<long long int>(dateranges[dri].first) &&
+            messages.getValueAs<long long int>(messagecount, "date_received") <= bepaald::toNumber<long long int>(dateranges[dri].second))
+        {
+          daterangeidx = dri;
+          break;
+        }
+
+      if (++messagecount >= messages.rows())
+        break;
+
+      // // BREAK THE CONVERSATION BOX BETWEEN SEPARATE DATE RANGES ON THE SAME PAGE
+
+      // std::cout << daterangeidx << std::endl;
+      // std::cout << "curm: " << messages.getValueAs<long long int>(messagecount, "date_received") << std::endl;
+      // std::cout << "rhig: " << bepaald::toNumber<long long int>(dateranges[daterangeidx].second) << std::endl;
+      // std::cout << "rlow: " << bepaald::toNumber<long long int>(dateranges[daterangeidx + 1].first) << std::endl;
+      // std::cout << (messages.getValueAs<long long int>(messagecount, "date_received") > bepaald::toNumber<long long int>(dateranges[daterangeidx].second) &&
+      //               messages.getValueAs<long long int>(messagecount, "date_received") <= bepaald::toNumber<long long int>(dateranges[daterangeidx + 1].first)) << std::endl;
+      if (!dateranges.empty() &&
+          daterangeidx < dateranges.size() - 1 && // dont split if it's the last range
+          messages.getValueAs<long long int>(messagecount, "date_received") > bepaald::toNumber<long long int>(dateranges[daterangeidx].second))
+      {
+        if (messagecount < (max_msg_per_page * (pagenumber + 1))) // dont break convo-box if we are moving to a new page (because of --split)
+        {
+          // std::cout << "SPLITTING! (rangeend(" << daterangeidx << "): " << dateranges[daterangeidx].second << ")" << std::endl;
+          // std::cout << "         ! (rangeend(" << daterangeidx << "): " << dateranges[daterangeidx + 1].first << ")" << std::endl;
+          // std::cout << "         ! " << messages.getValueAs<long long int>(messagecount, "date_received") << std::endl;
+          htmloutput << "        </div>" << std::endl;
+          htmloutput << "        <div class=\"conversation-box\">" << std::endl;
+          htmloutput << std::endl;
+        }
+      }
+    }
+
+    htmloutput << "        </div>" << '\n'; // closes conversation-box
+    htmloutput << "        <a id=\"pagebottom\"></a>" << '\n';
+    htmloutput << "      </div>" << '\n'; // closes conversation-wrapper
+    htmloutput << '\n';
+
+    if (totalpages > 1)
+    {
+      std::string sanitized_filename = sanitizeFilename(raw_base_filename);
+      HTMLescapeUrl(&sanitized_filename);
+      htmloutput << "      <div class=\"conversation-link conversation-link-left\">" << '\n';
+      htmloutput << "        <div title=\"First page\">" << '\n';
+      htmloutput << "          <a href=\"" << sanitized_filename << ".html" << "\">" << '\n';
+      htmloutput << "            <div class=\"menu-icon nav-max" << (pagenumber > 0 ? "" : " nav-disabled") << "\"></div>" << '\n';
+      htmloutput << "          </a>" << '\n';
+      htmloutput << "        </div>" << '\n';
+      htmloutput << "        <div title=\"Previous page\">" << '\n';
+      htmloutput << "          <a href=\"" << sanitized_filename << (pagenumber - 1 > 0 ? ("_" + bepaald::toString(pagenumber - 1)) : "") << ".html" << "\">" << '\n';
+      htmloutput << "            <div class=\"menu-icon nav-one" << (pagenumber > 0 ? "" : " nav-disabled") << "\"></div>" << '\n';
+      htmloutput << "          </a>" << '\n';
+      htmloutput << "        </div>" << '\n';
+      htmloutput << "      </div>" << '\n';
+      htmloutput << "      <div class=\"conversation-link conversation-link-right\">" << '\n';
+      htmloutput << "        <div title=\"Next page\">" << '\n';
+      htmloutput << "          <a href=\"" << sanitized_filename << "_" << (pagenumber + 1 <= totalpages - 1 ?  bepaald::toString(pagenumber + 1) : bepaald::toString(totalpages - 1)) << ".html" << "\">" << '\n';
+      htmloutput << "            <div class=\"menu-icon nav-one nav-fwd" << (pagenumber < totalpages - 1 ? "" : " nav-disabled") << "\"></div>" << '\n';
+      htmloutput << "          </a>" << '\n';
+      htmloutput << "        </div>" << '\n';
+      htmloutput << "        <div title=\"Last page\">" << '\n';
+      htmloutput << "          <a href=\"" << sanitized_filename << "_" << bepaald::toString(totalpages - 1) << ".html" << "\">" << '\n';
+      htmloutput << "            <div class=\"menu-icon nav-max nav-fwd" << (pagenumber < totalpages - 1 ? "" : " nav-disabled") << "\"></div>" << '\n';
+      htmloutput << "          </a>" << '\n';
+      htmloutput << "        </div>" << '\n';
+      htmloutput << "      </div>" << '\n';
+      htmloutput << '\n';
+    }
+    htmloutput << "     </div>" << '\n'; // closes controls-wrapper
+    htmloutput << '\n';
+    htmloutput << "       <div id=\"bottom\">" << '\n';
+    htmloutput << "         <a href=\"#pagebottom\" title=\"Jump to bottom\">" << '\n';
+    htmloutput << "           <div class=\"menu-item-bottom\">" << '\n';
+    htmloutput << "             <span class=\"menu-icon nav-one nav-bottom\">" << '\n';
+    htmloutput << "             </span>" << '\n';
+    htmloutput << "           </div>" << '\n';
+    htmloutput << "         </a>" << '\n';
+    htmloutput << "      </div>" << '\n';
+    htmloutput << "      <div id=\"menu\">" << '\n';
+    htmloutput << "        <a href=\"../index.html\">" << '\n';
+    htmloutput << "          <div class=\"menu-item\">" << '\n';
+    htmloutput << "            <div class=\"menu-icon nav-up\">" << '\n';
+    htmloutput << "            </div>" << '\n';
+    htmloutput << "            <div>" << '\n';
+    htmloutput << "              index" << '\n';
+    htmloutput << "            </div>" << '\n';
+    htmloutput << "          </div>" << '\n';
+    htmloutput << "        </a>" << '\n';
+    htmloutput << "      </div>" << '\n';
+    htmloutput << '\n';
+    if (themeswitching || searchpage)
+    {
+      htmloutput << "      <div id=\"theme\">" << '\n';
+      if (searchpage)
+      {
+        htmloutput << "        <div class=\"menu-item\">" << '\n';
+        htmloutput << "          <a href=\"../searchpage.html?recipient=" << thread_recipient_id << "\" title=\"Search\">" << '\n';
+        htmloutput << "            <span class=\"menu-icon searchbutton\">" << '\n';
+        htmloutput << "            </span>" << '\n';
+        htmloutput << "          </a>" << '\n';
+        htmloutput << "        </div>" << '\n';
+      }
+      if (themeswitching)
+      {
+        htmloutput << "        <div class=\"menu-item\">" << '\n';
+        htmloutput << "          <label for=\"theme-switch\">" << '\n';
+        htmloutput << "            <span class=\"menu-icon themebutton\">" << '\n';
+        htmloutput << "            </span>" << '\n';
+        htmloutput << "          </label>" << '\n';
+        htmloutput << "        </div>" << '\n';
+      }
+      htmloutput << "      </div>" << '\n';
+      htmloutput << '\n';
+    }
+    htmloutput << "  </div>" << '\n'; // closes div id=page (I think)
+
+    if (addexportdetails)
+      htmloutput << '\n' << exportdetails_html << '\n';
+
+    if (themeswitching)
+    {
+      htmloutput << R"(  <script>
+    const themeSwitch = document.querySelector('#theme-switch');
+    themeSwitch.addEventListener('change', function(e)
+    {
+      if (e.currentTarget.checked === true)
+      {
+        //alert('Setting theme light');
+        setCookie('theme', 'light');
+        document.documentElement.dataset.theme = 'light';
+      }
+      else
+      {
+        //alert('Setting theme dark');
+        setCookie('theme', 'dark');
+        document.documentElement.dataset.theme = 'dark';
+      }
+    });
+  </script>
+
+)";
+    }
+    htmloutput << "  </body>" << '\n';
+    htmloutput << "</html>" << '\n';
+
+    ++pagenumber;
+    if (messagecount >= messages.rows())
+      break;
+  }
+  return true;
+}
@@ -60,6 +60,20 @@ bool SignalBackup::exportBackupToDir(std::string const &directory, bool overwrit
         Logger::error("Failed to open file for writing: ", directory, attachment_basefilename, ".bin");
         return false;
       }
+      else if (!keepattachmentdatainmemory) // no need to load the data, just pass it to the file
+      {
+        bool writeok = true;
+        if (a->streamAttachmentData([&](unsigned char const *data, uint64_t size)
+                                    {
+                                      return (writeok = static_cast<bool>(attachmentstream.write(reinterpret_cast<char const *>(data), size)));
+                                    }) != 0)
+        {
+          if (!writeok)
+            return false;
+          Logger::error("Failed to retrieve attachment data for attachment (rowid: ", rowid, " uniqueid: ", uniqueid, ")");
+          return false;
+        }
+      }
       else
       {
         unsigned char const *data = a->attachmentData();
@@ -64,6 +64,9 @@ bool SignalBackup::exportBackupToFile(std::string const &filename, std::string c
   if (!writeok)
     return false;
 
+  // all other frames are encrypted (possibly on multiple threads) and written in order by the writer
+  BackupFileWriter writer(outputfile, &d_fe, d_verbose);
+
   // VERSION
   Logger::message("Writing DatabaseVersionFrame...");
   if (!d_databaseversionframe)
@@ -71,7 +74,7 @@ bool SignalBackup::exportBackupToFile(std::string const &filename, std::string c
     Logger::error("DataBaseVersionFrame not found");
     return false;
   }
-  if (!writeEncryptedFrame(outputfile, d_databaseversionframe.get()))
+  if (!writer.writeFrame(d_databaseversionframe.get()))
     return false;
 
   // SQL DATABASE + ATTACHMENTS
@@ -117,7 +120,7 @@ bool SignalBackup::exportBackupToFile(std::string const &filename, std::string c
     newframe.setStatementField(results.getValueAs<std::string>(i, 0));
 
     //std::cout << "Writing SqlStatementFrame..." << std::endl;
-    if (!writeEncryptedFrame(outputfile, &newframe))
+    if (!writer.writeFrame(&newframe))
       return false;
   }
 
@@ -142,54 +145,43 @@ bool SignalBackup::exportBackupToFile(std::string const &filename, std::string c
         STRING_STARTS_WITH(table, "sqlite_"))
       continue;
 
-    d_database.exec("SELECT * FROM " + table, &results);
+    // the rows are written as they are read, so the table is never in memory as a whole
+    SqliteDB::Cursor rows = d_database.cursor("SELECT * FROM " + table);
+    long long int totalrows = d_showprogress ? d_database.getSingleResultAs<long long int>("SELECT COUNT(*) FROM " + table, 0) : 0;
 
     if (!d_showprogress)
       Logger::message_start("  Dealing with table '", table, "'... ");
 
-    for (unsigned int i = 0; i < results.rows(); ++i)
+    // columns needed to find the attachment/sticker belonging to a row
+    int idcol = rows.idxOfHeader("_id");
+    bool needuniqqueid = (table == d_part_table && d_database.tableContainsColumn(d_part_table, "unique_id"));
+    int uniqueidcol = needuniqqueid ? rows.idxOfHeader("unique_id") : -1;
+
+    long long int i = 0;
+    for (; rows.step(); ++i)
     {
       if (d_showprogress)
-        Logger::message_overwrite("  Dealing with table '", table, "'... ", i + 1, "/", results.rows(), " entries...");
+        Logger::message_overwrite("  Dealing with table '", table, "'... ", i + 1, "/", totalrows, " entries...");
 
-      SqlStatementFrame newframe = buildSqlStatementFrame(table, results.row(i));
+      SqlStatementFrame newframe = buildSqlStatementFrame(table, rows);
 
       //std::cout << "Writing SqlStatementFrame..." << std::endl;
-      if (!writeEncryptedFrame(outputfile, &newframe))
+      if (!writer.writeFrame(&newframe))
         return false;
 
       if (table == d_part_table) // find corresponding attachment
       {
-        bool needuniqqueid = d_database.tableContainsColumn(d_part_table, "unique_id");
         long long int rowid = 0, uniqueid = needuniqqueid ? 0 : -1;
-        for (unsigned int j = 0; j < results.columns(); ++j)
-        {
-          if (results.header(j) == "_id" && results.valueHasType<long long int>(i, j))
-          {
-            rowid = results.getValueAs<long long int>(i, j);
-            if (rowid && (uniqueid || !needuniqqueid))
-              break;
-          }
-          else if (needuniqqueid &&
-                   results.header(j) == "unique_id" && results.valueHasType<long long int>(i, j))
-          {
-           //std::cout << "UNIQUEID: " << std::any_cast<long long int>(results[i][j].second) << std::endl;
-            uniqueid = results.getValueAs<long long int>(i, j);
-            if (rowid && (uniqueid || !needuniqqueid))
-              break;
-          }
-        }
+        if (idcol != -1 && rows.valueHasType<long long int>(idcol))
+          rowid = rows.getValueAs<long long int>(idcol);
+        if (uniqueidcol != -1 && rows.valueHasType<long long int>(uniqueidcol))
+          uniqueid = rows.getValueAs<long long int>(uniqueidcol);
+
         auto attachment = d_attachments.find({rowid, uniqueid});
         if (attachment != d_attachments.end())
         {
-          if (!writeEncryptedFrame(outputfile, attachment->second.get()))
+          if (!writer.writeFrame(attachment->second.get(), !keepattachmentdatainmemory))
             return false;
-          if (!keepattachmentdatainmemory)
-          {
-            MEMINFO("BEFORE DROPPING ATTACHMENT DATA");
-            attachment->second.get()->clearData();
-            MEMINFO("AFTER DROPPING ATTACHMENT DATA");
-          }
         }
         else [[unlikely]]
         {
@@ -197,37 +189,37 @@ bool SignalBackup::exportBackupToFile(std::string const &filename, std::string c
           {
             Logger::warning("Attachment data not found (rowid: ", rowid, ", uniqueid: ", uniqueid, ")");
             if (d_showprogress)
-              Logger::message_overwrite("  Dealing with table '", table, "'... ", i + 1, "/", results.rows(), " entries...");
+              Logger::message_overwrite("  Dealing with table '", table, "'... ", i + 1, "/", totalrows, " entries...");
           }
         }
       }
       else if (table == "sticker") // find corresponding sticker
       {
         uint64_t rowid = 0;
-        for (unsigned int j = 0; j < results.columns(); ++j)
-          if (results.header(j) == "_id" && results.valueHasType<long long int>(i, j))
-          {
-            rowid = results.getValueAs<long long int>(i, j);
-            break;
-          }
+        if (idcol != -1 && rows.valueHasType<long long int>(idcol))
+          rowid = rows.getValueAs<long long int>(idcol);
         auto sticker = d_stickers.find(rowid);
         if (sticker != d_stickers.end())
         {
-          if (!writeEncryptedFrame(outputfile, sticker->second.get()))
+          if (!writer.writeFrame(sticker->second.get(), !keepattachmentdatainmemory))
             return false;
-          if (!keepattachmentdatainmemory)
-            sticker->second.get()->clearData();
         }
         else
         {
           Logger::warning("Sticker data not found (rowid: ", rowid, ")");
           if (d_showprogress)
-            Logger::message_overwrite("  Dealing with table '", table, "'... ", i + 1, "/", results.rows(), " entries...");
+            Logger::message_overwrite("  Dealing with table '", table, "'... ", i + 1, "/", totalrows, " entries...");
         }
       }
     }
+    if (!rows.ok()) [[unlikely]]
+    {
+      Logger::error("Failed to read table '", table, "'");
+      return false;
+    }
+
     if (d_showprogress)
-      Logger::message_overwrite("  Dealing with table '", table, "'... ", results.rows(), "/", results.rows(), " entries...done", Logger::Control::ENDOVERWRITE);
+      Logger::message_overwrite("  Dealing with table '", table, "'... ", i, "/", i, " entries...done", Logger::Control::ENDOVERWRITE);
     else
       Logger::message_end("done");
   }
@@ -235,13 +227,13 @@ bool SignalBackup::exportBackupToFile(std::string const &filename, std::string c
   Logger::message("Writing SharedPrefFrame(s)...");
   // SHAREDPREFS
   for (unsigned int i = 0; i < d_sharedpreferenceframes.size(); ++i)
-    if (!writeEncryptedFrame(outputfile, d_sharedpreferenceframes[i].get()))
+    if (!writer.writeFrame(d_sharedpreferenceframes[i].get()))
       return false;
 
   Logger::message("Writing KeyValueFrame(s)...");
   // KEYVALUES
   for (unsigned int i = 0; i < d_keyvalueframes.size(); ++i)
-    if (!writeEncryptedFrame(outputfile, d_keyvalueframes[i].get()))
+    if (!writer.writeFrame(d_keyvalueframes[i].get()))
       return false;
 
   // AVATAR
@@ -256,7 +248,7 @@ bool SignalBackup::exportBackupToFile(std::string const &filename, std::string c
       Logger::error_indent("THE PROGRAM WILL LIKELY CRASH NOW...");
     }
 
-    if (!writeEncryptedFrame(outputfile, a.second.get()))
+    if (!writer.writeFrame(a.second.get()))
       return false;
   }
 
@@ -267,7 +259,8 @@ bool SignalBackup::exportBackupToFile(std::string const &filename, std::string c
     Logger::error("EndFrame not found.");
     return false;
   }
-  if (!writeEncryptedFrame(outputfile, d_endframe.get()))
+  if (!writer.writeFrame(d_endframe.get()) ||
+      !writer.finish())
     return false;
 
   outputfile.flush();
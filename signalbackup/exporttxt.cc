@@ -19,23 +19,24 @@
 
 #include "signalbackup.ih"
 #include "msgrange.h"
+#include "../scopeguard/scopeguard.h"
 
 bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long int> const &limittothreads,
                              std::vector<std::string> const &daterangelist, std::string const &selfphone [[maybe_unused]],
                              bool migrate, bool overwrite)
 {
-  bool databasemigrated = false;
-  MemSqliteDB backup_database;
+  bool databasemigrated = false; // migrations are done inside a savepoint, which is rolled back when done
 
   // >= 168 will work already? (not sure if 168 and 169 were ever in production, I don't have them at least)
   if (d_databaseversion == 167)
   {
-    SqliteDB::copyDb(d_database, backup_database);
+    if (!d_database.savepoint("exportmigration"))
+      return false;
     if (!migrateDatabase(167, 170))
     {
       Logger::error("Failed to migrate currently unsupported database version (", d_databaseversion, ")."
                     " Please upgrade your database");
-      SqliteDB::copyDb(backup_database, d_database);
+      d_database.rollbackToSavepoint("exportmigration");
       return false;
     }
     else
@@ -50,12 +51,13 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
       Logger::error_indent("migrate this database to a supported version.");
       return false;
     }
-    SqliteDB::copyDb(d_database, backup_database);
+    if (!d_database.savepoint("exportmigration"))
+      return false;
     if (!migrateDatabase(d_databaseversion, 170)) // migrate == TRUE, but migration fails
     {
       Logger::error("Failed to migrate currently unsupported database version (", d_databaseversion, ")."
                     " Please upgrade your database");
-      SqliteDB::copyDb(backup_database, d_database);
+      d_database.rollbackToSavepoint("exportmigration");
       return false;
     }
     else
@@ -66,7 +68,7 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
   if (!prepareOutputDirectory(directory, overwrite))
   {
     if (databasemigrated)
-      SqliteDB::copyDb(backup_database, d_database);
+      d_database.rollbackToSavepoint("exportmigration");
     return false;
   }
 
@@ -89,7 +91,7 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
   //       }
   //     }
   //     if (databasemigrated)
-  //       SqliteDB::copyDb(backup_database, d_database);
+  //       d_database.rollbackToSavepoint("exportmigration");
   //     return false;
   //   }
   // }
@@ -101,7 +103,7 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
   //   std::cout << bepaald::bold_on << "Error" << bepaald::bold_off
   //             << ": `" << directory << "' is not a directory." << std::endl;
   //   if (databasemigrated)
-  //     SqliteDB::copyDb(backup_database, d_database);
+  //     d_database.rollbackToSavepoint("exportmigration");
   //   return false;
   // }
 
@@ -113,7 +115,7 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
   //     std::cout << bepaald::bold_on << "Error" << bepaald::bold_off
   //               << ": Directory '" << directory << "' is not empty. Use --overwrite to clear directory before export." << std::endl;
   //     if (databasemigrated)
-  //       SqliteDB::copyDb(backup_database, d_database);
+  //       d_database.rollbackToSavepoint("exportmigration");
   //     return false;
   //   }
   //   std::cout << "Clearing contents of directory '" << directory << "'..." << std::endl;
@@ -122,7 +124,7 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
   //     std::cout << bepaald::bold_on << "Error" << bepaald::bold_off
   //               << ": Failed to empty directory '" << directory << "'" << std::endl;
   //     if (databasemigrated)
-  //       SqliteDB::copyDb(backup_database, d_database);
+  //       d_database.rollbackToSavepoint("exportmigration");
   //     return false;
   //   }
   // }
@@ -176,6 +178,14 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
   std::sort(dateranges.begin(), dateranges.end());
 
 
+  if (!createMessageCountsTable())
+  {
+    if (databasemigrated)
+      d_database.rollbackToSavepoint("exportmigration");
+    return false;
+  }
+  ScopeGuard drop_message_counts([&](){ d_database.exec("DROP TABLE IF EXISTS temp.message_counts"); });
+
   // handle each thread
   for (int t : threads)
   {
@@ -212,12 +222,8 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
                          (d_database.tableContainsColumn(d_mms_table, "message_extras") ? "message_extras, " : "") +
                          "expires_in"
                          " FROM " + d_mms_table + " "
-                         // get attachment count for message:
-                         "LEFT JOIN (SELECT " + d_part_mid + " AS message_id, COUNT(*) AS attcount FROM " + d_part_table + " GROUP BY message_id) AS attmnts ON " + d_mms_table + "._id = attmnts.message_id "
-                         // get reaction count for message:
-                         "LEFT JOIN (SELECT message_id, COUNT(*) AS reactioncount FROM reaction GROUP BY message_id) AS rctns ON " + d_mms_table + "._id = rctns.message_id "
-                         // get mention count for message:
-                         "LEFT JOIN (SELECT message_id, COUNT(*) AS mentioncount FROM mention GROUP BY message_id) AS mntns ON " + d_mms_table + "._id = mntns.message_id "
+                         // get attachment, reaction and mention counts for message (see createMessageCountsTable()):
+                         "LEFT JOIN temp.message_counts AS msgcounts ON " + d_mms_table + "._id = msgcounts.message_id "
                          "WHERE thread_id = ?"
                          + datewhereclause +
                          + (d_database.tableContainsColumn(d_mms_table, "latest_revision_id") ? " AND latest_revision_id IS NULL" : "") +
@@ -225,7 +231,7 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
     {
       Logger::error("Failed to query database for messages");
       if (databasemigrated)
-        SqliteDB::copyDb(backup_database, d_database);
+        d_database.rollbackToSavepoint("exportmigration");
       return false;
     }
     if (messages.rows() == 0)
@@ -251,7 +257,7 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
     {
       Logger::error("Refusing to overwrite existing file");
       if (databasemigrated)
-        SqliteDB::copyDb(backup_database, d_database);
+        d_database.rollbackToSavepoint("exportmigration");
       return false;
     }
 
@@ -260,7 +266,7 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
     {
       Logger::error("Failed to open '", directory, "/", filename, " for writing.");
       if (databasemigrated)
-        SqliteDB::copyDb(backup_database, d_database);
+        d_database.rollbackToSavepoint("exportmigration");
       return false;
     }
 
@@ -377,7 +383,7 @@ bool SignalBackup::exportTxt(std::string const &directory, std::vector<long long
   if (databasemigrated)
   {
     Logger::message("restoring migrated database...");
-    SqliteDB::copyDb(backup_database, d_database);
+    d_database.rollbackToSavepoint("exportmigration");
   }
   return true;
 }
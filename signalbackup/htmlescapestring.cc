@@ -26,70 +26,58 @@ std::string SignalBackup::HTMLescapeString(std::string const &body) const
   return result;
 }
 
-void SignalBackup::HTMLescapeString(std::string *body, std::set<int> const *const positions_excluded_from_escape) const
+void SignalBackup::HTMLescapeString(std::string *body, std::vector<std::pair<unsigned int, unsigned int>> const *const positions_excluded_from_escape) const
 {
   // escape special html chars second, so the span's added by emojifinder (next) aren't escaped
-  int positions_added = 0;
-  for (unsigned int i = 0; i < body->length(); ++i)
+
+  // most strings have nothing to escape
+  std::string::size_type pos = body->find_first_of("&<>\"'");
+  if (pos == std::string::npos) [[likely]]
+    return;
+
+  // build the escaped string in a single pass. positions_excluded_from_escape are
+  // (start, length)-intervals into the unescaped body, sorted by start
+  std::string result;
+  result.reserve(body->size() + 32);
+  std::string::size_type copied = 0;
+  unsigned int excludedidx = 0;
+  for (; pos != std::string::npos; pos = body->find_first_of("&<>\"'", pos + 1))
   {
-    //std::cout << "I, POSITIONS_ADDED: " << i << "," << positions_added << std::endl;
-    switch ((*body)[i])
+    if (positions_excluded_from_escape)
+    {
+      while (excludedidx < positions_excluded_from_escape->size() &&
+             (*positions_excluded_from_escape)[excludedidx].first + (*positions_excluded_from_escape)[excludedidx].second <= pos)
+        ++excludedidx;
+      if (excludedidx < positions_excluded_from_escape->size() &&
+          (*positions_excluded_from_escape)[excludedidx].first <= pos)
+        continue;
+    }
+
+    result.append(*body, copied, pos - copied);
+    switch ((*body)[pos])
     {
       case '&':
-        if (!positions_excluded_from_escape ||
-            //!positions_excluded_from_escape->contains(i - positions_added)
-            !bepaald::contains(positions_excluded_from_escape, (i - positions_added)))
-        {
-          body->replace(i, 1, "&amp;");
-          positions_added += STRLEN("&amp;") - 1;
-          i += STRLEN("&amp;") - 1;
-          //changed = true;
-        }
+        result += "&amp;";
         break;
       case '<':
-        if (!positions_excluded_from_escape ||
-            //!positions_excluded_from_escape->contains(i - positions_added
-            !bepaald::contains(positions_excluded_from_escape, (i - positions_added)))
-        {
-          body->replace(i, 1, "&lt;");
-          positions_added += STRLEN("&lt;") - 1;
-          i += STRLEN("&lt;") - 1;
-          //changed = true;
-        }
+        result += "&lt;";
         break;
       case '>':
-        if (!positions_excluded_from_escape ||
-          //!positions_excluded_from_escape->contains(i - positions_added))
-            !bepaald::contains(positions_excluded_from_escape, (i - positions_added)))
-        {
-          body->replace(i, 1, "&gt;");
-          i += STRLEN("&gt;") - 1;
-          positions_added += STRLEN("&gt;") - 1;
-          //changed = true;
-        }
+        result += "&gt;";
         break;
       case '"':
-        if (!positions_excluded_from_escape ||
-            //!positions_excluded_from_escape->contains(i - positions_added))
-            !bepaald::contains(positions_excluded_from_escape, (i - positions_added)))
-        {
-          body->replace(i, 1, "&quot;");
-          i += STRLEN("&quot;") - 1;
-          positions_added += STRLEN("&quot;") - 1;
-          //changed = true;
-        }
+        result += "&quot;";
         break;
       case '\'':
-        if (!positions_excluded_from_escape ||
-            //!positions_excluded_from_escape->contains(i - positions_added))
-            !bepaald::contains(positions_excluded_from_escape, (i - positions_added)))
-        {
-          body->replace(i, 1, "&apos;");
-          i += STRLEN("&apos;") - 1;
-          positions_added += STRLEN("&apos;") - 1;
-          //changed = true;
-        }
+        result += "&apos;";
         break;
     }
+    copied = pos + 1;
   }
+
+  if (copied == 0) // everything was excluded
+    return;
+
+  result.append(*body, copied);
+  body->swap(result);
 }
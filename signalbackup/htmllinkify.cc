@@ -41,92 +41,138 @@ void SignalBackup::HTMLLinkify(std::string const &body, std::vector<Range> *rang
   if (!possible_link) [[likely]]
     return;
 
-  pos = 0;
-  std::smatch url_match_result;
-  std::string bodycopy(body);
-  while (std::regex_search(bodycopy, url_match_result, s_linkify_pattern))
+  // No link the pattern can match contains whitespace, and every match contains either "://" (url
+  // with protocol) or a '.' followed by a letter, digit or non-ascii character (email, domain name
+  // or ip address). So instead of running the regex over the entire body, scan the body once for
+  // whitespace-delimited words containing one of those, and only search the regex in those. The
+  // words are searched in place, with the surrounding text marked available, so '\b', '^' and '$'
+  // behave as they would when searching the entire body.
+  auto is_space = [](char c) { return c == ' ' || (c >= '\t' && c <= '\r'); };
+  auto is_label_start = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || (static_cast<unsigned char>(c) & 0x80); };
+
+  // utf16 offset of the start of the body up to byte 'utf16_idx', only ever moves forward
+  unsigned int utf16_idx = 0;
+  long long int utf16_offset = 0;
+
+  for (std::string::size_type word_start = 0; word_start < body.size(); )
   {
-    //std::cout << "MATCH : " << url_match_result[0] << " (" << url_match_result.size() << " matches total)"
-    //          << " : " << pos + url_match_result.position(0) << " " << url_match_result.length(0) << std::endl;
-    // for (const auto &res : url_match_result)
-    //   std::cout << (res.str().empty() ? "0" : "1");
-    // std::cout << std::endl;
-
-    // get offset+length if string was utf16
-    long long int match_start = 0;
-    for (unsigned int i = 0; i < pos + url_match_result.position(0); )
+    if (is_space(body[word_start]))
     {
-      int utf8size = bytesToUtf8CharSize(body, i);
-      match_start += utf16CharSize(body, i);
-      i += utf8size;
+      ++word_start;
+      continue;
     }
-    //std::cout << "startpos : " << match_start << std::endl;
 
-    long long int match_length = 0;
-    for (unsigned int i = pos + url_match_result.position(0); i < pos + url_match_result.position(0) + url_match_result.length(0); )
+    bool candidate = false;
+    std::string::size_type word_end = word_start;
+    for (; word_end < body.size() && !is_space(body[word_end]); ++word_end)
+      if ((body[word_end] == '.' && word_end + 1 < body.size() && is_label_start(body[word_end + 1])) ||
+          (body[word_end] == ':' && body.compare(word_end, STRLEN("://"), "://") == 0))
+        candidate = true;
+
+    if (!candidate) [[likely]]
     {
-      int utf8size = bytesToUtf8CharSize(body, i);
-      match_length += utf16CharSize(body, i);
-      i += utf8size;
+      word_start = word_end;
+      continue;
     }
-    //std::cout << "match length : " << match_length << std::endl;
-
-    // url_match_result.length(2) > 0 -> EMAIL
-    // url_match_result.length(3) > 0 -> URL_WITH_PROTOCOL
-    // url_match_result.length(9/10) > 0 -> URL_NO_PROTOCOL
-
-    std::string match_link(url_match_result.str(0));
-    /*
-      This really shouldn't happen I think, but I have a link with multiple # signs
-      in my backup. This is not valid, and causes the HTML to not be valid, so
-      we escape it.
-      Other such issues may also appear in the future
-    */
-    size_t escapepos = 0;
-    if ((escapepos = match_link.find('#')) != std::string::npos) [[unlikely]]
+
+    std::regex_constants::match_flag_type flags = std::regex_constants::match_default;
+    if (word_start > 0)
+      flags |= std::regex_constants::match_prev_avail;
+    if (word_end < body.size())
+      flags |= std::regex_constants::match_not_eol;
+
+    std::smatch url_match_result;
+    std::string::const_iterator search_start = body.begin() + word_start;
+    std::string::const_iterator const search_end = body.begin() + word_end;
+    while (search_start != search_end &&
+           std::regex_search(search_start, search_end, url_match_result, s_linkify_pattern, flags))
     {
-      size_t start_pos = escapepos;
-      while ((start_pos = match_link.find('#', start_pos + 1)) != std::string::npos)
+      //std::cout << "MATCH : " << url_match_result[0] << " (" << url_match_result.size() << " matches total)"
+      //          << " : " << pos + url_match_result.position(0) << " " << url_match_result.length(0) << std::endl;
+      // for (const auto &res : url_match_result)
+      //   std::cout << (res.str().empty() ? "0" : "1");
+      // std::cout << std::endl;
+
+      pos = (search_start - body.begin()) + url_match_result.position(0);
+
+      // get offset+length if string was utf16
+      for (; utf16_idx < pos; )
       {
-        match_link.replace(start_pos, 1, "%23");
-        start_pos += STRLEN("%23");
+        int utf8size = bytesToUtf8CharSize(body, utf16_idx);
+        utf16_offset += utf16CharSize(body, utf16_idx);
+        utf16_idx += utf8size;
       }
-    }
+      long long int match_start = utf16_offset;
+      //std::cout << "startpos : " << match_start << std::endl;
 
-    if (url_match_result.length(3) > 0) // -> URL_WITH_PROTOCOL
-      ranges->emplace_back(Range{match_start, //static_cast<long long int>(pos) + url_match_result.position(0),
-                                 match_length, //url_match_result.length(0),
-                                 "<a class=\"unstyled-link\" href=\"" + match_link + "\">",
-                                 "",
-                                 "</a>",
-                                 true});
-    else if (url_match_result.length(9) > 0) // -> URL_WITHOUT_PROTOCOL
-      /* Here, we add the protocol manually (guessing it to be https),
-         without a protocol, the 'link' will be interpreted as a location
-         in the current domain (file://HTMLDIR/Conversation/Page.html/www.example.com),
-         a workaround, using just "//" as the protocol does signal that the link
-         is at a new root, but automatically uses the current protocol (which is file://,
-         which is not correct.
+      long long int match_length = 0;
+      for (unsigned int i = pos; i < pos + url_match_result.length(0); )
+      {
+        int utf8size = bytesToUtf8CharSize(body, i);
+        match_length += utf16CharSize(body, i);
+        i += utf8size;
+      }
+      //std::cout << "match length : " << match_length << std::endl;
+
+      // url_match_result.length(2) > 0 -> EMAIL
+      // url_match_result.length(3) > 0 -> URL_WITH_PROTOCOL
+      // url_match_result.length(9/10) > 0 -> URL_NO_PROTOCOL
+
+      std::string match_link(url_match_result.str(0));
+      /*
+        This really shouldn't happen I think, but I have a link with multiple # signs
+        in my backup. This is not valid, and causes the HTML to not be valid, so
+        we escape it.
+        Other such issues may also appear in the future
       */
-      ranges->emplace_back(Range{match_start, //static_cast<long long int>(pos) + url_match_result.position(0),
-                                 match_length, //url_match_result.length(0),
-                                 "<a class=\"unstyled-link\" href=\"https://" + match_link + "\">",
-                                 "",
-                                 "</a>",
-                                 true});
-    else if (url_match_result.length(2) > 0) // -> EMAIL
-      ranges->emplace_back(Range{match_start, //static_cast<long long int>(pos) + url_match_result.position(0),
-                                 match_length, //url_match_result.length(0),
-                                 "<a class=\"unstyled-link\" href=\"mailto:" + match_link + "\">",
-                                 "",
-                                 "</a>",
-                                 true});
-
-
-    pos += url_match_result.position(0) + url_match_result.length(0);
-    bodycopy = url_match_result.suffix();
-  }
+      size_t escapepos = 0;
+      if ((escapepos = match_link.find('#')) != std::string::npos) [[unlikely]]
+      {
+        size_t start_pos = escapepos;
+        while ((start_pos = match_link.find('#', start_pos + 1)) != std::string::npos)
+        {
+          match_link.replace(start_pos, 1, "%23");
+          start_pos += STRLEN("%23");
+        }
+      }
 
+      if (url_match_result.length(3) > 0) // -> URL_WITH_PROTOCOL
+        ranges->emplace_back(Range{match_start, //static_cast<long long int>(pos) + url_match_result.position(0),
+                                   match_length, //url_match_result.length(0),
+                                   "<a class=\"unstyled-link\" href=\"" + match_link + "\">",
+                                   "",
+                                   "</a>",
+                                   true});
+      else if (url_match_result.length(9) > 0) // -> URL_WITHOUT_PROTOCOL
+        /* Here, we add the protocol manually (guessing it to be https),
+           without a protocol, the 'link' will be interpreted as a location
+           in the current domain (file://HTMLDIR/Conversation/Page.html/www.example.com),
+           a workaround, using just "//" as the protocol does signal that the link
+           is at a new root, but automatically uses the current protocol (which is file://,
+           which is not correct.
+        */
+        ranges->emplace_back(Range{match_start, //static_cast<long long int>(pos) + url_match_result.position(0),
+                                   match_length, //url_match_result.length(0),
+                                   "<a class=\"unstyled-link\" href=\"https://" + match_link + "\">",
+                                   "",
+                                   "</a>",
+                                   true});
+      else if (url_match_result.length(2) > 0) // -> EMAIL
+        ranges->emplace_back(Range{match_start, //static_cast<long long int>(pos) + url_match_result.position(0),
+                                   match_length, //url_match_result.length(0),
+                                   "<a class=\"unstyled-link\" href=\"mailto:" + match_link + "\">",
+                                   "",
+                                   "</a>",
+                                   true});
+
+
+      // continue right after the match. Note the remainder is searched as if it was a new
+      // string (no previous character available), as it always has been.
+      search_start = url_match_result[0].second;
+      flags &= ~std::regex_constants::match_prev_avail;
+    }
+    word_start = word_end;
+  }
 }
 
 
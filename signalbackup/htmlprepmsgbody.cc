@@ -130,7 +130,7 @@ bool SignalBackup::HTMLprepMsgBody(std::string *body, std::vector<std::tuple<lon
   if (linkify && !hasstyledlinks)
     HTMLLinkify(*body, &ranges);
 
-  std::set<int> positions_excluded_from_escape;
+  std::vector<std::pair<unsigned int, unsigned int>> positions_excluded_from_escape;
   applyRanges(body, &ranges, &positions_excluded_from_escape);
 
   HTMLescapeString(body, &positions_excluded_from_escape);
@@ -159,18 +159,32 @@ bool SignalBackup::HTMLprepMsgBody(std::string *body, std::vector<std::tuple<lon
   }
 
   // surround emoji with span
-  std::string pre = "<span class=\"msg-emoji\">";
-  std::string post = "</span>";
-  int moved = 0;
+  if (emoji_pos.empty())
+    return all_emoji;
+
+  std::string const pre = "<span class=\"msg-emoji\">";
+  std::string const post = "</span>";
+  std::string result;
+  result.reserve(body->size() + emoji_pos.size() * (pre.size() + post.size()));
+  unsigned int copied = 0;
   for (auto const &p : emoji_pos)
   {
-    if (!positions_excluded_from_escape.contains(p.first)) [[likely]]
-    {
-      body->insert(p.first + moved, pre);
-      body->insert(p.first + p.second + pre.size() + moved, post);
-      moved += pre.size() + post.size();
-    }
+    // check if p.first is in one of the (sorted) excluded intervals
+    auto excluded = std::upper_bound(positions_excluded_from_escape.begin(), positions_excluded_from_escape.end(), p.first,
+                                     [](unsigned int pos, std::pair<unsigned int, unsigned int> const &interval) { return pos < interval.first; });
+    if (excluded != positions_excluded_from_escape.begin() &&
+        p.first < std::prev(excluded)->first + std::prev(excluded)->second) [[unlikely]]
+      continue;
+
+    result.append(*body, copied, p.first - copied);
+    result += pre;
+    result.append(*body, p.first, p.second);
+    result += post;
+    copied = p.first + p.second;
   }
+  if (copied < body->size())
+    result.append(*body, copied);
+  body->swap(result);
 
   return all_emoji;
 
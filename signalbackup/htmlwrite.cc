@@ -73,7 +73,7 @@ bool SignalBackup::HTMLwriteStart(std::ofstream &file, long long int thread_reci
 
   std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
   //file << "<!-- Generated on " << std::put_time(std::localtime(&now), "%F %T") // %F and %T do not work on minGW
-  file << "<!-- Generated on " << std::put_time(std::localtime(&now), "%Y-%m-%d %H:%M:%S")
+  file << "<!-- Generated on " << bepaald::toDateString(now, "%Y-%m-%d %H:%M:%S")
        << " by signalbackup-tools (" << VERSIONDATE << "). "
        << "Input database version: " << d_databaseversion << ". -->" << std::endl;
 
@@ -1880,7 +1880,7 @@ void SignalBackup::HTMLwriteAttachmentDiv(std::ofstream &htmloutput, SqliteDB::Q
         {
           // get datestring
           std::time_t epoch = datum / 1000;
-          tmp << std::put_time(std::localtime(&epoch), "signal-%Y-%m-%d-%H%M%S");
+          tmp << bepaald::toDateString(epoch, "signal-%Y-%m-%d-%H%M%S");
         }
         else
           tmp << "signal";
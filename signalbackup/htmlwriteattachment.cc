@@ -85,8 +85,17 @@ bool SignalBackup::HTMLwriteAttachment(std::string const &directory, std::string
   }
   else
   {
-    if (!attachmentstream.write(reinterpret_cast<char *>(a->attachmentData()), a->attachmentSize()))
+    if (a->streamAttachmentData([&](unsigned char const *data, uint64_t size)
+                                {
+                                  return static_cast<bool>(attachmentstream.write(reinterpret_cast<char const *>(data), size));
+                                }) != 0)
+    {
+      // do not leave a partial (or corrupted) file behind
+      attachmentstream.close();
+      std::error_code ec;
+      std::filesystem::remove(attachment_filename_full, ec);
       return false;
+    }
     // write was succesfull. drop attachment data
     a->clearData();
   }
@@ -699,7 +699,7 @@ bool SignalBackup::writeStickerToDisk(long long int id, std::string const &packi
   // write actual file to disk
 
   // find the sticker with id
-  auto it = std::find_if(d_stickers.begin(), d_stickers.end(), [id](auto const &s) { return s.first == static_cast<uint64_t>(id); });
+  auto it = d_stickers.find(id);
   if (it == d_stickers.end()) [[unlikely]]
   {
     Logger::warning("Failed to find sticker (id: ", id, ")");
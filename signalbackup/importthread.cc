@@ -21,7 +21,14 @@
 
 bool SignalBackup::importThread(SignalBackup *source, long long int thread)
 {
-  Logger::message(__FUNCTION__, " (", thread, ")");
+  return importThread(source, std::vector<long long int>{thread});
+}
+
+// imports the requested threads in one pass: the source is cropped once, its ids are adjusted once
+// and every table is copied once. Note this modifies (and takes frames from) source.
+bool SignalBackup::importThread(SignalBackup *source, std::vector<long long int> const &threadlist)
+{
+  Logger::message(__FUNCTION__, " (", threadlist, ")");
 
   // known incompatibilities. There are almost certainly also unknown ones!
   if ((d_databaseversion >= 215 && source->d_databaseversion < 215) || // part.unique_id dropped from db
@@ -104,24 +111,28 @@ bool SignalBackup::importThread(SignalBackup *source, long long int thread)
       break;
     }
 
-  long long int targetthread = -1;
-  SqliteDB::QueryResults results;
-  if (d_databaseversion < 24) // old database version
+  // get the recipient of a source thread: its recipient_id for old databases, the recipient's
+  // identifying details for newer ones. Returns 0 on success, 1 on error and 2 if the thread is
+  // the releasechannel thread (which is skipped).
+  auto sourceThreadRecipient = [&](long long int thread, std::string *recipient_id, RecipientIdentification *rec_id) -> int
   {
-    // get targetthread from source thread id (source.thread_id->source.recipient_id->target.thread_id
-    source->d_database.exec("SELECT " + source->d_thread_recipient_id + " FROM thread WHERE _id = ?", thread, &results);
-    if (results.rows() != 1 || results.columns() != 1 ||
-        !results.valueHasType<std::string>(0, 0))
+    SqliteDB::QueryResults results;
+    if (d_databaseversion < 24) // old database version
     {
-      Logger::error("Failed to get recipient id from source database");
-      return false;
+      // get recipient from source thread id (source.thread_id->source.recipient_id)
+      source->d_database.exec("SELECT " + source->d_thread_recipient_id + " FROM thread WHERE _id = ?", thread, &results);
+      if (results.rows() != 1 || results.columns() != 1 ||
+          !results.valueHasType<std::string>(0, 0))
+      {
+        Logger::error("Failed to get recipient id from source database");
+        return 1;
+      }
+      *recipient_id = results.getValueAs<std::string>(0, 0);
+      return 0;
     }
-    std::string recipient_id = results.getValueAs<std::string>(0, 0);
-    targetthread = getThreadIdFromRecipient(recipient_id); // -1 if none found
-  }
-  else // new database version
-  {
-    // get targetthread from source thread id (source.thread_id->source.recipient_id->source.recipient.phone/group_id->target.thread_id
+
+    // new database version
+    // get recipient from source thread id (source.thread_id->source.recipient_id->source.recipient.phone/group_id
     if (source->d_database.tableContainsColumn("recipient", source->d_recipient_aci, source->d_recipient_e164,
                                                "group_id", "distribution_list_id",  source->d_recipient_storage_service))
       source->d_database.exec("SELECT "
@@ -156,21 +167,29 @@ bool SignalBackup::importThread(SignalBackup *source, long long int thread)
            (res2.valueHasType<std::string>(0, 0) && bepaald::toNumber<int>(res2.getValueAs<std::string>(0, 0)) == source_releasechannel)))
       {
         Logger::message("Skipping releasechannel...");
-        return true; // when this channel is actually active, maybe remove this return statement and
-                     // manually set targetthread with the help of target_releasechannel (if != -1)
+        return 2; // when this channel is actually active, maybe import it anyway and
+                  // manually set targetthread with the help of target_releasechannel (if != -1)
       }
 
       Logger::error("Failed to get uuid/phone/group_id from source database");
-      return false;
+      return 1;
     }
 
     //std::string phone_or_group = results.getValueAs<std::string>(0, 0);
-    RecipientIdentification rec_id = {results(0, "uuid"), results(0, "phone"), results(0, "group_id"), results(0, "distribution_id"), results(0, "storage_service")};
+    *rec_id = {results(0, "uuid"), results(0, "phone"), results(0, "group_id"), results(0, "distribution_id"), results(0, "storage_service")};
+    return 0;
+  };
+
+  // find the existing thread in target belonging to the recipient of a source thread (-1 if none found)
+  auto findTargetThread = [&](std::string const &recipient_id, RecipientIdentification const &rec_id) -> long long int
+  {
+    if (d_databaseversion < 24) // old database version
+      return getThreadIdFromRecipient(recipient_id); // -1 if none found
 
     if (d_verbose) [[unlikely]]
       Logger::message("Trying to match source recipient: {\"", rec_id.uuid, "\", \"", rec_id.phone, "\", \"", rec_id.group_id, "\"}");
 
-
+    SqliteDB::QueryResults results;
     if (d_database.tableContainsColumn("recipient", "distribution_list_id"))
     {
       long long int distribution_list_id = d_database.getSingleResultAs<long long int>("SELECT _id FROM distribution_list WHERE distribution_id = ?",
@@ -207,22 +226,38 @@ bool SignalBackup::importThread(SignalBackup *source, long long int thread)
     if (results.rows() != 1 || results.columns() != 1 ||
         !results.valueHasType<long long int>(0, 0))
     {
-
       Logger::message("Failed to find recipient._id matching uuid/phone/group_id in target database");
       // d_database.prettyPrint("SELECT _id, " + d_recipient_aci + "," + d_recipient_e164 + ",group_id FROM recipient "
       //                        "WHERE " + d_recipient_aci + " = ? OR " +
       //                        d_recipient_e164 + " = ? OR group_id = ?", {rec_id.uuid, rec_id.phone, rec_id.group_id});
+      return -1;
     }
-    else
-    {
-      long long int recipient_id = results.getValueAs<long long int>(0, 0);
-      targetthread = getThreadIdFromRecipient(bepaald::toString(recipient_id));
 
-      if (d_verbose) [[unlikely]]
-        Logger::message("Matched source recipient with target ", recipient_id, ", targetthread: ", targetthread);
+    long long int target_recipient_id = results.getValueAs<long long int>(0, 0);
+    long long int targetthread = getThreadIdFromRecipient(bepaald::toString(target_recipient_id));
 
-    }
+    if (d_verbose) [[unlikely]]
+      Logger::message("Matched source recipient with target ", target_recipient_id, ", targetthread: ", targetthread);
+
+    return targetthread;
+  };
+
+  // check the requested threads: skip the releasechannel, fail if the recipient is not found
+  std::vector<long long int> threads;
+  for (long long int thread : threadlist)
+  {
+    std::string recipient_id;
+    RecipientIdentification rec_id;
+    int res = sourceThreadRecipient(thread, &recipient_id, &rec_id);
+    if (res == 1)
+      return false;
+    if (res == 0)
+      threads.push_back(thread);
   }
+  if (threads.empty()) // nothing left to import
+    return true;
+
+  SqliteDB::QueryResults results;
 
   // std::cout << "RECIPIENTS BEFORE CROP:" << std::endl;
   // source->d_database.prettyPrint("SELECT _id, COALESCE(signal_profile_name, group_id) FROM recipient");
@@ -230,32 +265,33 @@ bool SignalBackup::importThread(SignalBackup *source, long long int thread)
   // delete doubles
   /* work in progress */
   /* I dont think the recipentId == recipientId part is right */
-  if (false /*skipexisting*/ && targetthread != -1)
-  {
-    SqliteDB::QueryResults existing;
-    d_database.exec("SELECT body, thread_id, " + d_mms_date_sent + ", " + d_mms_recipient_id + " FROM " + d_mms_table +
-                    " WHERE thread_id = ?", targetthread, &existing);
-    int count = 0;
-    for (unsigned int i = 0; i < existing.rows(); ++i)
-    {
-      source->d_database.exec("DELETE FROM " + d_mms_table +
-                              " WHERE body = ? AND thread_id = ? AND " + d_mms_date_sent + " = ? AND " + d_mms_recipient_id + " = ?",
-                              {existing.value(i, "body"), thread, existing.value(i, d_mms_date_sent), existing.value(i, d_mms_recipient_id)});
-      count += source->d_database.changed();
-    }
-    if (count)
-      Logger::message("  Deleted ", count, " existing messages in source thread");
-
-    // check if any messages are left:
-    if (source->d_database.getSingleResultAs<long long int>("SELECT COUNT(*) FROM " + d_mms_table + " WHERE thread_id = ?", thread, -1) == 0)
-    {
-      Logger::message("After removing existing messages, thread is empty -> skipping...");
-      return true;
-    }
-  }
-
-  // crop the source db to the specified thread
-  source->cropToThread(thread);
+  // (should be done per thread, after matching the threads below)
+  // if (false /*skipexisting*/ && targetthread != -1)
+  // {
+  //   SqliteDB::QueryResults existing;
+  //   d_database.exec("SELECT body, thread_id, " + d_mms_date_sent + ", " + d_mms_recipient_id + " FROM " + d_mms_table +
+  //                   " WHERE thread_id = ?", targetthread, &existing);
+  //   int count = 0;
+  //   for (unsigned int i = 0; i < existing.rows(); ++i)
+  //   {
+  //     source->d_database.exec("DELETE FROM " + d_mms_table +
+  //                             " WHERE body = ? AND thread_id = ? AND " + d_mms_date_sent + " = ? AND " + d_mms_recipient_id + " = ?",
+  //                             {existing.value(i, "body"), thread, existing.value(i, d_mms_date_sent), existing.value(i, d_mms_recipient_id)});
+  //     count += source->d_database.changed();
+  //   }
+  //   if (count)
+  //     Logger::message("  Deleted ", count, " existing messages in source thread");
+  //
+  //   // check if any messages are left:
+  //   if (source->d_database.getSingleResultAs<long long int>("SELECT COUNT(*) FROM " + d_mms_table + " WHERE thread_id = ?", thread, -1) == 0)
+  //   {
+  //     Logger::message("After removing existing messages, thread is empty -> skipping...");
+  //     return true;
+  //   }
+  // }
+
+  // crop the source db to the specified threads
+  source->cropToThread(threads);
 
   // std::cout << "RECIPIENTS AFTER CROP:" << std::endl;
   // source->d_database.prettyPrint("SELECT _id, COALESCE(signal_profile_name, group_id) FROM recipient");
@@ -512,21 +548,46 @@ table|sender_keys|sender_keys|71|CREATE TABLE sender_keys (_id INTEGER PRIMARY K
     }
   }
 
-  // merge into existing thread, set the id on the sms, mms, and drafts
-  // drop the recipient_preferences, identities and thread tables, they are already in the target db
-  if (targetthread > -1)
+  // now the source ids are final, find out which threads already exist in target
+  std::vector<std::pair<long long int, long long int>> mergedthreads; // {source thread, target thread}
+  unsigned int newthreads = 0;
+  {
+    SqliteDB::QueryResults sourcethreads;
+    source->d_database.exec("SELECT _id FROM thread", &sourcethreads);
+    for (unsigned int i = 0; i < sourcethreads.rows(); ++i)
+    {
+      long long int sourcethread = sourcethreads.valueAsInt(i, 0);
+      std::string recipient_id;
+      RecipientIdentification rec_id;
+      if (sourceThreadRecipient(sourcethread, &recipient_id, &rec_id) != 0)
+        return false;
+      long long int targetthread = findTargetThread(recipient_id, rec_id);
+      if (targetthread > -1)
+        mergedthreads.emplace_back(sourcethread, targetthread);
+      else
+        ++newthreads;
+    }
+  }
+
+  // merge into existing threads, set the id on the sms, mms, and drafts
+  for (auto const &[sourcethread, targetthread] : mergedthreads)
   {
     Logger::message("  Found existing thread for this recipient in target database, merging into thread ", targetthread);
 
     if (source->d_database.containsTable("sms"))
-      source->d_database.exec("UPDATE sms SET thread_id = ?", targetthread);
-    source->d_database.exec("UPDATE " + source->d_mms_table + " SET thread_id = ?", targetthread);
-    source->d_database.exec("UPDATE drafts SET thread_id = ?", targetthread);
+      source->d_database.exec("UPDATE sms SET thread_id = ? WHERE thread_id = ?", {targetthread, sourcethread});
+    source->d_database.exec("UPDATE " + source->d_mms_table + " SET thread_id = ? WHERE thread_id = ?", {targetthread, sourcethread});
+    source->d_database.exec("UPDATE drafts SET thread_id = ? WHERE thread_id = ?", {targetthread, sourcethread});
     if (source->d_database.containsTable("mention"))
-      source->d_database.exec("UPDATE mention SET thread_id = ?", targetthread);
+      source->d_database.exec("UPDATE mention SET thread_id = ? WHERE thread_id = ?", {targetthread, sourcethread});
     if (source->d_database.containsTable("name_collision"))
-      source->d_database.exec("UPDATE name_collision SET thread_id = ?", targetthread);
+      source->d_database.exec("UPDATE name_collision SET thread_id = ? WHERE thread_id = ?", {targetthread, sourcethread});
+  }
 
+  // if all threads exist in target, drop the recipient_preferences, identities and thread tables,
+  // they are already in the target db
+  if (newthreads == 0 && !mergedthreads.empty())
+  {
     // see below for comment explaining this function
     if (d_databaseversion >= 24)
     {
@@ -552,12 +613,15 @@ table|sender_keys|sender_keys|71|CREATE TABLE sender_keys (_id INTEGER PRIMARY K
       Logger::message("  updateRecipientIds");
       //results.prettyPrint(d_truncate);
 
+      std::map<long long int, long long int> recipientidmap;
       for (unsigned int i = 0; i < results.rows(); ++i)
       {
         RecipientIdentification rec_id = {results(i, "uuid"), results(i, "phone"), results(i, "group_id"), results(i, "distribution_id"), results(i, "storage_service")};
         //source->updateRecipientId(results.getValueAs<long long int>(i, "_id"), results.getValueAs<std::string>(i, "identifier"));
-        source->updateRecipientId(results.getValueAs<long long int>(i, "_id"), rec_id);
+        if (long long int sourceid = source->getRecipientIdFromIdentification(rec_id); sourceid != -1)
+          recipientidmap.emplace(sourceid, results.getValueAs<long long int>(i, "_id"));
       }
+      source->updateRecipientIds(recipientidmap);
     }
 
     source->d_database.exec("DROP TABLE thread");
@@ -633,9 +697,13 @@ table|sender_keys|sender_keys|71|CREATE TABLE sender_keys (_id INTEGER PRIMARY K
     source->d_database.exec("DROP TABLE groups");
     source->d_avatars.clear();
   }
-  else // no matching thread in target (but recipient may still exist)
+  else // (some) threads not in target (but recipients may still exist)
   {
-    Logger::message("  No existing thread found in target database for this recipient, importing.");
+    // the merged threads are already in target
+    for (auto const &[sourcethread, targetthread] : mergedthreads)
+      source->d_database.exec("DELETE FROM thread WHERE _id = ?", sourcethread);
+
+    Logger::message("  No existing thread found in target database for ", newthreads, " thread", (newthreads != 1 ? "s" : ""), ", importing.");
 
     // check identities and recipient prefs for presence of values, they may be there (even
     // though no thread was found (for example via a group chat or deleted thread))
@@ -728,16 +796,18 @@ table|sender_keys|sender_keys|71|CREATE TABLE sender_keys (_id INTEGER PRIMARY K
       //results.prettyPrint(d_truncate);
 
       int count = 0;
+      std::map<long long int, long long int> recipientidmap;
       for (unsigned int i = 0; i < results.rows(); ++i)
       {
         // if the recipient is already in target, we are going to delete it from
         // source, to prevent doubles. However, many tables refer to the recipient._id
         // which was made unique above. If we just delete the doubles (by phone/group_id,
         // and in the future probably uuid), the fields in other tables will point
-        // to random or non-existing recipients, so we need to remap them:
+        // to random or non-existing recipients, so we need to remap them (all at once, below):
         RecipientIdentification rec_id = {results(i, "uuid"), results(i, "phone"), results(i, "group_id"),
                                           results(i, "distribution_id"), results(i, "storage_service")};
-        source->updateRecipientId(results.getValueAs<long long int>(i, "_id"), rec_id);
+        if (long long int sourceid = source->getRecipientIdFromIdentification(rec_id); sourceid != -1)
+          recipientidmap.emplace(sourceid, results.getValueAs<long long int>(i, "_id"));
         //source->updateRecipientId(results.getValueAs<long long int>(i, "_id"), results.getValueAs<std::string>(i, "ident"));
 
         // std::cout << "Testing if recipient is present:" << std::endl;
@@ -769,6 +839,7 @@ table|sender_keys|sender_keys|71|CREATE TABLE sender_keys (_id INTEGER PRIMARY K
           count += source->d_database.changed();
         }
       }
+      source->updateRecipientIds(recipientidmap);
       if (count)
         Logger::message("Dropped ", count, " existing recipients from source database");
     }
@@ -853,9 +924,7 @@ table|sender_keys|sender_keys|71|CREATE TABLE sender_keys (_id INTEGER PRIMARY K
         long long int erased = deleted_sticker_ids.valueAsInt(j, "_id");
         if (erased == -1)
           continue;
-        auto it = std::find_if(source->d_stickers.begin(), source->d_stickers.end(), [erased](auto const &s) { return s.first == static_cast<uint64_t>(erased); });
-        if (it != source->d_stickers.end())
-          source->d_stickers.erase(it);
+        source->d_stickers.erase(erased);
       }
     }
     if (count)
@@ -1046,7 +1115,7 @@ table|sender_keys|sender_keys|71|CREATE TABLE sender_keys (_id INTEGER PRIMARY K
       //   std::cout << std::endl;
       // }
       SqlStatementFrame newframe = buildSqlStatementFrame(table, results.headers(), results.row(i));
-      d_database.exec(newframe.bindStatement(), newframe.parameters());
+      d_database.execWithBinder(newframe.bindStatement(), [&newframe](sqlite3_stmt *stmt) { return newframe.bindParameters(stmt); });
       //newframe.printInfo();
     }
     Logger::message_end(" ...done");
@@ -91,7 +91,7 @@ void SignalBackup::initFromFile()
         // we lazily do not check for them here, since we are dealing with official exported files which do not contain
         // these tables as they are excluded on the export-side as well. Additionally, the official import should be able
         // to properly deal with them anyway (that is: ignore them)
-        if (!d_database.exec(s->bindStatement(), s->parameters())) [[unlikely]]
+        if (!d_database.execWithBinder(s->bindStatement(), [s](sqlite3_stmt *stmt) { return s->bindParameters(stmt); })) [[unlikely]]
           Logger::warning("Failed to execute statement: ", s->statement());
       }
 #ifdef BUILT_FOR_TESTING
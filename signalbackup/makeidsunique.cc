@@ -80,32 +80,22 @@ void SignalBackup::makeIdsUnique(SignalBackup *source)
     if (dbl.table == d_part_table)
     {
       // update rowid's in d_attachments
-      std::map<std::pair<uint64_t, int64_t>, DeepCopyingUniquePtr<AttachmentFrame>> newattdb;
-      for (auto &att : source->d_attachments)
+      source->d_attachments.rekey([offsetvalue](auto &key, AttachmentFrame *af)
       {
-        AttachmentFrame *af = reinterpret_cast<AttachmentFrame *>(att.second.release());
         af->setRowId(af->rowId() + offsetvalue);
-
         int64_t attachmentid = af->attachmentId();
-        newattdb.emplace(std::make_pair(af->rowId(), attachmentid ? attachmentid : -1), af);
-      }
-      source->d_attachments.clear();
-      source->d_attachments = std::move(newattdb);
+        key = {af->rowId(), attachmentid ? attachmentid : -1};
+      });
     }
 
     else if (dbl.table == "sticker")
     {
       // update id's in d_stickers
-      std::map<uint64_t, DeepCopyingUniquePtr<StickerFrame>> newsdb;
-      for (auto &s : source->d_stickers)
+      source->d_stickers.rekey([offsetvalue](auto &key, StickerFrame *sf)
       {
-        StickerFrame *sf = reinterpret_cast<StickerFrame *>(s.second.release());
         sf->setRowId(sf->rowId() + offsetvalue);
-
-        newsdb.emplace(std::make_pair(sf->rowId(), sf));
-      }
-      source->d_stickers.clear();
-      source->d_stickers = std::move(newsdb);
+        key = sf->rowId();
+      });
     }
 
     else if (dbl.table == "recipient")
@@ -29,7 +29,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
 
   Logger::message("Attempting to migrate database from version ", from, " to version ", to, "...");
 
-  if (!d_database.exec("BEGIN TRANSACTION"))
+  if (!d_database.savepoint("migratedatabase"))
     return false;
 
 
@@ -61,7 +61,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     {
       if (!insertMissingRecipients(p.first, p.second))
       {
-        d_database.exec("ROLLBACK TRANSACTION");
+        d_database.rollbackToSavepoint("migratedatabase");
         return false;
       }
     }
@@ -83,7 +83,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     {
       if (!updateMissingAddress(p.first, p.second))
       {
-        d_database.exec("ROLLBACK TRANSACTION");
+        d_database.rollbackToSavepoint("migratedatabase");
         return false;
       }
     }
@@ -91,7 +91,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     // add column to groups
     if (!d_database.exec("ALTER TABLE groups ADD COLUMN recipient_id INTEGER DEFAULT 0"))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
 
@@ -114,7 +114,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     {
       if (!addressTorecipientId(p.first, p.second))
       {
-        d_database.exec("ROLLBACK TRANSACTION");
+        d_database.rollbackToSavepoint("migratedatabase");
         return false;
       }
     }
@@ -122,7 +122,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     // same for new groups.recipient_id column
     if (!d_database.exec("UPDATE groups SET recipient_id = (SELECT _id FROM recipient_preferences WHERE recipient_preferences.recipient_ids = groups.group_id)"))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
 
@@ -131,7 +131,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     SqliteDB::QueryResults groupmembers;
     if (!d_database.exec("SELECT members FROM groups", &groupmembers))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
 
@@ -156,7 +156,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
       //std::cout << "Missing member: " << mm << std::endl;
       if (!d_database.exec("INSERT INTO recipient_preferences(recipient_ids) VALUES (?)", mm))
       {
-        d_database.exec("ROLLBACK TRANSACTION");
+        d_database.rollbackToSavepoint("migratedatabase");
         return false;
       }
     }
@@ -164,7 +164,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     // now migrate group members address -> _id
     if (!d_database.exec("SELECT _id, members FROM groups", &groupmembers))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
     for (unsigned int i = 0; i < groupmembers.rows(); ++i)
@@ -183,7 +183,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
         long long int mid = d_database.getSingleResultAs<long long int>("SELECT _id FROM recipient_preferences WHERE recipient_ids = ?", m, -1);
         if (mid == -1)
         {
-          d_database.exec("ROLLBACK TRANSACTION");
+          d_database.rollbackToSavepoint("migratedatabase");
           return false;
         }
         members_id_str += (members_id_str.empty() ? "" : ",") + bepaald::toString(mid);
@@ -191,7 +191,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
       //std::cout << membersstring << " -> " << members_id_str << std::endl;
       if (!d_database.exec("UPDATE groups SET members = ? WHERE _id = ?", {members_id_str, gid}))
       {
-        d_database.exec("ROLLBACK TRANSACTION");
+        d_database.rollbackToSavepoint("migratedatabase");
         return false;
       }
     }
@@ -201,7 +201,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     // DID NOT EXIST AT THIS POINT, SOME COLUMNS ARE EXPECTED TO HAVE DIFFERENT (MORE MODERN) NAMES
     if (!d_database.exec("CREATE TABLE recipient (_id INTEGER PRIMARY KEY AUTOINCREMENT, " + d_recipient_aci + " TEXT UNIQUE DEFAULT NULL, " + d_recipient_e164 + " TEXT UNIQUE DEFAULT NULL, email TEXT UNIQUE DEFAULT NULL, group_id TEXT UNIQUE DEFAULT NULL, blocked INTEGER DEFAULT 0, message_ringtone TEXT DEFAULT NULL, message_vibrate INTEGER DEFAULT 0, call_ringtone TEXT DEFAULT NULL, call_vibrate INTEGER DEFAULT 0, notification_channel TEXT DEFAULT NULL, mute_until INTEGER DEFAULT 0, " + d_recipient_avatar_color + " TEXT DEFAULT NULL, seen_invite_reminder INTEGER DEFAULT 0, default_subscription_id INTEGER DEFAULT -1, message_expiration_time INTEGER DEFAULT 0, registered INTEGER DEFAULT 0, " + d_recipient_system_joined_name + " TEXT DEFAULT NULL, system_photo_uri TEXT DEFAULT NULL, system_phone_label TEXT DEFAULT NULL, system_contact_uri TEXT DEFAULT NULL, profile_key TEXT DEFAULT NULL, " + d_recipient_profile_given_name + " TEXT DEFAULT NULL, " + d_recipient_profile_avatar + " TEXT DEFAULT NULL, profile_sharing INTEGER DEFAULT 0, unidentified_access_mode INTEGER DEFAULT 0, force_sms_selection INTEGER DEFAULT 0)"))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
 
@@ -209,7 +209,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     SqliteDB::QueryResults recipient_preferences_contents;
     if (!d_database.exec("SELECT * FROM recipient_preferences", &recipient_preferences_contents))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
 
@@ -254,7 +254,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     // -> 25
     if (!d_database.exec("ALTER TABLE recipient ADD COLUMN system_phone_type INTEGER DEFAULT -1"))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
 
@@ -271,7 +271,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
     // appears to set address to -1 if address is 0 in mms table...
     if (!d_database.exec("UPDATE mms SET address = -1 WHERE address = 0"))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
   }
@@ -281,7 +281,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
   {
     if (!d_database.exec("CREATE TABLE reaction (_id INTEGER PRIMARY KEY, message_id INTEGER NOT NULL, is_mms INTEGER NOT NULL, author_id INTEGER NOT NULL REFERENCES recipient (_id) ON DELETE CASCADE, emoji TEXT NOT NULL, date_sent INTEGER NOT NULL, date_received INTEGER NOT NULL, UNIQUE(message_id, is_mms, author_id) ON CONFLICT REPLACE)"))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
 
@@ -308,7 +308,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
                           {"date_sent", reactions.getSentTime(j)},
                           {"date_received", reactions.getReceivedTime(j)}}))
           {
-            d_database.exec("ROLLBACK TRANSACTION");
+            d_database.rollbackToSavepoint("migratedatabase");
             return false;
           }
         }
@@ -322,7 +322,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
   {
     if (!d_database.exec("CREATE TABLE mention (_id INTEGER PRIMARY KEY AUTOINCREMENT, thread_id INTEGER, message_id INTEGER, recipient_id INTEGER, range_start INTEGER, range_length INTEGER)"))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
   }
@@ -357,7 +357,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
   {
     if (!ensureColumns(d_mms_table, p.first, p.second))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
   }
@@ -374,7 +374,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
   {
     if (!ensureColumns("sms", p.first, p.second))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
   }
@@ -386,7 +386,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
   {
     if (!ensureColumns("recipient", p.first, p.second))
     {
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
   }
@@ -411,14 +411,14 @@ bool SignalBackup::migrateDatabase(int from, int to) const
       !d_database.exec("DROP INDEX IF EXISTS mms_id_type_payment_transactions_index") ||
       !d_database.exec("DROP TRIGGER IF EXISTS mms_ai"))
   {
-    d_database.exec("ROLLBACK TRANSACTION");
+    d_database.rollbackToSavepoint("migratedatabase");
     return false;
   }
 
   SqliteDB::QueryResults minmax;
   if (!d_database.exec("SELECT MIN(_id) AS min, MAX(_id) AS max FROM sms", &minmax))
   {
-    d_database.exec("ROLLBACK TRANSACTION");
+    d_database.rollbackToSavepoint("migratedatabase");
     return false;
   }
 
@@ -534,7 +534,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
 #endif
     {
       Logger::error("copying sms._id: ", i);
-      d_database.exec("ROLLBACK TRANSACTION");
+      d_database.rollbackToSavepoint("migratedatabase");
       return false;
     }
 
@@ -550,7 +550,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
       // update reactions
       if (!d_database.exec("UPDATE reaction SET message_id = ?, is_mms = 1 WHERE message_id IS ? AND is_mms = 0", {newestmmsid, i}))
       {
-        d_database.exec("ROLLBACK TRANSACTION");
+        d_database.rollbackToSavepoint("migratedatabase");
         return false;
       }
 
@@ -559,7 +559,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
       {
         if (!d_database.exec("UPDATE msl_message SET message_id = ?, is_mms = 1 WHERE message_id IS ? AND is_mms = 0", {newestmmsid, i}))
         {
-          d_database.exec("ROLLBACK TRANSACTION");
+          d_database.rollbackToSavepoint("migratedatabase");
           return false;
         }
       }
@@ -568,7 +568,7 @@ bool SignalBackup::migrateDatabase(int from, int to) const
 
   if (!d_database.exec("DROP TABLE sms"))
   {
-    d_database.exec("ROLLBACK TRANSACTION");
+    d_database.rollbackToSavepoint("migratedatabase");
     return false;
   }
 
@@ -586,11 +586,11 @@ bool SignalBackup::migrateDatabase(int from, int to) const
        !d_database.exec("CREATE INDEX mms_id_type_payment_transactions_index ON mms (_id, " + d_mms_type + ") WHERE " + d_mms_type + " & " + bepaald::toString(Types::SPECIAL_TYPE_PAYMENTS_NOTIFICATION) + " != 0") ||
        !d_database.exec("CREATE TRIGGER mms_ai AFTER INSERT ON mms BEGIN INSERT INTO mms_fts (rowid, body, thread_id) VALUES (new._id, new.body, new.thread_id); END;"))
   {
-    d_database.exec("ROLLBACK TRANSACTION");
+    d_database.rollbackToSavepoint("migratedatabase");
     return false;
   }
 
-  if (d_database.exec("COMMIT"))
+  if (d_database.releaseSavepoint("migratedatabase"))
     return true;
 
   return false;
@@ -0,0 +1,148 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "signalbackup.ih"
+
+#include <unordered_map>
+
+/*
+  Applies a mapping of ids to 'table.col'. The mapping is given as (the name of) a table with
+  columns 'old_id' (INTEGER PRIMARY KEY) and 'new_id', ids not present in it are left unchanged.
+  If 'updatereferences' is set, all columns linked to 'table' through s_databaselinks and the
+  attachment and sticker frames are updated as well (see remapLinkedIds()). Every column is
+  rewritten with a single UPDATE, regardless of the number of ids changed.
+*/
+bool SignalBackup::remapIds(std::string const &table, std::string const &col, std::string const &mappingtable, bool updatereferences)
+{
+  if (d_database.getSingleResultAs<long long int>("SELECT COUNT(*) FROM " + mappingtable, 0) == 0)
+    return true;
+
+  // the column itself is unique: move all changing ids out of the way (by making them
+  // negative) before setting them to their new value.
+  if (!d_database.exec("UPDATE " + table + " SET " + col + " = " + col + " * -1 "
+                       "WHERE " + col + " IN (SELECT old_id FROM " + mappingtable + ")") ||
+      !d_database.exec("UPDATE " + table + " SET " + col + " = "
+                       "(SELECT new_id FROM " + mappingtable + " WHERE old_id = " + table + "." + col + " * -1) "
+                       "WHERE " + col + " < 0 AND " + col + " * -1 IN (SELECT old_id FROM " + mappingtable + ")")) [[unlikely]]
+  {
+    Logger::error("Failed to remap ids in '", table, ".", col, "'");
+    return false;
+  }
+
+  if (!updatereferences)
+    return true;
+
+  return remapLinkedIds(table, mappingtable);
+}
+
+/*
+  Applies a mapping of ids in 'table' (as above) to all columns linked to it in s_databaselinks
+  and to the attachment and sticker frames, without touching 'table' itself. The mapping may be
+  many-to-one (for example when merging recipients). Rows that would violate a UNIQUE constraint
+  after the update keep their old value, the number of such rows is reported in a warning.
+*/
+bool SignalBackup::remapLinkedIds(std::string const &table, std::string const &mappingtable)
+{
+  if (d_database.getSingleResultAs<long long int>("SELECT COUNT(*) FROM " + mappingtable, 0) == 0)
+    return true;
+
+  bool ret = true;
+  for (auto const &dbl : s_databaselinks)
+  {
+    if (dbl.table != table || (dbl.flags & SKIP))
+      continue;
+
+    for (auto const &c : dbl.connections)
+    {
+      if (d_databaseversion < c.mindbvversion || d_databaseversion > c.maxdbvversion ||
+          !d_database.containsTable(c.table) || !d_database.tableContainsColumn(c.table, c.column))
+        continue;
+
+      std::string const whereclause(c.whereclause.empty() ? "" : " AND " + c.whereclause);
+      bool success = true;
+      if (!c.json_path.empty())
+      {
+        std::string const extract("json_extract(" + c.column + ", " + c.json_path + ")");
+        success = d_database.exec("UPDATE " + c.table + " SET " + c.column + " = json_replace(" + c.column + ", " + c.json_path + ", "
+                                  "(SELECT new_id FROM " + mappingtable + " WHERE old_id = " + extract + ")) "
+                                  "WHERE " + extract + " IN (SELECT old_id FROM " + mappingtable + ")" + whereclause);
+      }
+      else if (c.flags & SET_UNIQUELY)
+      {
+        // negate, set the new values where possible, and restore the values that could not be set
+        success = d_database.exec("UPDATE " + c.table + " SET " + c.column + " = " + c.column + " * -1 "
+                                  "WHERE " + c.column + " IN (SELECT old_id FROM " + mappingtable + ")" + whereclause) &&
+                  d_database.exec("UPDATE OR IGNORE " + c.table + " SET " + c.column + " = "
+                                  "(SELECT new_id FROM " + mappingtable + " WHERE old_id = " + c.table + "." + c.column + " * -1) "
+                                  "WHERE " + c.column + " < 0 AND " + c.column + " * -1 IN (SELECT old_id FROM " + mappingtable + ")" + whereclause) &&
+                  d_database.exec("UPDATE " + c.table + " SET " + c.column + " = " + c.column + " * -1 "
+                                  "WHERE " + c.column + " < 0 AND " + c.column + " * -1 IN (SELECT old_id FROM " + mappingtable + ")" + whereclause);
+        if (success && d_database.changed() > 0)
+          Logger::warning("Failed to update ", d_database.changed(), " value(s) in '", c.table, ".", c.column, "' (UNIQUE constraint)");
+      }
+      else
+      {
+        // rows that would violate a UNIQUE constraint are skipped by 'OR IGNORE', count them
+        std::string const matching("WHERE " + c.column + " IN (SELECT old_id FROM " + mappingtable + ")" + whereclause);
+        long long int tochange = d_database.getSingleResultAs<long long int>("SELECT COUNT(*) FROM " + c.table + " " + matching, -1);
+        success = tochange >= 0 &&
+                  d_database.exec("UPDATE OR IGNORE " + c.table + " SET " + c.column + " = "
+                                  "(SELECT new_id FROM " + mappingtable + " WHERE old_id = " + c.table + "." + c.column + ") " + matching);
+        if (success && d_database.changed() < tochange)
+          Logger::warning("Failed to update ", tochange - d_database.changed(), " value(s) in '", c.table, ".", c.column, "' (UNIQUE constraint)");
+      }
+      if (!success) [[unlikely]]
+      {
+        Logger::error("Failed to update '", c.table, ".", c.column, "' to match changes in '", table, "'");
+        ret = false;
+      }
+      else if (d_verbose && !(c.flags & SET_UNIQUELY)) [[unlikely]]
+        Logger::message("    update table '", c.table, ".", c.column, "', changed: ", d_database.changed());
+    }
+  }
+
+  if ((table == d_part_table && !d_attachments.empty()) ||
+      (table == "sticker" && !d_stickers.empty()))
+  {
+    SqliteDB::QueryResults results;
+    if (!d_database.exec("SELECT old_id, new_id FROM " + mappingtable, &results)) [[unlikely]]
+      return false;
+    std::unordered_map<uint64_t, uint64_t> idmap;
+    idmap.reserve(results.rows());
+    for (unsigned int i = 0; i < results.rows(); ++i)
+      idmap.emplace(results.getValueAs<long long int>(i, 0), results.getValueAs<long long int>(i, 1));
+
+    // re-key the frames in one pass (the index only needs resorting if the order changed)
+    auto newrowid = [&idmap](uint64_t &rowid, auto *frame)
+    {
+      if (auto it = idmap.find(rowid); it != idmap.end())
+      {
+        frame->setRowId(it->second);
+        rowid = it->second;
+      }
+    };
+
+    if (table == d_part_table)
+      d_attachments.rekey([&newrowid](auto &key, AttachmentFrame *af) { newrowid(key.first, af); });
+    else
+      d_stickers.rekey([&newrowid](auto &key, StickerFrame *sf) { newrowid(key, sf); });
+  }
+
+  return ret;
+}
@@ -29,10 +29,25 @@ void SignalBackup::remapRecipients()
   SqliteDB::QueryResults results;
   d_database.exec("SELECT * FROM remapped_recipients", &results);
 
+  std::map<long long int, long long int> remapped;
   for (unsigned int i = 0; i < results.rows(); ++i)
+    remapped.emplace(results.getValueAs<long long int>(i, "old_id"),
+                     results.getValueAs<long long int>(i, "new_id"));
+
+  // all ids are changed at once, so follow chains (a -> b, b -> c) to their
+  // final id (a -> c). In a cycle (a -> b, b -> a), stop before an id comes back.
+  std::map<long long int, long long int> idmap;
+  for (auto const &[oldid, newid] : remapped)
   {
-    updateRecipientId(results.getValueAs<long long int>(i, "new_id"),
-                      results.getValueAs<long long int>(i, "old_id"));
+    std::set<long long int> seen{oldid};
+    long long int finalid = newid;
+    for (auto it = remapped.find(finalid); it != remapped.end() && !seen.contains(it->second); it = remapped.find(finalid))
+    {
+      seen.insert(finalid);
+      finalid = it->second;
+    }
+    idmap.emplace(oldid, finalid);
   }
+  updateRecipientIds(idmap);
 
 }
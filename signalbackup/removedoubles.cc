@@ -119,35 +119,8 @@ void SignalBackup::removeDoubles(long long int milliseconds)
 
   // remove unused attachments
   Logger::message("  Deleting unused attachments...");
-  SqliteDB::QueryResults results;
-  d_database.exec("SELECT _id," +
-                  (d_database.tableContainsColumn(d_part_table, "unique_id") ? "unique_id"s : "-1 AS unique_id"s) +
-                  " FROM " + d_part_table, &results);
-  int constexpr INVALID_ID = -10;
-  for (auto it = d_attachments.begin(); it != d_attachments.end();)
-  {
-    bool found = false;
-    for (unsigned int i = 0; i < results.rows(); ++i)
-    {
-      long long int rowid = INVALID_ID;
-      if (results.valueHasType<long long int>(i, "_id"))
-        rowid = results.getValueAs<long long int>(i, "_id");
-      long long int uniqueid = INVALID_ID;
-      if (results.valueHasType<long long int>(i, "unique_id"))
-        uniqueid = results.getValueAs<long long int>(i, "unique_id");
-
-      if (rowid != INVALID_ID && uniqueid != INVALID_ID &&
-          it->first.first == static_cast<uint64_t>(rowid) && it->first.second == static_cast<int64_t>(uniqueid))
-      {
-        found = true;
-        break;
-      }
-    }
-    if (!found)
-      it = d_attachments.erase(it);
-    else
-      ++it;
-  }
+  AttachmentKeySet const partkeys(getPartKeys());
+  d_attachments.erase_if([&partkeys](auto const &att) { return !partkeys.contains(att.first); });
 
   // remove unused group_receipts
   Logger::message("  Deleting group receipts entries from deleted messages...");
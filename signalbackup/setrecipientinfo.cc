@@ -66,19 +66,10 @@ void SignalBackup::setRecipientInfo(std::set<long long int> const &recipients,
 
     std::string initial;
     bool initial_is_emoji = false;
-    if (bepaald::contains(s_emoji_first_bytes, display_name[0]))
+    if (unsigned int emoji_size = s_emoji_trie.longestMatch(display_name.data(), display_name.size()); emoji_size > 0)
     {
-      for (char const *const emoji_string : s_emoji_unicode_list)
-      {
-        unsigned int emoji_size = std::strlen(emoji_string);
-        if ((display_name.size() >= emoji_size) &&
-            std::strncmp(display_name.data(), emoji_string, emoji_size) == 0)
-        {
-          initial = emoji_string;
-          initial_is_emoji = true;
-          break;
-        }
-      }
+      initial = display_name.substr(0, emoji_size);
+      initial_is_emoji = true;
     }
 
     if (initial.empty())
@@ -0,0 +1,43 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "signalbackup.ih"
+
+// replaces the attachment frames of this SignalBackup with copies of the frames in 'source'
+// that belong to messages in thread 'thread_id'. Used for the workers in exportHtml(), which
+// do not get a copy of all attachments.
+void SignalBackup::setThreadAttachments(SignalBackup const &source, long long int thread_id)
+{
+  d_attachments.clear();
+
+  SqliteDB::QueryResults results;
+  if (!d_database.exec("SELECT " + d_part_table + "._id AS rowid, " +
+                       (d_database.tableContainsColumn(d_part_table, "unique_id") ? "unique_id"s : "-1"s) + " AS uniqueid "
+                       "FROM " + d_part_table + " WHERE " + d_part_mid + " IN (SELECT _id FROM " + d_mms_table + " WHERE thread_id = ?) "
+                       "ORDER BY rowid",
+                       thread_id, &results)) [[unlikely]]
+    return;
+
+  for (unsigned int i = 0; i < results.rows(); ++i)
+  {
+    std::pair<uint64_t, int64_t> key{results.valueAsInt(i, "rowid"), results.valueAsInt(i, "uniqueid")};
+    if (auto it = source.d_attachments.find(key); it != source.d_attachments.end() && it->second)
+      d_attachments.emplace(std::move(key), std::unique_ptr<AttachmentFrame>(it->second->clone()));
+  }
+}
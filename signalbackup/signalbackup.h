@@ -23,6 +23,7 @@
 #include "../memsqlitedb/memsqlitedb.h"
 #include "../filedecryptor/filedecryptor.h"
 #include "../fileencryptor/fileencryptor.h"
+#include "../backupfilewriter/backupfilewriter.h"
 #include "../backupframe/backupframe.h"
 #include "../headerframe/headerframe.h"
 #include "../databaseversionframe/databaseversionframe.h"
@@ -35,11 +36,14 @@
 #include "../sqlstatementframe/sqlstatementframe.h"
 #include "../logger/logger.h"
 #include "../deepcopyinguniqueptr/deepcopyinguniqueptr.h"
+#include "../frameindex/frameindex.h"
+#include "../bytetrie/bytetrie.h"
 #include "../groupv2statusmessageproto/groupv2statusmessageproto.h"
 #include "../attachmentmetadata/attachmentmetadata.h"
 
 #include "../common_bytes.h"
 
+#include <functional>
 #include <map>
 #include <set>
 #include <unordered_set>
@@ -110,8 +114,8 @@ class SignalBackup
   std::string d_dt_m_sourceuuid;
 
   std::vector<std::pair<std::string, DeepCopyingUniquePtr<AvatarFrame>>> d_avatars;
-  std::map<std::pair<uint64_t, int64_t>, DeepCopyingUniquePtr<AttachmentFrame>> d_attachments; //maps <rowid,uniqueid> to attachment
-  std::map<uint64_t, DeepCopyingUniquePtr<StickerFrame>> d_stickers; //maps <sticker._id> to sticker
+  FrameIndex<std::pair<uint64_t, int64_t>, AttachmentFrame> d_attachments; //maps <rowid,uniqueid> to attachment
+  FrameIndex<uint64_t, StickerFrame> d_stickers; //maps <sticker._id> to sticker
   DeepCopyingUniquePtr<HeaderFrame> d_headerframe;
   DeepCopyingUniquePtr<DatabaseVersionFrame> d_databaseversionframe;
   std::vector<DeepCopyingUniquePtr<SharedPrefFrame>> d_sharedpreferenceframes;
@@ -154,6 +158,15 @@ class SignalBackup
     std::string storage_service;
   };
 
+  struct AttachmentKeyHash // for <rowid,uniqueid> keys of attachments
+  {
+    size_t operator()(std::pair<uint64_t, int64_t> const &key) const noexcept
+    {
+      return std::hash<uint64_t>{}((key.first * 0x9e3779b97f4a7c15ull) ^ static_cast<uint64_t>(key.second));
+    }
+  };
+  using AttachmentKeySet = std::unordered_set<std::pair<uint64_t, int64_t>, AttachmentKeyHash>;
+
   struct TableConnection
   {
     std::string table;
@@ -193,7 +206,7 @@ class SignalBackup
   static std::vector<DatabaseLink> const s_databaselinks;
   static std::map<std::string, std::vector<std::vector<std::string>>> const s_columnaliases;
   static char const *const s_emoji_unicode_list[3781];
-  static std::unordered_set<char> const s_emoji_first_bytes;
+  static ByteTrie const s_emoji_trie;
   static unsigned int constexpr s_emoji_min_size = 2; // smallest emoji_unicode_size - 1
   static std::map<std::string, std::string> const s_html_colormap;
   static std::regex const s_linkify_pattern;
@@ -224,7 +237,7 @@ class SignalBackup
   void addSMSMessage(std::string const &body, std::string const &address, long long int timestamp,
                      long long int thread, bool incoming);
   bool importThread(SignalBackup *source, long long int thread);
-  //bool importThread(SignalBackup *source, std::vector<long long int> const &threads);
+  bool importThread(SignalBackup *source, std::vector<long long int> const &threads);
   inline bool ok() const;
   bool dropBadFrames();
   //void fillThreadTableFromMessages();
@@ -263,7 +276,7 @@ class SignalBackup
                   long long int split, std::string const &selfid, bool calllog, bool searchpage,
                   bool stickerpacks, bool migrate, bool overwrite, bool append, bool theme,
                   bool themeswitching, bool addexportdetails, bool blocked, bool fullcontacts,
-                  bool settings, bool receipts, bool use_original_filenames, bool linkify);
+                  bool settings, bool receipts, bool use_original_filenames, bool linkify, long long int jobs = 1);
   bool exportTxt(std::string const &directory, std::vector<long long int> const &threads,
                  std::vector<std::string> const &dateranges, std::string const &selfid, bool migrate, bool overwrite);
   bool findRecipient(long long int id) const;
@@ -304,12 +317,10 @@ class SignalBackup
   template <typename T>
   [[nodiscard]] inline bool writeRawFrameDataToFile(std::string const &outputfile, std::unique_ptr<T> const &frame) const;
   [[nodiscard]] inline bool writeFrameDataToFile(std::ofstream &outputfile, std::pair<unsigned char *, uint64_t> const &data) const;
-  [[nodiscard]] bool writeEncryptedFrame(std::ofstream &outputfile, BackupFrame *frame);
-  [[nodiscard]] bool writeEncryptedFrameWithoutAttachment(std::ofstream &outputfile,
-                                                          std::pair<std::shared_ptr<unsigned char[]>, uint64_t> framedata);
   SqlStatementFrame buildSqlStatementFrame(std::string const &table, std::vector<std::string> const &headers,
                                            std::vector<std::any> const &result) const;
   SqlStatementFrame buildSqlStatementFrame(std::string const &table, std::vector<std::any> const &result) const;
+  SqlStatementFrame buildSqlStatementFrame(std::string const &table, SqliteDB::Cursor const &row) const;
   template <typename T>
   inline bool setFrameFromFile(DeepCopyingUniquePtr<T> *frame, std::string const &file, bool quiet = false) const;
   template <typename T>
@@ -320,6 +331,8 @@ class SignalBackup
   void getGroupV1MigrationRecipients(std::set<long long int> *referenced_recipients, long long int = -1) const;
   void remapRecipients();
   void compactIds(std::string const &table, std::string const &col = "_id");
+  bool remapIds(std::string const &table, std::string const &col, std::string const &mappingtable, bool updatereferences = true);
+  bool remapLinkedIds(std::string const &table, std::string const &mappingtable);
   // void makeIdsUnique(long long int minthread, long long int minsms, long long int minmms,
   //                    long long int minpart, long long int minrecipient, long long int mingroups,
   //                    long long int minidentities, long long int mingroup_receipts, long long int mindrafts,
@@ -333,11 +346,18 @@ class SignalBackup
   void updateRecipientId(long long int targetid, RecipientIdentification const &ident);
   //void updateRecipientId(long long int targetid, std::string const &ident);
   void updateRecipientId(long long int targetid, long long int sourceid);
+  void updateRecipientIds(std::map<long long int, long long int> const &idmap); // maps source -> target
+  long long int getRecipientIdFromIdentification(RecipientIdentification const &ident) const;
   void updateGroupMembers(long long int id1, long long int id2 = -1) const; // id2 == -1 -> id1 = offset, else transform 1 into 2
+  void updateGroupMembers(std::function<long long int(long long int)> const &newid) const;
   void updateReactionAuthors(long long int id1, long long int id2 = -1) const; // idem.
+  void updateReactionAuthors(std::function<long long int(long long int)> const &newid) const;
   void updateGV1MigrationMessage(long long int id1, long long int id2 = -1) const; // idem.
+  void updateGV1MigrationMessage(std::function<long long int(long long int)> const &newid) const;
   void updateAvatars(long long int id1, long long int id2 = -1); // idem.
+  void updateAvatars(std::function<long long int(long long int)> const &newid);
   void updateSnippetExtrasRecipient(long long int id1, long long int id2 = -1) const; // idem.
+  void updateSnippetExtrasRecipient(std::string const &mappingtable) const;
   long long int dateToMSecsSinceEpoch(std::string const &date, bool *fromdatestring = nullptr) const;
   void dumpInfoOnBadFrame(std::unique_ptr<BackupFrame> *frame);
   void dumpInfoOnBadFrames() const;
@@ -363,6 +383,7 @@ class SignalBackup
   void dtSetColumnNames(SqliteDB *ddb);
   long long int scanSelf() const;
   bool cleanAttachments();
+  AttachmentKeySet getPartKeys() const;
   inline bool updatePartTableForReplace(AttachmentMetadata const &data, long long int id);
   bool scrambleHelper(std::string const &table, std::vector<std::string> const &columns) const;
   std::vector<long long int> getGroupUpdateRecipients(int thread = -1) const;
@@ -427,6 +448,15 @@ class SignalBackup
                                long long int message_id, bool isgroup, long long int read_count,
                                long long int delivered_count, long long int timestamp, int indent) const;
 
+  bool exportHtmlThread(long long int t, long long int note_to_self_thread_id, std::string const &directory,
+                        std::string const &datewhereclause, std::vector<std::pair<std::string, std::string>> const &dateranges,
+                        std::string const &periodsplitformat, long long int split, bool overwrite, bool append,
+                        bool lighttheme, bool themeswitching, bool searchpage, bool addexportdetails,
+                        std::string const &exportdetails_html, bool receipts, bool originalfilenames, bool linkify,
+                        std::map<long long int, RecipientInfo> *recipient_info, std::vector<std::string> *searchidx_lines,
+                        bool *excluded) const;
+  void setThreadAttachments(SignalBackup const &source, long long int thread_id);
+  bool createMessageCountsTable() const;
   void HTMLwriteIndex(std::vector<long long int> const &threads, long long int maxtimestamp, std::string const &directory,
                       std::map<long long int, RecipientInfo> *recipient_info, long long int note_to_self_tid, bool calllog,
                       bool searchpage, bool stickerpacks, bool blocked, bool fullcontacts, bool settings,  bool overwrite,
@@ -444,7 +474,7 @@ class SignalBackup
                              bool overwrite, bool append, bool light, bool themeswitching, std::string const &exportdetails) const;
   bool HTMLwriteSettings(std::string const &dir, bool overwrite, bool append, bool light,
                          bool themeswitching, std::string const &exportdetails) const;
-  void HTMLescapeString(std::string *in, std::set<int> const *const positions_excluded_from_escape = nullptr) const;
+  void HTMLescapeString(std::string *in, std::vector<std::pair<unsigned int, unsigned int>> const *const positions_excluded_from_escape = nullptr) const;
   std::string HTMLescapeString(std::string const &in) const;
   void HTMLescapeUrl(std::string *in) const;
   void HTMLLinkify(std::string const &body, std::vector<Range> *ranges) const;
@@ -452,7 +482,7 @@ class SignalBackup
   void setRecipientInfo(std::set<long long int> const &recipients, std::map<long long int, RecipientInfo> *recipientinfo) const;
   std::string getAvatarExtension(long long int recipient_id) const;
   void prepRanges(std::vector<Range> *ranges) const;
-  void applyRanges(std::string *body, std::vector<Range> *ranges, std::set<int> *positions_excluded_from_escape) const;
+  void applyRanges(std::string *body, std::vector<Range> *ranges, std::vector<std::pair<unsigned int, unsigned int>> *positions_excluded_from_escape) const;
   std::vector<std::pair<unsigned int, unsigned int>> HTMLgetEmojiPos(std::string const &line) const;
   bool makeFilenameUnique(std::string const &path, std::string *file_or_dir) const;
   std::string decodeProfileChangeMessage(std::string const &body, std::string const &name) const;
@@ -145,10 +145,10 @@ std::vector<SignalBackup::DatabaseLink> const SignalBackup::s_databaselinks // s
       {"mms", "quote_author"},
       {"sessions", "address"},
       {"group_receipts", "address"},
-      {"thread", "recipient_ids"},        //---\ Only one of these will exist
-      {"thread", "thread_recipient_id"},  //   /
-      {"thread", "recipient_id"},         //__/
-      {"groups", "recipient_id"},
+      {"thread", "recipient_ids"},                              //---\ Only one of these will exist
+      {"thread", "thread_recipient_id", "", "", SET_UNIQUELY},  //   /  (UNIQUE constraint)
+      {"thread", "recipient_id", "", "", SET_UNIQUELY},         //__/
+      {"groups", "recipient_id", "", "", SET_UNIQUELY},
       {"remapped_recipients", "old_id"}, // should actually be cleared, but ...
       {"remapped_recipients", "new_id"}, // this can't hurt
       {"mention", "recipient_id"},
@@ -161,7 +161,7 @@ std::vector<SignalBackup::DatabaseLink> const SignalBackup::s_databaselinks // s
                                                         // {.table = "identities", .column = "address', .flags = SET_UNIQUELY}
                                                         // this is much more explicit and looks cleaner without the empty
                                                         // fields. (give missing fields default init in header)
-      {"distribution_list", "recipient_id"},
+      {"distribution_list", "recipient_id", "", "", SET_UNIQUELY},
       {"distribution_list_member", "recipient_id"},
       {"story_sends", "recipient_id"},
       {"pending_pni_signature_message", "recipient_id"},
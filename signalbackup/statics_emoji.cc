@@ -3803,4 +3803,4 @@ char const *const SignalBackup::s_emoji_unicode_list[3781] = {"\xf0\x9f\x91\xa9\
                                                               "\xe2\x99\x88",
                                                               "\xe2\x99\x89"}; // static
 
-std::unordered_set<char> const SignalBackup::s_emoji_first_bytes({'\x23', '\x2a', '\x30', '\x31', '\x32', '\x33', '\x34', '\x35', '\x36', '\x37', '\x38', '\x39', '\xc2', '\xe2', '\xe3', '\xf0'}); // static
+ByteTrie const SignalBackup::s_emoji_trie(s_emoji_unicode_list, std::size(s_emoji_unicode_list)); // static
@@ -21,14 +21,20 @@
 
 void SignalBackup::updateAvatars(long long int id1, long long int id2) // if id2 == -1, id1 is an offset
 {                                                                      // else, change id1 into id2
+  updateAvatars([id1, id2](long long int id) { return (id2 == -1) ? id + id1 : (id == id1 ? id2 : id); });
+}
+
+void SignalBackup::updateAvatars(std::function<long long int(long long int)> const &newid)
+{
   for (unsigned int i = 0; i < d_avatars.size(); ++i)
   {
     int oldrid = bepaald::toNumber<int>(d_avatars[i].first);
+    long long int newrid = newid(oldrid);
 
-    if (oldrid == id1 || id2 == -1)
+    if (newrid != oldrid)
     {
-      d_avatars[i].first = bepaald::toString(id2 == -1 ? oldrid + id1 : id2);
-      d_avatars[i].second->setRecipient(bepaald::toString(id2 == -1 ? oldrid + id1 : id2));
+      d_avatars[i].first = bepaald::toString(newrid);
+      d_avatars[i].second->setRecipient(bepaald::toString(newrid));
     }
   }
 }
@@ -21,6 +21,11 @@
 
 void SignalBackup::updateGroupMembers(long long int id1, long long int id2) const // if id2 == -1, id1 is an offset
 {                                                                                 // else, change id1 into id2
+  updateGroupMembers([id1, id2](long long int id) { return (id2 == -1) ? id + id1 : (id == id1 ? id2 : id); });
+}
+
+void SignalBackup::updateGroupMembers(std::function<long long int(long long int)> const &newid) const
+{
   for (auto const &members : {"members"s, d_groups_v1_members})
   {
     if (!d_database.tableContainsColumn("groups", members))
@@ -49,7 +54,7 @@ void SignalBackup::updateGroupMembers(long long int id1, long long int id2) cons
       {
         if (m > 0)
           newmembers += ",";
-        newmembers += bepaald::toString((id2 != -1 && membersvec[m] == id1) ? id2 : ((id2 == -1) ? membersvec[m] + id1 : membersvec[m]));
+        newmembers += bepaald::toString(newid(membersvec[m]));
       }
 
       if (membersstr != newmembers)
@@ -24,6 +24,11 @@
 // not seen one with more than 1 id). These id_s must also be updated.
 void SignalBackup::updateGV1MigrationMessage(long long int id1, long long int id2) const // if id2 == -1, id1 is an offset
 {                                                                                        // else, change id1 into id2
+  updateGV1MigrationMessage([id1, id2](long long int id) { return (id2 == -1) ? id + id1 : (id == id1 ? id2 : id); });
+}
+
+void SignalBackup::updateGV1MigrationMessage(std::function<long long int(long long int)> const &newid) const
+{
   SqliteDB::QueryResults results;
   int changed = 0;
   std::string table = d_database.containsTable("sms") ? "sms" : d_mms_table;
@@ -47,12 +52,8 @@ void SignalBackup::updateGV1MigrationMessage(long long int id1, long long int id
             // deal with any number we have
             if (tmp.size())
             {
-              long long int id = bepaald::toNumber<int>(tmp);
+              long long int id = newid(bepaald::toNumber<int>(tmp));
               //std::cout << "FOUND ID: " << id << std::endl;
-              if (id2 == -1)
-                id += id1;
-              else if (id == id1)
-                id = id2;
               output += bepaald::toString(id);
               tmp.clear();
             }
@@ -24,6 +24,11 @@
 // but in their own table called 'reaction'.
 void SignalBackup::updateReactionAuthors(long long int id1, long long int id2) const // if id2 == -1, id1 is an offset
 {                                                                                    // else, change id1 into id2
+  updateReactionAuthors([id1, id2](long long int id) { return (id2 == -1) ? id + id1 : (id == id1 ? id2 : id); });
+}
+
+void SignalBackup::updateReactionAuthors(std::function<long long int(long long int)> const &newid) const
+{
   for (auto const &msgtable : {"sms"s, d_mms_table})
   {
     if (d_database.tableContainsColumn(msgtable, "reactions"))
@@ -38,15 +43,10 @@ void SignalBackup::updateReactionAuthors(long long int id1, long long int id2) c
         for (unsigned int j = 0; j < reactions.numReactions(); ++j)
         {
           //std::cout << "Updating reaction author (" << msgtable << ") : " << reactions.getAuthor(j) << "..." << std::endl;
-          if (id2 == -1)
-          {
-            reactions.setAuthor(j, reactions.getAuthor(j) + id1);
-            ++changedcount;
-            changed = true;
-          }
-          else if (reactions.getAuthor(j) == static_cast<uint64_t>(id1))
+          uint64_t author = newid(reactions.getAuthor(j));
+          if (author != reactions.getAuthor(j))
           {
-            reactions.setAuthor(j, id2);
+            reactions.setAuthor(j, author);
             ++changedcount;
             changed = true;
           }
@@ -309,6 +309,19 @@ void SignalBackup::updateRecipientId(long long int targetid, RecipientIdentifica
     return;
 
   // get the current (to be deleted) recipient._id for this identifier (=phone,group_id,possibly uuid)
+  long long int sourceid = getRecipientIdFromIdentification(rec_id);
+
+  // the target recipient was not found in this source db, nothing to do.
+  if (sourceid == -1)
+    return;
+
+  //std::cout << "  Mapping " << sourceid << " -> " << targetid << " (" << ident << ")" << std::endl;
+
+  updateRecipientId(targetid, sourceid);
+}
+
+long long int SignalBackup::getRecipientIdFromIdentification(RecipientIdentification const &rec_id) const
+{
   SqliteDB::QueryResults results;
 
   if (d_database.tableContainsColumn("recipient", d_recipient_aci, d_recipient_e164, "group_id", "distribution_list_id", "notification_channel"))
@@ -333,16 +346,44 @@ void SignalBackup::updateRecipientId(long long int targetid, RecipientIdentifica
   if (results.rows() > 1)
   {
     Logger::error("Unexpectedly got multiple results");
-    return;
+    return -1;
   }
 
-  // the target recipient was not found in this source db, nothing to do.
   if (results.rows() == 0)
+    return -1;
+
+  return results.getValueAs<long long int>(0, "_id");
+}
+
+// bulk version of updateRecipientId(targetid, sourceid), for a map of sourceid -> targetid. All
+// ids are changed simultaneously, every linked column is updated only once.
+void SignalBackup::updateRecipientIds(std::map<long long int, long long int> const &idmap)
+{
+  if (idmap.empty())
     return;
 
-  long long int sourceid = results.getValueAs<long long int>(0, "_id");
+  Logger::message("  Mapping ", idmap.size(), " recipient id", (idmap.size() > 1 ? "s" : ""));
+  if (d_verbose) [[unlikely]]
+    for (auto const &[sourceid, targetid] : idmap)
+      Logger::message("    ", sourceid, " -> ", targetid);
 
-  //std::cout << "  Mapping " << sourceid << " -> " << targetid << " (" << ident << ")" << std::endl;
+  if (!d_database.exec("CREATE TEMP TABLE recipientid_map (old_id INTEGER PRIMARY KEY, new_id INTEGER)"))
+    return;
+  for (auto const &[sourceid, targetid] : idmap)
+    d_database.exec("INSERT INTO recipientid_map (old_id, new_id) VALUES (?, ?)", {sourceid, targetid});
 
-  updateRecipientId(targetid, sourceid);
+  remapLinkedIds("recipient", "recipientid_map");
+  updateSnippetExtrasRecipient("recipientid_map");
+
+  d_database.exec("DROP TABLE recipientid_map");
+
+  auto newid = [&idmap](long long int id)
+  {
+    auto it = idmap.find(id);
+    return it == idmap.end() ? id : it->second;
+  };
+  updateGV1MigrationMessage(newid);
+  updateGroupMembers(newid);
+  updateReactionAuthors(newid);
+  updateAvatars(newid);
 }
@@ -21,37 +21,48 @@
 
 void SignalBackup::updateSnippetExtrasRecipient(long long int id1, long long int id2) const // if id2 == -1, id1 is an offset
 {                                                                                           // else, change id1 into id2
+  if (id2 != -1)
+  {
+    updateSnippetExtrasRecipient("(SELECT " + bepaald::toString(id1) + " AS old_id, " + bepaald::toString(id2) + " AS new_id)");
+    return;
+  }
+
   if (d_database.tableContainsColumn("thread", "snippet_extras"))
   {
-    if (id2 == -1)
-    {
-      d_database.exec("UPDATE thread SET snippet_extras = "
-                      "json_set(snippet_extras, '$.individualRecipientId', CAST(json_extract(snippet_extras, '$.individualRecipientId') + ? AS text))", id1);
-      int changed = d_database.changed();
-      if (d_verbose && changed) [[unlikely]]
-        Logger::message("     Updated ", changed, " individualrecipientids in thread.snippet_extras");
-
-      d_database.exec("UPDATE thread SET snippet_extras = "
-                      "json_set(snippet_extras, '$.groupAddedBy', CAST(json_extract(snippet_extras, '$.groupAddedBy') + ? AS text))", id1);
-      changed = d_database.changed();
-      if (d_verbose && changed) [[unlikely]]
-        Logger::message("     Updated ", changed, " groupaddedby-ids in thread.snippet_extras");
-    }
-    else
-    {
-      d_database.exec("UPDATE thread SET snippet_extras = "
-                      "json_set(snippet_extras, '$.individualRecipientId', CAST(? AS text)) "
-                      "WHERE json_extract(snippet_extras, '$.individualRecipientId') = CAST(? AS text)", {id2, id1});
-      int changed = d_database.changed();
-      if (d_verbose && changed) [[unlikely]]
-        Logger::message("     Updated ", changed, " individualrecipientids in thread.snippet_extras");
-
-      d_database.exec("UPDATE thread SET snippet_extras = "
-                      "json_set(snippet_extras, '$.groupAddedBy', CAST(? AS text)) "
-                      "WHERE json_extract(snippet_extras, '$.groupAddedBy') = CAST(? AS text)", {id2, id1});
-      changed = d_database.changed();
-      if (d_verbose && changed) [[unlikely]]
-        Logger::message("     Updated ", changed, " groupaddedby-ids in thread.snippet_extras");
-    }
+    d_database.exec("UPDATE thread SET snippet_extras = "
+                    "json_set(snippet_extras, '$.individualRecipientId', CAST(json_extract(snippet_extras, '$.individualRecipientId') + ? AS text))", id1);
+    int changed = d_database.changed();
+    if (d_verbose && changed) [[unlikely]]
+      Logger::message("     Updated ", changed, " individualrecipientids in thread.snippet_extras");
+
+    d_database.exec("UPDATE thread SET snippet_extras = "
+                    "json_set(snippet_extras, '$.groupAddedBy', CAST(json_extract(snippet_extras, '$.groupAddedBy') + ? AS text))", id1);
+    changed = d_database.changed();
+    if (d_verbose && changed) [[unlikely]]
+      Logger::message("     Updated ", changed, " groupaddedby-ids in thread.snippet_extras");
+  }
+}
+
+/*
+  Applies a mapping of recipient ids to the ids in thread.snippet_extras. The
+  mapping is (the name of) a table, or a subquery, with columns 'old_id' and
+  'new_id'. Every json path is updated with a single statement.
+*/
+void SignalBackup::updateSnippetExtrasRecipient(std::string const &mappingtable) const
+{
+  if (!d_database.tableContainsColumn("thread", "snippet_extras"))
+    return;
+
+  for (auto const &[path, name] : {std::pair{"$.individualRecipientId"s, "individualrecipientids"s},
+                                   std::pair{"$.groupAddedBy"s, "groupaddedby-ids"s}})
+  {
+    // the ids are stored as text
+    std::string const extract("CAST(json_extract(snippet_extras, '" + path + "') AS INTEGER)");
+    d_database.exec("UPDATE thread SET snippet_extras = json_set(snippet_extras, '" + path + "', "
+                    "CAST((SELECT new_id FROM " + mappingtable + " WHERE old_id = " + extract + ") AS text)) "
+                    "WHERE " + extract + " IN (SELECT old_id FROM " + mappingtable + ")");
+    int changed = d_database.changed();
+    if (d_verbose && changed) [[unlikely]]
+      Logger::message("     Updated ", changed, " ", name, " in thread.snippet_extras");
   }
 }
@@ -0,0 +1,139 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sqlcipherdecryptor.ih"
+
+#include "../common_bytes.h"
+
+/*
+  PAGE
+
+                                                       page_size
+   -------------------------------------------------------------------------------------------------------------------------------
+  /                                                                     real_page_size                                            \
+  |                                 -----------------------------------------------------------------------------------------------|
+  |                                /                                                                                               |
+  |                                |                                                                                               |
+  |                                |     page + (real_page_size - (digest_size + page_padding) - iv_size)                          |
+  |                                |                v                                                                              |
+
+  [salt, 16 bytes, only first page][encrypted bytes][iv, 16 bytes][mac, padded to 16 bytes (for version < 3, 20 bytes, padded to 32]
+
+
+  'encryptedpage' points to the start of the page as it is in the file (so, for the first page, to the salt),
+  'decryptedpage' receives page_size bytes (for the first page, starting with the sqlite header).
+*/
+bool SqlCipherDecryptor::decryptPage(unsigned char const *encryptedpage, uint64_t pagenumber, unsigned char *decryptedpage,
+                                     CryptContext *cryptcontext) const
+{
+  if (pagenumber == 1)
+  {
+    // write header
+    std::memcpy(decryptedpage, s_sqlliteheader, s_sqlliteheader_size);
+    encryptedpage += d_saltsize;
+    decryptedpage += s_sqlliteheader_size;
+  }
+
+  unsigned int iv_size = 16;
+  unsigned int page_padding = (((d_digestsize - 1) | 15) + 1) - d_digestsize;  // pad to multiple of 16 bytes ??? (maybe 32?)
+  unsigned int real_page_size = pagenumber == 1 ? d_pagesize - d_saltsize : d_pagesize;
+
+  // these pointers all point to specific data inside 'encryptedpage'
+  unsigned char const *page_data_to_hash = encryptedpage;
+  unsigned int page_data_to_hash_size = real_page_size - (d_digestsize + page_padding);
+  unsigned char const *iv = encryptedpage + page_data_to_hash_size - iv_size;
+  unsigned char const *page_encrypted_data = encryptedpage;
+  unsigned int page_encrypted_data_size = page_data_to_hash_size - iv_size;
+  uint32_t pagenumber32 = pagenumber; // the page number is hashed as a 4 byte (little-endian) int
+
+  // calculate MAC
+  unsigned char calculatedmac[EVP_MAX_MD_SIZE];
+  CryptContext::HmacCtx *hctx = cryptcontext->hmac();
+  if (!hctx)
+  {
+    Logger::error("Failed to initialize HMAC context");
+    return false;
+  }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  if (EVP_MAC_update(hctx, page_data_to_hash, page_data_to_hash_size) != 1 ||
+      EVP_MAC_update(hctx, reinterpret_cast<unsigned char *>(&pagenumber32), sizeof(pagenumber32)) != 1 ||
+      EVP_MAC_final(hctx, calculatedmac, nullptr, d_digestsize) != 1)
+  {
+    Logger::error("Failed to update/finalize hmac");
+    return false;
+  }
+#else
+  unsigned int digestsize = d_digestsize;
+  if (HMAC_Update(hctx, page_data_to_hash, page_data_to_hash_size) != 1 ||
+      HMAC_Update(hctx, reinterpret_cast<unsigned char *>(&pagenumber32), sizeof(pagenumber32)) != 1 ||
+      HMAC_Final(hctx, calculatedmac, &digestsize) != 1)
+  {
+    Logger::error("Failed to update/finalize hmac");
+    return false;
+  }
+#endif
+
+  // compare calculated mac to the mac from file
+  if (std::memcmp(encryptedpage + (real_page_size - (d_digestsize + page_padding)), calculatedmac, d_digestsize) != 0) [[unlikely]]
+  {
+    // note: a bad mac can occur if the page is empty (all 0x00). An empty page is not an error, and should simply be skipped.
+    bool containsdata = false;
+    for (unsigned int i = 0; i < page_data_to_hash_size; ++i)
+    {
+      if (page_data_to_hash[i] != 0x00)
+      {
+        containsdata = true;
+        break;
+      }
+    }
+    if (!containsdata) // UNTESTED  // skip decryption, but set entire page of zeros??
+    {
+      if (d_verbose) [[unlikely]]
+        Logger::message("Read empty page from SqlCipherDatabase. Inserting empty page in output...");
+
+      std::memset(decryptedpage, 0, real_page_size); // write all-zero page
+      return true;
+    }
+    else // mac did not match, but page contained data -> ERROR
+    {
+      Logger::error("BAD MAC! (pagenumber: ", pagenumber, " (at ", pagenumber * d_pagesize - (d_digestsize + page_padding), "/", d_decrypteddatasize, "))");
+      Logger::error_indent("MAC in file: ", bepaald::bytesToHexString(encryptedpage + (real_page_size - (d_digestsize + page_padding)), d_digestsize));
+      Logger::error_indent("Calculated : ", bepaald::bytesToHexString(calculatedmac, d_digestsize));
+      return false;
+    }
+  }
+
+  // (re)init decryptor with this page's iv
+  EVP_CIPHER_CTX *dctx = cryptcontext->cipher(iv);
+  if (!dctx)
+  {
+    Logger::error("CTX INIT FAILED");
+    return false;
+  }
+
+  int actualdecodedframelength = 0;
+  if (EVP_DecryptUpdate(dctx, decryptedpage, &actualdecodedframelength, page_encrypted_data, page_encrypted_data_size) != 1)
+  {
+    Logger::error("Failed to update decryption context");
+    ERR_print_errors_fp(stderr);
+    return false;
+  }
+  std::memset(decryptedpage + page_encrypted_data_size, 0, real_page_size - page_encrypted_data_size); // append zeros
+  return true;
+}
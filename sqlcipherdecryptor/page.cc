@@ -0,0 +1,60 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sqlcipherdecryptor.ih"
+
+// returns the decrypted page (d_pagesize bytes, the first page starting with the sqlite header) or
+// nullptr on error. When the database was opened lazily, the page is decrypted when it is not in
+// the cache already. The returned pointer is only valid until the next call to page().
+unsigned char const *SqlCipherDecryptor::page(uint64_t pagenumber)
+{
+  if (pagenumber == 0 || pagenumber > d_pagecount) [[unlikely]]
+    return nullptr;
+
+  if (d_decrypteddata) // everything was decrypted up front
+    return d_decrypteddata + (pagenumber - 1) * d_pagesize;
+
+  if (auto it = d_pagecacheindex.find(pagenumber); it != d_pagecacheindex.end())
+  {
+    d_pagecache.splice(d_pagecache.begin(), d_pagecache, it->second);
+    return d_pagecache.front().second.get();
+  }
+
+  if (!d_dbfile) [[unlikely]]
+    return nullptr;
+
+  // when the cache is full, the least recently used page makes room (and lends its buffer)
+  std::unique_ptr<unsigned char[]> decryptedpage;
+  if (d_pagecache.size() >= s_maxcachesize / d_pagesize)
+  {
+    d_pagecacheindex.erase(d_pagecache.back().first);
+    decryptedpage = std::move(d_pagecache.back().second);
+    d_pagecache.pop_back();
+  }
+  else
+    decryptedpage.reset(new unsigned char[d_pagesize]);
+
+  unsigned char const *encryptedpage = encryptedPage(pagenumber);
+  if (!encryptedpage || !decryptPage(encryptedpage, pagenumber, decryptedpage.get(), &d_cryptcontext))
+    return nullptr;
+
+  d_pagecache.emplace_front(pagenumber, std::move(decryptedpage));
+  d_pagecacheindex.emplace(pagenumber, d_pagecache.begin());
+  return d_pagecache.front().second.get();
+}
@@ -0,0 +1,131 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sqlcipherdecryptor.ih"
+
+#include "../common_be.h"
+
+/*
+  WAL (see https://www.sqlite.org/fileformat.html#the_write_ahead_log)
+
+  [header, 32 bytes][frame 1][frame 2]...
+
+  header: magic (0x377f0682 or 0x377f0683), file format version, page size, checkpoint sequence
+          number, salt-1, salt-2, checksum-1, checksum-2 (all 4 byte big-endian)
+  frame:  page number, database size in pages after commit (only for commit frames, 0 otherwise),
+          salt-1, salt-2, checksum-1, checksum-2 (all 4 byte big-endian), followed by the page
+          (encrypted exactly like it would be in the database file itself).
+
+  A frame is valid when its salts match the header's, and its checksum matches the cumulative
+  checksum over the header and all frames up to and including this one (over the first 8 bytes
+  of the frame header and the (encrypted) page). Only frames up to the last valid commit frame
+  count, for any page the last of those frames holds its current version.
+*/
+bool SqlCipherDecryptor::readWal(std::string const &walpath)
+{
+  uint64_t const headersize = 32;
+  uint64_t const frameheadersize = 24;
+
+  if (bepaald::fileSize(walpath) < headersize) // (empty) wal without frames
+    return true;
+
+  d_walfile.reset(new MappedFile(walpath));
+  if (!d_walfile->ok())
+  {
+    Logger::error("Failed to open WAL file '", walpath, "'");
+    return false;
+  }
+  unsigned char const *wal = d_walfile->data();
+
+  auto getUint32 = [](unsigned char const *data, bool bigendian) -> uint32_t
+  {
+    if (bigendian)
+      return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | data[3];
+    return (static_cast<uint32_t>(data[3]) << 24) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[1]) << 8) | data[0];
+  };
+
+  // the magic number determines the byte order of the words the checksum is calculated over
+  uint32_t magic = getUint32(wal, true);
+  if ((magic & 0xfffffffe) != 0x377f0682)
+  {
+    Logger::warning("Ignoring WAL file: unexpected magic number (0x", bepaald::toHexString(magic), ")");
+    d_walfile.reset();
+    return true;
+  }
+  bool bigendianchecksum = (magic & 1);
+  auto checksum = [&](unsigned char const *data, uint64_t size, uint32_t *s1, uint32_t *s2)
+  {
+    for (uint64_t i = 0; i < size; i += 8)
+    {
+      *s1 += getUint32(data + i, bigendianchecksum) + *s2;
+      *s2 += getUint32(data + i + 4, bigendianchecksum) + *s1;
+    }
+  };
+
+  uint32_t s1 = 0;
+  uint32_t s2 = 0;
+  checksum(wal, headersize - 8, &s1, &s2);
+  if (s1 != getUint32(wal + 24, true) || s2 != getUint32(wal + 28, true) ||
+      getUint32(wal + 8, true) != d_pagesize)
+  {
+    Logger::warning("Ignoring WAL file: invalid header");
+    d_walfile.reset();
+    return true;
+  }
+
+  // collect the pages of each transaction, and apply them when its commit frame is found
+  std::unordered_map<uint64_t, uint64_t> transaction; // pagenumber -> offset of page in wal file
+  uint64_t committedframes = 0;
+  uint64_t frames = 0;
+  for (uint64_t pos = headersize; pos + frameheadersize + d_pagesize <= d_walfile->size(); pos += frameheadersize + d_pagesize)
+  {
+    unsigned char const *frame = wal + pos;
+    if (std::memcmp(frame + 8, wal + 16, 8) != 0) // salts do not match: frame is left over from before the last checkpoint
+      break;
+
+    checksum(frame, 8, &s1, &s2);
+    checksum(frame + frameheadersize, d_pagesize, &s1, &s2);
+    if (s1 != getUint32(frame + 16, true) || s2 != getUint32(frame + 20, true)) // frame was not (completely) written
+      break;
+
+    uint64_t pagenumber = getUint32(frame, true);
+    if (pagenumber == 0) [[unlikely]]
+      break;
+    transaction[pagenumber] = pos + frameheadersize;
+    ++frames;
+
+    if (uint64_t dbsize = getUint32(frame + 4, true); dbsize != 0) // commit frame
+    {
+      for (auto const &[p, offset] : transaction)
+        d_walpages[p] = offset;
+      transaction.clear();
+      committedframes = frames;
+      d_pagecount = dbsize;
+    }
+  }
+
+  // (after a commit, the database may also have shrunk)
+  std::erase_if(d_walpages, [&](auto const &p) { return p.first > d_pagecount; });
+  d_decrypteddatasize = d_pagecount * d_pagesize;
+
+  if (d_verbose) [[unlikely]]
+    Logger::message("Read ", committedframes, " committed frames from WAL file (", d_walpages.size(), " pages, ",
+                    frames - committedframes, " uncommitted frames ignored)");
+  return true;
+}
@@ -31,7 +31,7 @@
 */
 
 SqlCipherDecryptor::SqlCipherDecryptor(std::string const &databasepath, std::string const &hexkey,
-                                       int version, bool verbose)
+                                       int version, bool lazy, bool applywal, bool verbose)
   :
   d_ok(false),
   d_databasepath(databasepath),
@@ -42,15 +42,12 @@ SqlCipherDecryptor::SqlCipherDecryptor(std::string const &databasepath, std::str
   d_salt(nullptr),
   d_saltsize(0),
   d_digest(version >= 4 ? EVP_sha512() : EVP_sha1()),
-  d_digestname_size((version >= 4 ? STRLEN("SHA512") : STRLEN("SHA1")) + 1),
-  d_digestname(version >= 4 ?
-               new char[d_digestname_size] {'S', 'H', 'A', '5', '1', '2', '\0'} :
-               new char[d_digestname_size] {'S', 'H', 'A', '1', '\0'}),
   d_digestsize(EVP_MD_size(d_digest)),
   d_pagesize(version >= 4 ? 4096 : 1024),
   d_decrypteddata(nullptr),
   d_decrypteddatasize(0),
-  d_verbose(verbose)
+  d_verbose(verbose),
+  d_pagecount(0)
 {
   if (hexkey.empty())
     return;
@@ -63,43 +60,76 @@ SqlCipherDecryptor::SqlCipherDecryptor(std::string const &databasepath, std::str
     return;
   }
 
-  // open database file
-  std::ifstream dbfile(d_databasepath, std::ios_base::in | std::ios_base::binary);
-  if (!dbfile.is_open())
+  if (!bepaald::fileOrDirExists(d_databasepath))
   {
     Logger::error("Failed to open database file '", d_databasepath, "'");
     return;
   }
 
   // get file size (this will also be the output file size)
-  //dbfile.seekg(0, std::ios_base::end);
-  //d_decrypteddatasize = dbfile.tellg();
-  //dbfile.seekg(0, std::ios_base::beg);
   d_decrypteddatasize = bepaald::fileSize(d_databasepath);
+  d_pagecount = d_decrypteddatasize / d_pagesize;
+  if (d_decrypteddatasize % d_pagesize != 0) [[unlikely]]
+  {
+    Logger::error("Unexpected database file size (", d_decrypteddatasize, " bytes, not a multiple of page size ", d_pagesize, ")");
+    return;
+  }
 
   if (d_verbose) [[unlikely]]
     Logger::message("Opening Desktop database `", d_databasepath, "' (", d_decrypteddatasize, " bytes)");
 
-  // read salt
   d_saltsize = 16;
   d_salt = new unsigned char[d_saltsize];
 
-  if (!dbfile.read(reinterpret_cast<char *>(d_salt), d_saltsize))
+  d_dbfile.reset(new MappedFile(d_databasepath));
+  if (!d_dbfile->ok() || d_dbfile->size() != d_decrypteddatasize)
   {
-    Logger::error("Failed to read salt from database file");
+    Logger::error("Failed to open database file '", d_databasepath, "'");
     return;
   }
 
+  // read salt
+  std::memcpy(d_salt, d_dbfile->data(), d_saltsize);
+
   if (!getHmacKey())
     return;
 
+  // apply the changes (committed by Signal Desktop) that are only in the write-ahead log so far
+  if (applywal && bepaald::fileOrDirExists(d_databasepath + "-wal"))
+    if (!readWal(d_databasepath + "-wal"))
+      return;
+
+  // when the entire database would fit in the page cache anyway, it is decrypted up front
+  // (see decryptData()), otherwise pages are decrypted as they are requested (see page())
+  if (lazy && d_decrypteddatasize > s_maxcachesize)
+  {
+    if (!d_cryptcontext.initHmac(d_hmackey, d_hmackeysize, d_digest) ||
+        !d_cryptcontext.initCipher(EVP_aes_256_cbc(), d_key, false))
+    {
+      Logger::error("Failed to initialize crypto contexts");
+      return;
+    }
+
+    // decrypt the first page, to check the key
+    if (!page(1))
+      return;
+
+    d_ok = true;
+    return;
+  }
+
   if (d_verbose) [[unlikely]]
     Logger::message("Starting decrypt...");
-  if (!decryptData(&dbfile))
+  if (!decryptData())
     return;
   if (d_verbose) [[unlikely]]
     Logger::message("Done!");
 
+  // everything is decrypted, the encrypted data is no longer needed
+  d_dbfile.reset();
+  d_walfile.reset();
+  d_walpages.clear();
+
   // std::cout << "CIPHER KEY: " << bepaald::bytesToHexString(d_key, d_keysize) << std::endl;
   // std::cout << "  HMAC KEY: " << bepaald::bytesToHexString(d_hmackey, d_hmackeysize) << std::endl;
 
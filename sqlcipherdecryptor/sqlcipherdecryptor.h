@@ -22,9 +22,14 @@
 
 #include <string>
 #include <fstream>
+#include <list>
+#include <memory>
+#include <unordered_map>
 
 #include "../common_filesystem.h"
 #include "../logger/logger.h"
+#include "../cryptcontext/cryptcontext.h"
+#include "../mappedfile/mappedfile.h"
 
 struct evp_md_st;
 
@@ -39,14 +44,26 @@ class SqlCipherDecryptor
   unsigned char *d_salt;
   unsigned int d_saltsize;
   evp_md_st const *d_digest;
-  size_t d_digestname_size;
-  char *d_digestname;
   unsigned int d_digestsize;
   unsigned int d_pagesize;
   unsigned char *d_decrypteddata;
   uint64_t d_decrypteddatasize;
   bool d_verbose;
 
+  // when opened lazily (and the database is larger than s_maxcachesize), pages are only decrypted
+  // when they are requested (see page()). The most recently used pages are kept (most recent
+  // first), up to s_maxcachesize bytes.
+  std::unique_ptr<MappedFile> d_dbfile;
+  // pages committed to the write-ahead log (but not checkpointed into the database yet) are read
+  // from there instead (pagenumber -> offset of the page in d_walfile, see readWal())
+  std::unique_ptr<MappedFile> d_walfile;
+  std::unordered_map<uint64_t, uint64_t> d_walpages;
+  CryptContext d_cryptcontext;
+  uint64_t d_pagecount;
+  std::list<std::pair<uint64_t, std::unique_ptr<unsigned char[]>>> d_pagecache;
+  std::unordered_map<uint64_t, std::list<std::pair<uint64_t, std::unique_ptr<unsigned char[]>>>::iterator> d_pagecacheindex;
+  static uint64_t constexpr s_maxcachesize = 128 * 1024 * 1024;
+
   static unsigned char constexpr s_saltmask = 0x3a;
   static int constexpr s_sqlliteheader_size = 16;
   static char constexpr s_sqlliteheader[s_sqlliteheader_size] = {'S', 'Q', 'L', 'i', 't', 'e', ' ', 'f', 'o', 'r', 'm', 'a', 't', ' ', '3', '\0'};
@@ -59,16 +76,23 @@ class SqlCipherDecryptor
 
  public:
   explicit SqlCipherDecryptor(std::string const &databasepath, std::string const &hexkey,
-                              int version, bool verbose);
+                              int version, bool lazy, bool applywal, bool verbose);
   SqlCipherDecryptor(SqlCipherDecryptor const &other) = delete;
   SqlCipherDecryptor &operator=(SqlCipherDecryptor const &other) = delete;
   ~SqlCipherDecryptor();
   inline bool ok() const;
   inline DecodedData data() const;
+  inline uint64_t size() const;
+  inline unsigned int pageSize() const;
+  unsigned char const *page(uint64_t pagenumber);
   inline bool writeToFile(std::string const &filename, bool overwrite) const;
  private:
   bool getHmacKey();
-  bool decryptData(std::ifstream *dbfile);
+  bool readWal(std::string const &walpath);
+  inline unsigned char const *encryptedPage(uint64_t pagenumber) const;
+  bool decryptData();
+  bool decryptPage(unsigned char const *encryptedpage, uint64_t pagenumber, unsigned char *decryptedpage,
+                   CryptContext *cryptcontext) const;
 };
 
 inline bool SqlCipherDecryptor::ok() const
@@ -81,8 +105,37 @@ inline SqlCipherDecryptor::DecodedData SqlCipherDecryptor::data() const
   return {d_decrypteddata, d_decrypteddatasize};
 }
 
+inline uint64_t SqlCipherDecryptor::size() const
+{
+  return d_decrypteddatasize;
+}
+
+inline unsigned int SqlCipherDecryptor::pageSize() const
+{
+  return d_pagesize;
+}
+
+// the encrypted page, from the wal if it holds a (committed) newer version
+inline unsigned char const *SqlCipherDecryptor::encryptedPage(uint64_t pagenumber) const
+{
+  if (auto it = d_walpages.find(pagenumber); it != d_walpages.end())
+    return d_walfile->data() + it->second;
+  if (pagenumber * d_pagesize > d_dbfile->size()) [[unlikely]]
+  {
+    Logger::error("Page ", pagenumber, " not found in database");
+    return nullptr;
+  }
+  return d_dbfile->data() + (pagenumber - 1) * d_pagesize;
+}
+
 inline bool SqlCipherDecryptor::writeToFile(std::string const &filename, bool overwrite) const
 {
+  if (!d_decrypteddata)
+  {
+    Logger::error("Database was not decrypted");
+    return false;
+  }
+
   if (!overwrite && bepaald::fileOrDirExists(filename))
   {
     Logger::error("File ", filename, " exists, use --overwrite to overwrite");
@@ -0,0 +1,262 @@
+/*
+  Copyright (C) 2024  Selwin van Dijk
+
+  This file is part of signalbackup-tools.
+
+  signalbackup-tools is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  signalbackup-tools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with signalbackup-tools.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SQLCIPHERFILEDB_H_
+#define SQLCIPHERFILEDB_H_
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "../sqlcipherdecryptor/sqlcipherdecryptor.h"
+
+/*
+  A read-only vfs on an encrypted (SQLCipher) database. Pages are decrypted
+  (by the SqlCipherDecryptor, which keeps a bounded cache) only when sqlite
+  reads them, so the database is never decrypted in its entirety. Anything
+  that is not the main database (temp files for sorting, temp tables) and
+  the os-functions (time, randomness) are handed to the default vfs.
+*/
+class SqlCipherFileDB
+{
+  struct CipherFile
+  {
+    sqlite3_file base; // Base class. Must be first.
+    SqlCipherDecryptor *db;
+  };
+  static sqlite3_vfs s_sqlcipherfilevfs;
+  static char constexpr s_name[] = {'S', 'q', 'l', 'C', 'i', 'p', 'h', 'e', 'r', 'F', 'i', 'l', 'e', 'V', 'F', 'S', '\0'};
+ public:
+  static sqlite3_vfs *sqlite3_sqlcipherfilevfs(SqlCipherDecryptor *db);
+  static char const *vfsName()
+  {
+    return s_name;
+  }
+ private:
+  static int ioWrite(sqlite3_file *, void const *, int, sqlite_int64);
+  static int ioClose(sqlite3_file *pFile);
+  static int ioRead(sqlite3_file *pFile, void *zBuf, int iAmt, sqlite_int64 iOfst);
+  static int ioTruncate(sqlite3_file *pFile, sqlite_int64 size);
+  static int ioSync(sqlite3_file *pFile, int flags);
+  static int ioFileSize(sqlite3_file *pFile, sqlite_int64 *pSize);
+  static int ioLock(sqlite3_file *pFile, int eLock);
+  static int ioUnlock(sqlite3_file *pFile, int eLock);
+  static int ioCheckReservedLock(sqlite3_file *pFile, int *pResOut);
+  static int ioFileControl(sqlite3_file *pFile, int op, void *pArg);
+  static int ioSectorSize(sqlite3_file *pFile);
+  static int ioDeviceCharacteristics(sqlite3_file *pFile);
+  static int open(sqlite3_vfs *pVfs, char const *zName, sqlite3_file *pFile, int flags, int *pOutFlags);
+  static int access(sqlite3_vfs *pVfs, char const *zPath, int flags, int *pResOut);
+  static int fullPathname(sqlite3_vfs *pVfs, char const *zPath, int nPathOut, char *zPathOut);
+
+  static sqlite3_io_methods constexpr s_io = {1,                                           /* iVersion */
+                                              SqlCipherFileDB::ioClose,                    /* xClose */
+                                              SqlCipherFileDB::ioRead,                     /* xRead */
+                                              SqlCipherFileDB::ioWrite,                    /* xWrite */
+                                              SqlCipherFileDB::ioTruncate,                 /* xTruncate */
+                                              SqlCipherFileDB::ioSync,                     /* xSync */
+                                              SqlCipherFileDB::ioFileSize,                 /* xFileSize */
+                                              SqlCipherFileDB::ioLock,                     /* xLock */
+                                              SqlCipherFileDB::ioUnlock,                   /* xUnlock */
+                                              SqlCipherFileDB::ioCheckReservedLock,        /* xCheckReservedLock */
+                                              SqlCipherFileDB::ioFileControl,              /* xFileControl */
+                                              SqlCipherFileDB::ioSectorSize,               /* xSectorSize */
+                                              SqlCipherFileDB::ioDeviceCharacteristics,    /* xDeviceCharacteristics */
+
+                                              /* since we specified iversion == 1 above, the next fields actually
+                                                 should not exist, but just to suppress gcc warnings....  */
+
+                                              nullptr,     /* xShmMap */
+                                              nullptr,     /* xShmLock */
+                                              nullptr,     /* xShmBarrier */
+                                              nullptr,     /* xShmUnmap */
+                                              nullptr,     /* xFetch */
+                                              nullptr,     /* xUnfetch */};
+};
+
+inline int SqlCipherFileDB::ioClose(sqlite3_file *pFile [[maybe_unused]])
+{
+  return SQLITE_OK;
+}
+
+inline int SqlCipherFileDB::ioRead(sqlite3_file *pFile, void *zBuf, int iAmt, sqlite_int64 iOfst)
+{
+  SqlCipherDecryptor *db = reinterpret_cast<CipherFile *>(pFile)->db;
+  unsigned char *out = static_cast<unsigned char *>(zBuf);
+  uint64_t offset = iOfst;
+  uint64_t toread = iAmt;
+
+  bool shortread = false;
+  if (offset + toread > db->size())
+  {
+    toread = (offset < db->size()) ? db->size() - offset : 0;
+    std::memset(out + toread, 0, iAmt - toread); // sqlite requires the unread part to be zeroed
+    shortread = true;
+  }
+
+  uint64_t pagesize = db->pageSize();
+  while (toread > 0)
+  {
+    uint64_t pagenumber = offset / pagesize + 1;
+    uint64_t pageoffset = offset % pagesize;
+    uint64_t size = std::min(toread, pagesize - pageoffset);
+
+    unsigned char const *page = db->page(pagenumber);
+    if (!page) [[unlikely]]
+      return SQLITE_IOERR_READ;
+    std::memcpy(out, page + pageoffset, size);
+
+    // disable WAL (Write-Ahead Logging) on database, reading from memory
+    // otherwise will not work see https://www.sqlite.org/fileformat.html
+    if (pagenumber == 1)
+      for (uint64_t walbyte : {0x12, 0x13})
+        if (walbyte >= pageoffset && walbyte < pageoffset + size && out[walbyte - pageoffset] == 2)
+          out[walbyte - pageoffset] = 1;
+
+    out += size;
+    offset += size;
+    toread -= size;
+  }
+
+  if (shortread)
+    return SQLITE_IOERR_SHORT_READ;
+
+  return SQLITE_OK;
+}
+
+inline int SqlCipherFileDB::ioWrite(sqlite3_file *pFile [[maybe_unused]], void const *, int, sqlite_int64)
+{
+  return SQLITE_READONLY;
+}
+
+inline int SqlCipherFileDB::ioTruncate(sqlite3_file *pFile [[maybe_unused]], sqlite_int64 size [[maybe_unused]])
+{
+  return SQLITE_IOERR_TRUNCATE;
+}
+
+inline int SqlCipherFileDB::ioSync(sqlite3_file *pFile [[maybe_unused]], int flags [[maybe_unused]])
+{
+  return SQLITE_IOERR_FSYNC;
+}
+
+inline int SqlCipherFileDB::ioFileSize(sqlite3_file *pFile, sqlite_int64 *pSize)
+{
+  *pSize = reinterpret_cast<CipherFile *>(pFile)->db->size();
+  return SQLITE_OK;
+}
+
+inline int SqlCipherFileDB::ioLock(sqlite3_file *pFile [[maybe_unused]], int eLock [[maybe_unused]])
+{
+  return SQLITE_OK;
+}
+
+inline int SqlCipherFileDB::ioUnlock(sqlite3_file *pFile [[maybe_unused]], int eLock [[maybe_unused]])
+{
+  return SQLITE_OK;
+}
+
+inline int SqlCipherFileDB::ioCheckReservedLock(sqlite3_file *pFile [[maybe_unused]], int *pResOut)
+{
+  *pResOut = 0;
+  return SQLITE_OK;
+}
+
+inline int SqlCipherFileDB::ioFileControl(sqlite3_file *pFile [[maybe_unused]], int op [[maybe_unused]], void *pArg [[maybe_unused]])
+{
+  return SQLITE_NOTFOUND;
+}
+
+inline int SqlCipherFileDB::ioSectorSize(sqlite3_file *pFile [[maybe_unused]])
+{
+  return 0;
+}
+
+inline int SqlCipherFileDB::ioDeviceCharacteristics(sqlite3_file *pFile [[maybe_unused]])
+{
+  return SQLITE_IOCAP_IMMUTABLE;
+}
+
+inline int SqlCipherFileDB::fullPathname(sqlite3_vfs *pVfs [[maybe_unused]],   /* VFS */
+                                         char const *zPath,                    /* Input path (possibly a relative path) */
+                                         int nPathOut,                         /* Size of output buffer in bytes */
+                                         char *zPathOut)                       /* Pointer to output buffer */
+{
+  if (nPathOut > static_cast<int>(std::strlen(zPath)))
+  {
+    std::strcpy(zPathOut, zPath);
+    return SQLITE_OK;
+  }
+  else
+    return SQLITE_CANTOPEN;
+}
+
+inline int SqlCipherFileDB::open(sqlite3_vfs *pVfs,                        /* VFS */
+                                 char const *zName,                        /* File to open, or 0 for a temp file */
+                                 sqlite3_file *pFile,                      /* Pointer to CipherFile struct to populate */
+                                 int flags,                                /* Input SQLITE_OPEN_XXX flags */
+                                 int *pOutFlags)                           /* Output SQLITE_OPEN_XXX flags (or NULL) */
+{
+  if (!(flags & SQLITE_OPEN_MAIN_DB)) // temp files are real files, let the default vfs handle them
+  {
+    sqlite3_vfs *defaultvfs = sqlite3_vfs_find(nullptr);
+    return defaultvfs->xOpen(defaultvfs, zName, pFile, flags, pOutFlags);
+  }
+
+  CipherFile *p = reinterpret_cast<CipherFile *>(pFile); /* Populate this structure */
+  std::memset(p, 0, sizeof(CipherFile));
+  if (pOutFlags)
+    *pOutFlags = (flags & ~(SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)) | SQLITE_OPEN_READONLY;
+
+  p->base.pMethods = &s_io;
+  p->db = reinterpret_cast<SqlCipherDecryptor *>(pVfs->pAppData);
+
+  return SQLITE_OK;
+}
+
+inline int SqlCipherFileDB::access(sqlite3_vfs *pVfs [[maybe_unused]], char const *zPath, int flags, int *pResOut)
+{
+  // there are no journals (or wal-files) for the main database
+  if (std::strncmp(zPath, vfsName(), sizeof(s_name) - 1) == 0)
+  {
+    *pResOut = 0;
+    return SQLITE_OK;
+  }
+  sqlite3_vfs *defaultvfs = sqlite3_vfs_find(nullptr);
+  return defaultvfs->xAccess(defaultvfs, zPath, flags, pResOut);
+}
+
+inline sqlite3_vfs *SqlCipherFileDB::sqlite3_sqlcipherfilevfs(SqlCipherDecryptor *db)
+{
+  // start from the default vfs, for everything that is not reading the main database
+  sqlite3_vfs *defaultvfs = sqlite3_vfs_find(nullptr);
+  s_sqlcipherfilevfs = *defaultvfs;
+
+  s_sqlcipherfilevfs.szOsFile = std::max(static_cast<int>(sizeof(CipherFile)), defaultvfs->szOsFile);
+  s_sqlcipherfilevfs.pNext = nullptr;
+  s_sqlcipherfilevfs.zName = vfsName();
+  s_sqlcipherfilevfs.pAppData = db;
+  s_sqlcipherfilevfs.xOpen = open;
+  s_sqlcipherfilevfs.xAccess = access;
+  s_sqlcipherfilevfs.xFullPathname = fullPathname;
+
+  return &s_sqlcipherfilevfs;
+}
+
+#endif
@@ -21,6 +21,9 @@
 
 bool SqliteDB::copyDb(SqliteDB const &source, SqliteDB const &target) // static
 {
+  // the targets contents are replaced, drop any statements prepared against it
+  target.clearStatementCache();
+
   sqlite3_backup *backup = sqlite3_backup_init(target.d_db, "main", source.d_db, "main");
   if (!backup)
   {
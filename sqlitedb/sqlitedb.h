@@ -22,10 +22,15 @@
 
 #include <sqlite3.h>
 #include <memory>
+#include <cstring>
 #include <map>
+#include <list>
+#include <unordered_map>
 #include <set>
 #include <vector>
 #include <any>
+#include <string_view>
+#include <type_traits>
 #if __cpp_lib_ranges >= 201911L
 #include <ranges>
 #endif
@@ -39,20 +44,51 @@ class SqliteDB
  public:
   class QueryResults
   {
+    // a single value. Integers, doubles and NULL are stored in the cell itself, for text and
+    // blobs the cell points into one of the chunks owned by the results (d_chunks).
+    struct Cell
+    {
+      enum class Type : unsigned char
+      {
+        NUL = 0, // a value-initialized Cell is NULL
+        INTEGER,
+        FLOAT,
+        TEXT,
+        BLOB,
+        NONE     // not a storable type (used in cellType<T>())
+      };
+      Type type;
+      unsigned int chunk;
+      union
+      {
+        long long int i;
+        double d;
+        unsigned char *ptr;
+      };
+      size_t size;
+    };
+    static size_t constexpr s_minchunksize = 1024;
+    static size_t constexpr s_maxchunksize = 64 * 1024;
+
     std::vector<std::string> d_headers;
-    std::vector<std::vector<std::any>> d_values;
+    std::vector<std::vector<Cell>> d_columns; // d_columns[column][row]
+    std::vector<std::shared_ptr<unsigned char []>> d_chunks;
+    size_t d_rows = 0;
+    size_t d_chunksize = 0;  // size of d_chunks[d_currentchunk]
+    size_t d_chunkused = 0;
+    unsigned int d_currentchunk = 0;
 
    public:
     inline void emplaceHeader(std::string &&h);
+    inline void appendRow(sqlite3_stmt *stmt);
     inline std::vector<std::string> const &headers() const;
     inline std::string const &header(size_t idx) const;
     inline bool hasColumn(std::string const &h) const;
-    inline void emplaceValue(size_t row, std::any &&a);
     inline std::any value(size_t row, std::string const &header) const;
     template <typename T>
     inline T getValueAs(size_t row, std::string const &header) const;
-    inline std::any const &value(size_t row, size_t idx) const;
-    inline std::vector<std::any> const &row(size_t row) const;
+    inline std::any value(size_t row, size_t idx) const;
+    inline std::vector<std::any> row(size_t row) const;
     template <typename T>
     inline bool valueHasType(size_t row, size_t idx) const;
     template <typename T>
@@ -79,12 +115,43 @@ class SqliteDB
     bool removeColumn(unsigned int idx);
     bool renameColumn(unsigned int idx, std::string const &name);
     inline bool removeRow(unsigned int idx);
-    inline QueryResults getRow(unsigned int idx);
+    inline QueryResults getRow(unsigned int idx) const;
+    inline QueryResults getRows(unsigned int idx, unsigned int count) const;
 
    private:
     inline int idxOfHeader(std::string const &header) const;
     int availableWidth() const;
     inline uint64_t charCount(std::string const &utf8) const;
+    inline unsigned char *allocate(size_t size, unsigned int *chunk);
+    template <typename T>
+    static inline constexpr Cell::Type cellType();
+  };
+
+  // steps through the results of a query one row at a time, without storing
+  // them. The cursor has its own prepared statement, so the database can be
+  // queried while iterating (as long as the iterated table is not changed).
+  class Cursor
+  {
+    sqlite3 *d_db;
+    sqlite3_stmt *d_stmt;
+    bool d_ok;
+
+   public:
+    inline Cursor(sqlite3 *db, std::string const &q);
+    Cursor(Cursor const &other) = delete;
+    Cursor &operator=(Cursor const &other) = delete;
+    inline Cursor(Cursor &&other);
+    inline ~Cursor();
+    inline bool ok() const;
+    inline bool step();
+    inline int columns() const;
+    inline std::string header(int idx) const;
+    inline int idxOfHeader(std::string const &header) const;
+    template <typename T>
+    inline bool valueHasType(int idx) const;
+    inline bool isNull(int idx) const;
+    template <typename T>
+    inline T getValueAs(int idx) const;
   };
 
  public:
@@ -102,26 +169,40 @@ class SqliteDB
  private:
   sqlite3 *d_db;
   sqlite3_vfs *d_vfs;
-  mutable sqlite3_stmt *d_stmt; // cache a (prepared) statement for reuse in subsequent transactions
+  mutable sqlite3_stmt *d_stmt; // the statement currently being executed (owned by d_stmtcache)
+  // prepared statements for reuse in subsequent transactions, most recently used first. The index
+  // is keyed on views of the query strings in the list.
+  static unsigned int constexpr s_maxcachedstatements = 64;
+  mutable std::list<std::pair<std::string, sqlite3_stmt *>> d_stmtcache;
+  mutable std::unordered_map<std::string_view, std::list<std::pair<std::string, sqlite3_stmt *>>::iterator> d_stmtcacheindex;
+  mutable uint64_t d_stmtcachehits;
+  mutable uint64_t d_stmtcachemisses;
   std::string d_name;
   // non-owning pointer!
   std::pair<unsigned char *, uint64_t> *d_data;
+  // when this database is a read-only view on a serialized snapshot (see serialize()), the
+  // snapshot data, shared with any copies of this view
+  std::pair<std::shared_ptr<unsigned char []>, uint64_t> d_snapshot;
   bool d_readonly;
   bool d_ok;
   mutable std::map<std::string, bool> d_tables; // cache results of containsTable/tableContainsColumn
   mutable std::map<std::string, std::map<std::string, bool>> d_columns;
-  mutable char d_previous_schema_version[11]; // 11 = maximum chars in string representing 4 byte number (+ '\0')
+  mutable long long int d_previous_schema_version;
 
  protected:
   inline explicit SqliteDB();
   inline explicit SqliteDB(std::string const &name, bool readonly = true);
   inline explicit SqliteDB(std::pair<unsigned char *, uint64_t> *data);
+  inline explicit SqliteDB(sqlite3_vfs *vfs);
+  inline explicit SqliteDB(std::pair<std::shared_ptr<unsigned char []>, uint64_t> const &snapshot);
   inline SqliteDB(SqliteDB const &other);
   inline SqliteDB &operator=(SqliteDB const &other);
   inline ~SqliteDB();
  public:
   inline bool ok() const;
   inline bool saveToFile(std::string const &filename) const;
+  inline std::pair<std::shared_ptr<unsigned char []>, uint64_t> serialize() const;
+  inline void swap(SqliteDB &other);
   inline bool exec(std::string const &q, QueryResults *results = nullptr, bool verbose = false) const;
   inline bool exec(std::string const &q, std::any const &param, QueryResults *results = nullptr, bool verbose = false) const;
 #if __cpp_lib_ranges >= 201911L
@@ -129,6 +210,8 @@ class SqliteDB
   inline bool exec(std::string const &q, R &&params, QueryResults *results = nullptr, bool verbose = false) const;
 #endif
   inline bool exec(std::string const &q, std::vector<std::any> const &params, QueryResults *results = nullptr, bool verbose = false) const;
+  template <typename Binder>
+  inline bool execWithBinder(std::string_view q, Binder const &binder, QueryResults *results = nullptr, bool verbose = false) const;
   template <typename T>
   inline T getSingleResultAs(std::string const &q, T defaultval) const;
   template <typename T>
@@ -145,6 +228,9 @@ class SqliteDB
   inline bool printLineMode(std::string const &q, std::any const &param) const;
   inline bool printLineMode(std::string const &q, std::vector<std::any> const &params) const;
   static bool copyDb(SqliteDB const &source, SqliteDB const &target);
+  inline bool savepoint(std::string const &name) const;
+  inline bool releaseSavepoint(std::string const &name) const;
+  inline bool rollbackToSavepoint(std::string const &name) const;
   inline int changed() const;
   inline long long int lastId() const;
   inline long long int lastInsertRowid() const;
@@ -153,11 +239,15 @@ class SqliteDB
   template <typename... columnnames>
   inline bool tableContainsColumn(std::string const &tablename, std::string const &columnname, columnnames... list) const;
   inline void clearTableCache() const;
+  inline void clearStatementCache() const;
+  inline std::pair<uint64_t, uint64_t> statementCacheStats() const;
   inline void freeMemory();
+  inline Cursor cursor(std::string const &q) const;
 
  private:
   inline bool initFromFile();
   inline bool initFromMemory();
+  inline bool initFromSnapshot(std::pair<std::shared_ptr<unsigned char []>, uint64_t> const &snapshot);
   inline void destroy();
   inline int execParamFiller(int count, std::string const &param) const;
   inline int execParamFiller(int count, char const *param) const;
@@ -175,6 +265,8 @@ class SqliteDB
   inline int execParamFiller(int count, std::nullptr_t param) const;
   template <typename T>
   inline bool isType(std::any const &a) const;
+  inline sqlite3_stmt *statement(std::string_view q, bool countstats = true) const;
+  inline bool stepStatement(QueryResults *results) const;
   inline bool schemaVersionChanged() const;
 
   inline bool registerCustoms() const;
@@ -193,11 +285,13 @@ inline SqliteDB::SqliteDB(std::string const &name, bool readonly)
   d_db(nullptr),
   d_vfs(nullptr),
   d_stmt(nullptr),
+  d_stmtcachehits(0),
+  d_stmtcachemisses(0),
   d_name(name),
   d_data(nullptr),
   d_readonly(readonly),
   d_ok(false),
-  d_previous_schema_version{}
+  d_previous_schema_version(-1)
 {
   d_ok = initFromFile();
 }
@@ -207,20 +301,47 @@ inline SqliteDB::SqliteDB(std::pair<unsigned char *, uint64_t> *data)
   d_db(nullptr),
   d_vfs(MemFileDB::sqlite3_memfilevfs(data)),
   d_stmt(nullptr),
+  d_stmtcachehits(0),
+  d_stmtcachemisses(0),
   d_data(data),
   d_readonly(true),
   d_ok(false),
-  d_previous_schema_version{}
+  d_previous_schema_version(-1)
+{
+  d_ok = initFromMemory();
+}
+
+// opens the (read-only) database provided by a custom vfs (for example SqlCipherFileDB). The vfs
+// is registered for as long as this database is open.
+inline SqliteDB::SqliteDB(sqlite3_vfs *vfs)
+  :
+  d_db(nullptr),
+  d_vfs(vfs),
+  d_stmt(nullptr),
+  d_stmtcachehits(0),
+  d_stmtcachemisses(0),
+  d_data(nullptr),
+  d_readonly(true),
+  d_ok(false),
+  d_previous_schema_version(-1)
 {
   d_ok = initFromMemory();
 }
 
+inline SqliteDB::SqliteDB(std::pair<std::shared_ptr<unsigned char []>, uint64_t> const &snapshot)
+  :
+  SqliteDB(":memory:")
+{
+  if (d_ok)
+    d_ok = initFromSnapshot(snapshot);
+}
+
 inline SqliteDB::SqliteDB(SqliteDB const &other)
   :
   SqliteDB(":memory:")
 {
   if (d_ok)
-    d_ok = copyDb(other, *this);
+    d_ok = other.d_snapshot.first ? initFromSnapshot(other.d_snapshot) : copyDb(other, *this);
 }
 
 inline SqliteDB &SqliteDB::operator=(SqliteDB const &other)
@@ -236,11 +357,12 @@ inline SqliteDB &SqliteDB::operator=(SqliteDB const &other)
     d_stmt = nullptr;
     d_name = ":memory:";
     d_data = nullptr;
+    d_snapshot = {nullptr, 0};
     d_readonly = other.d_readonly;
     d_ok = initFromFile();
-    std::strncpy(d_previous_schema_version, other.d_previous_schema_version, 11);
+    d_previous_schema_version = other.d_previous_schema_version;
     if (d_ok)
-      d_ok = copyDb(other, *this);
+      d_ok = other.d_snapshot.first ? initFromSnapshot(other.d_snapshot) : copyDb(other, *this);
   }
   return *this;
 }
@@ -268,7 +390,7 @@ inline bool SqliteDB::initFromMemory()
 {
   bool initok = false;
   if (sqlite3_vfs_register(d_vfs, 0) == SQLITE_OK)
-    initok = (sqlite3_open_v2(MemFileDB::vfsName(), &d_db, SQLITE_OPEN_READONLY, MemFileDB::vfsName()) == SQLITE_OK);
+    initok = (sqlite3_open_v2(d_vfs->zName, &d_db, SQLITE_OPEN_READONLY, d_vfs->zName) == SQLITE_OK);
 
   if (!initok)
     return false;
@@ -276,10 +398,28 @@ inline bool SqliteDB::initFromMemory()
   return registerCustoms();
 }
 
+// opens the snapshot as the main database of this (in-memory) connection. The data is not
+// copied: all views on the same snapshot read from the same buffer, which is why it is opened
+// read-only and sqlite is not allowed to resize or free it.
+inline bool SqliteDB::initFromSnapshot(std::pair<std::shared_ptr<unsigned char []>, uint64_t> const &snapshot)
+{
+  if (!snapshot.first) [[unlikely]]
+    return false;
+
+  if (sqlite3_deserialize(d_db, "main", snapshot.first.get(), snapshot.second, snapshot.second,
+                          SQLITE_DESERIALIZE_READONLY) != SQLITE_OK) [[unlikely]]
+  {
+    Logger::error("Failed to open database snapshot: ", sqlite3_errmsg(d_db));
+    return false;
+  }
+  d_snapshot = snapshot;
+  d_readonly = true;
+  return true;
+}
+
 inline void SqliteDB::destroy()
 {
-  if (d_stmt)
-    sqlite3_finalize(d_stmt);
+  clearStatementCache();
 
   if (d_vfs)
     sqlite3_vfs_unregister(d_vfs);
@@ -305,6 +445,39 @@ inline bool SqliteDB::saveToFile(std::string const &filename) const
   return true;
 }
 
+// returns a copy of the current contents (including any uncommitted changes) of the main
+// database, which can be opened any number of times with SqliteDB(snapshot)
+inline std::pair<std::shared_ptr<unsigned char []>, uint64_t> SqliteDB::serialize() const
+{
+  sqlite3_int64 size = 0;
+  unsigned char *data = sqlite3_serialize(d_db, "main", &size, 0);
+  if (!data) [[unlikely]]
+  {
+    Logger::error("Failed to serialize database");
+    return {nullptr, 0};
+  }
+  return {std::shared_ptr<unsigned char []>(data, sqlite3_free), size};
+}
+
+inline void SqliteDB::swap(SqliteDB &other)
+{
+  std::swap(d_db, other.d_db);
+  std::swap(d_vfs, other.d_vfs);
+  std::swap(d_stmt, other.d_stmt);
+  std::swap(d_stmtcache, other.d_stmtcache);
+  std::swap(d_stmtcacheindex, other.d_stmtcacheindex);
+  std::swap(d_stmtcachehits, other.d_stmtcachehits);
+  std::swap(d_stmtcachemisses, other.d_stmtcachemisses);
+  std::swap(d_name, other.d_name);
+  std::swap(d_data, other.d_data);
+  std::swap(d_snapshot, other.d_snapshot);
+  std::swap(d_readonly, other.d_readonly);
+  std::swap(d_ok, other.d_ok);
+  std::swap(d_tables, other.d_tables);
+  std::swap(d_columns, other.d_columns);
+  std::swap(d_previous_schema_version, other.d_previous_schema_version);
+}
+
 inline bool SqliteDB::exec(std::string const &q, QueryResults *results, bool verbose) const
 {
   return exec(q, std::vector<std::any>(), results, verbose);
@@ -325,30 +498,9 @@ inline bool SqliteDB::exec(std::string const &q, std::vector<std::any> const &pa
   if (verbose) [[unlikely]]
     Logger::message("Running query: \"", q, "\"");
 
-  // if we have no prepared statement OR
-  // if this query is not the prepared one -> we need to reprepare it...
-  if (!d_stmt || std::string_view(sqlite3_sql(d_stmt)) != q)
-  {
-    // destroy the old one (NOTE "Invoking sqlite3_finalize() on a NULL pointer is a harmless no-op.")
-    sqlite3_finalize(d_stmt);
-
-    // create new statement
-    if (sqlite3_prepare_v2(d_db, q.c_str(), -1, &d_stmt, nullptr) != SQLITE_OK) [[unlikely]]
-    {
-      Logger::error("During sqlite3_prepare_v2(): ", sqlite3_errmsg(d_db));
-      Logger::error_indent("-> Query: \"", q, "\"");
-      return false;
-    }
-  }
-  else // reuse existing prepared statement
-  {
-    if (sqlite3_reset(d_stmt) != SQLITE_OK) [[unlikely]]
-    {
-      Logger::error("During sqlite3_reset(): ", sqlite3_errmsg(d_db));
-      Logger::error_indent("-> Query: \"", q, "\"");
-      return false;
-    }
-  }
+  // get the (cached or newly) prepared statement
+  if (!(d_stmt = statement(q))) [[unlikely]]
+    return false;
 
   if (static_cast<int>(params.size()) != sqlite3_bind_parameter_count(d_stmt)) [[unlikely]]
   {
@@ -503,60 +655,7 @@ inline bool SqliteDB::exec(std::string const &q, std::vector<std::any> const &pa
     ++i;
   }
 
-  if (results)
-    results->clear();
-  int rc;
-  int row = 0;
-
-  while ((rc = sqlite3_step(d_stmt)) == SQLITE_ROW)
-  {
-    if (!results)
-      continue;
-
-    // if headers aren't set, set them
-    if (results->columns() == 0)
-      for (int c = 0; c < sqlite3_column_count(d_stmt); ++c)
-        results->emplaceHeader(sqlite3_column_name(d_stmt, c));
-
-    // set values
-    for (int c = 0; c < sqlite3_column_count(d_stmt); ++c)
-    {  // order empirically determined
-      if (sqlite3_column_type(d_stmt, c) == SQLITE_INTEGER)
-        results->emplaceValue(row, sqlite3_column_int64(d_stmt, c));
-      else if (sqlite3_column_type(d_stmt, c) == SQLITE_NULL)
-        results->emplaceValue(row, nullptr);
-      else if (sqlite3_column_type(d_stmt, c) == SQLITE_TEXT)
-        results->emplaceValue(row, std::string(reinterpret_cast<char const *>(sqlite3_column_text(d_stmt, c))));
-      else if (sqlite3_column_type(d_stmt, c) == SQLITE_BLOB)
-      {
-        size_t blobsize = sqlite3_column_bytes(d_stmt, c);
-        std::shared_ptr<unsigned char []> blob(new unsigned char[blobsize]);
-        if (blobsize) // if 0, sqlite3_column_blob() is nullptr, which is UB for memcpy
-          std::memcpy(blob.get(), reinterpret_cast<unsigned char const *>(sqlite3_column_blob(d_stmt, c)), blobsize);
-        results->emplaceValue(row, std::make_pair(blob, blobsize));
-      }
-      else if (sqlite3_column_type(d_stmt, c) == SQLITE_FLOAT)
-        results->emplaceValue(row, sqlite3_column_double(d_stmt, c));
-    }
-    ++row;
-  }
-  if (rc != SQLITE_DONE)
-  {
-    Logger::error("After sqlite3_step(): ", sqlite3_errmsg(d_db));
-    char *expanded_query = sqlite3_expanded_sql(d_stmt);
-    if (expanded_query)
-    {
-      Logger::error_indent("-> Query: \"", expanded_query, "\"");
-      sqlite3_free(expanded_query);
-    }
-
-    return false;
-  }
-
-  if (schemaVersionChanged()) [[unlikely]]
-    clearTableCache();
-
-  return true;
+  return stepStatement(results);
 }
 
 #if __cpp_lib_ranges >= 201911L
@@ -566,6 +665,29 @@ inline bool SqliteDB::exec(std::string const &q, std::vector<std::any> const &pa
 }
 #endif
 
+// Like exec(), but the parameters are bound by calling binder(sqlite3_stmt *), which returns an
+// sqlite3 result code. This lets callers bind their data directly (for example with SQLITE_STATIC)
+// without first converting it to a vector of std::any.
+template <typename Binder>
+inline bool SqliteDB::execWithBinder(std::string_view q, Binder const &binder, QueryResults *results, bool verbose) const
+{
+  if (verbose) [[unlikely]]
+    Logger::message("Running query: \"", q, "\"");
+
+  // get the (cached or newly) prepared statement
+  if (!(d_stmt = statement(q))) [[unlikely]]
+    return false;
+
+  if (binder(d_stmt) != SQLITE_OK) [[unlikely]]
+  {
+    Logger::error("During sqlite3_bind_*(): ", sqlite3_errmsg(d_db));
+    Logger::error_indent("-> Query: \"", q, "\"");
+    return false;
+  }
+
+  return stepStatement(results);
+}
+
 template <typename T>
 inline T SqliteDB::getSingleResultAs(std::string const &q, T defaultval) const
 {
@@ -815,6 +937,98 @@ inline void SqliteDB::freeMemory()
 inline void SqliteDB::QueryResults::emplaceHeader(std::string &&h)
 {
   d_headers.emplace_back(h);
+  d_columns.emplace_back(d_rows); // any rows already present are NULL in this column
+}
+
+inline void SqliteDB::QueryResults::appendRow(sqlite3_stmt *stmt)
+{
+  int columncount = sqlite3_column_count(stmt);
+
+  // if headers aren't set, set them
+  if (d_headers.empty())
+    for (int c = 0; c < columncount; ++c)
+      emplaceHeader(sqlite3_column_name(stmt, c));
+
+  // set values
+  for (int c = 0; c < columncount; ++c)
+  {
+    Cell &cell = d_columns[c].emplace_back();
+    switch (sqlite3_column_type(stmt, c))
+    {
+      case SQLITE_INTEGER:
+        cell.type = Cell::Type::INTEGER;
+        cell.i = sqlite3_column_int64(stmt, c);
+        break;
+      case SQLITE_TEXT:
+      {
+        // like std::string(char const *), text is cut at the first NUL
+        char const *text = reinterpret_cast<char const *>(sqlite3_column_text(stmt, c));
+        cell.type = Cell::Type::TEXT;
+        cell.size = std::strlen(text);
+        cell.ptr = allocate(cell.size + 1, &cell.chunk);
+        std::memcpy(cell.ptr, text, cell.size + 1);
+        break;
+      }
+      case SQLITE_BLOB:
+        cell.type = Cell::Type::BLOB;
+        cell.size = sqlite3_column_bytes(stmt, c);
+        cell.ptr = allocate(cell.size, &cell.chunk);
+        if (cell.size) // if 0, sqlite3_column_blob() is nullptr, which is UB for memcpy
+          std::memcpy(cell.ptr, sqlite3_column_blob(stmt, c), cell.size);
+        break;
+      case SQLITE_FLOAT:
+        cell.type = Cell::Type::FLOAT;
+        cell.d = sqlite3_column_double(stmt, c);
+        break;
+      default: // SQLITE_NULL, cell is value-initialized
+        break;
+    }
+  }
+  ++d_rows;
+}
+
+// returns space for text and blob data. Small values are packed into chunks (growing from
+// s_minchunksize to s_maxchunksize), large values get a chunk of their own. The chunks are
+// shared (not copied) between copies of the results, so a shared chunk is never appended to.
+inline unsigned char *SqliteDB::QueryResults::allocate(size_t size, unsigned int *chunk)
+{
+  if (size > s_maxchunksize / 4) [[unlikely]]
+  {
+    d_chunks.emplace_back(new unsigned char[size]);
+    *chunk = d_chunks.size() - 1;
+    return d_chunks.back().get();
+  }
+
+  if (d_chunks.empty() || d_chunkused + size > d_chunksize || d_chunks[d_currentchunk].use_count() > 1)
+  {
+    d_chunksize = std::max(size, d_chunksize ? std::min(d_chunksize * 2, s_maxchunksize) : s_minchunksize);
+    d_chunks.emplace_back(new unsigned char[d_chunksize]);
+    d_currentchunk = d_chunks.size() - 1;
+    d_chunkused = 0;
+  }
+
+  *chunk = d_currentchunk;
+  unsigned char *ret = d_chunks[d_currentchunk].get() + d_chunkused;
+  d_chunkused += size;
+  return ret;
+}
+
+template <typename T>
+inline constexpr SqliteDB::QueryResults::Cell::Type SqliteDB::QueryResults::cellType()
+{
+  if constexpr (std::is_same_v<T, long long int>)
+    return Cell::Type::INTEGER;
+  else if constexpr (std::is_same_v<T, std::nullptr_t>)
+    return Cell::Type::NUL;
+  else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>)
+    return Cell::Type::TEXT;
+  else if constexpr (std::is_same_v<T, std::pair<std::shared_ptr<unsigned char []>, size_t>> ||
+                     std::is_same_v<T, std::pair<unsigned char const *, size_t>>)
+    return Cell::Type::BLOB;
+  else if constexpr (std::is_same_v<T, double>)
+    return Cell::Type::FLOAT;
+  else
+    return Cell::Type::NONE;
 }
 
 inline std::string const &SqliteDB::QueryResults::header(size_t idx) const
@@ -832,17 +1046,21 @@ inline bool SqliteDB::QueryResults::hasColumn(std::string const &h) const
   return bepaald::contains(d_headers, h);
 }
 
-inline void SqliteDB::QueryResults::emplaceValue(size_t row, std::any &&a)
-{
-  if (d_values.size() < row + 1)
-    d_values.resize(row + 1);
-
-  d_values[row].emplace_back(a);
-}
-
-inline std::any const &SqliteDB::QueryResults::value(size_t row, size_t idx) const
+inline std::any SqliteDB::QueryResults::value(size_t row, size_t idx) const
 {
-  return d_values[row][idx];
+  switch (d_columns[idx][row].type)
+  {
+    case Cell::Type::INTEGER:
+      return getValueAs<long long int>(row, idx);
+    case Cell::Type::TEXT:
+      return getValueAs<std::string>(row, idx);
+    case Cell::Type::BLOB:
+      return getValueAs<std::pair<std::shared_ptr<unsigned char []>, size_t>>(row, idx);
+    case Cell::Type::FLOAT:
+      return getValueAs<double>(row, idx);
+    default:
+      return std::any{nullptr};
+  }
 }
 
 inline int SqliteDB::QueryResults::idxOfHeader(std::string const &header) const
@@ -861,7 +1079,7 @@ inline std::any SqliteDB::QueryResults::value(size_t row, std::string const &hea
     Logger::warning("Column `", header, "' not found in query results");
     return std::any{nullptr};
   }
-  return d_values[row][i];
+  return value(row, i);
 }
 
 template <typename T>
@@ -874,13 +1092,13 @@ inline T SqliteDB::QueryResults::getValueAs(size_t row, std::string const &heade
     return T{};
   }
 
-  if (d_values[row][i].type() != typeid(T)) [[unlikely]]
+  if (!valueHasType<T>(row, i)) [[unlikely]]
   {
     Logger::message("Getting value of field '", header, "' (idx ", i, "). Value as string: ", valueAsString(row, i));
-    Logger::message("Type: ", d_values[row][i].type().name(), " Requested type: ", typeid(T).name());
+    Logger::message("Type: ", value(row, i).type().name(), " Requested type: ", typeid(T).name());
     //return T{};
   }
-  return std::any_cast<T>(d_values[row][i]);
+  return getValueAs<T>(row, i);
 }
 
 template <typename T>
@@ -892,13 +1110,13 @@ inline bool SqliteDB::QueryResults::valueHasType(size_t row, std::string const &
     Logger::warning("Column `", header, "' not found in query results");
     return false;
   }
-  return (d_values[row][i].type() == typeid(T));
+  return valueHasType<T>(row, i);
 }
 
 template <typename T>
 inline bool SqliteDB::QueryResults::valueHasType(size_t row, size_t idx) const
 {
-  return (d_values[row][idx].type() == typeid(T));
+  return d_columns[idx][row].type == cellType<T>();
 }
 
 inline bool SqliteDB::QueryResults::isNull(size_t row, size_t idx) const
@@ -911,20 +1129,39 @@ inline bool SqliteDB::QueryResults::isNull(size_t row, std::string const &header
   return valueHasType<std::nullptr_t>(row, header);
 }
 
+// the pair<unsigned char const *, size_t> and string_view variants point into the results
+// and are only valid as long as the results are. The shared_ptr variant keeps the data alive.
 template <typename T>
 inline T SqliteDB::QueryResults::getValueAs(size_t row, size_t idx) const
 {
-  return std::any_cast<T>(d_values[row][idx]);
+  if (!valueHasType<T>(row, idx)) [[unlikely]]
+    throw std::bad_any_cast(); // same as any_cast on a value of the wrong type
+
+  Cell const &cell = d_columns[idx][row];
+  if constexpr (std::is_same_v<T, long long int>)
+    return cell.i;
+  else if constexpr (std::is_same_v<T, double>)
+    return cell.d;
+  else if constexpr (std::is_same_v<T, std::string>)
+    return std::string(reinterpret_cast<char const *>(cell.ptr), cell.size);
+  else if constexpr (std::is_same_v<T, std::string_view>)
+    return std::string_view(reinterpret_cast<char const *>(cell.ptr), cell.size);
+  else if constexpr (std::is_same_v<T, std::pair<std::shared_ptr<unsigned char []>, size_t>>)
+    return {std::shared_ptr<unsigned char []>(d_chunks[cell.chunk], cell.ptr), cell.size}; // aliasing constructor
+  else if constexpr (std::is_same_v<T, std::pair<unsigned char const *, size_t>>)
+    return {cell.ptr, cell.size};
+  else
+    return T{}; // nullptr_t (other types never pass valueHasType())
 }
 
 inline bool SqliteDB::QueryResults::empty() const
 {
-  return d_values.empty();
+  return d_rows == 0;
 }
 
 inline size_t SqliteDB::QueryResults::rows() const
 {
-  return d_values.size();
+  return d_rows;
 }
 
 inline size_t SqliteDB::QueryResults::columns() const
@@ -935,7 +1172,24 @@ inline size_t SqliteDB::QueryResults::columns() const
 inline void SqliteDB::QueryResults::clear()
 {
   d_headers.clear();
-  d_values.clear();
+  d_columns.clear();
+  d_rows = 0;
+
+  // results are often reused for a series of queries: hold on to the current chunk if
+  // nothing else refers to it
+  if (!d_chunks.empty() && d_chunks[d_currentchunk].use_count() == 1)
+  {
+    if (d_currentchunk != 0)
+      d_chunks.front() = std::move(d_chunks[d_currentchunk]);
+    d_chunks.resize(1);
+  }
+  else
+  {
+    d_chunks.clear();
+    d_chunksize = 0;
+  }
+  d_currentchunk = 0;
+  d_chunkused = 0;
 }
 
 inline std::string SqliteDB::QueryResults::operator()(size_t row, std::string const &header) const
@@ -951,17 +1205,21 @@ inline std::string SqliteDB::QueryResults::operator()(std::string const &header)
 template <typename T>
 inline bool SqliteDB::QueryResults::contains(T const &value) const
 {
-  for (unsigned int i = 0; i < d_values.size(); ++i)
-    for (unsigned int j = 0; j < d_values[i].size(); ++j)
-      if (d_values[i][j].type() == typeid(T))
-        if (std::any_cast<T>(d_values[i][j]) == value)
+  for (unsigned int i = 0; i < d_rows; ++i)
+    for (unsigned int j = 0; j < d_columns.size(); ++j)
+      if (valueHasType<T>(i, j))
+        if (getValueAs<T>(i, j) == value)
           return true;
   return false;
 }
 
-inline std::vector<std::any> const &SqliteDB::QueryResults::row(size_t row) const
+inline std::vector<std::any> SqliteDB::QueryResults::row(size_t row) const
 {
-  return d_values[row];
+  std::vector<std::any> ret;
+  ret.reserve(d_columns.size());
+  for (unsigned int i = 0; i < d_columns.size(); ++i)
+    ret.emplace_back(value(row, i));
+  return ret;
 }
 
 /*
@@ -992,39 +1250,305 @@ inline uint64_t SqliteDB::QueryResults::charCount(std::string const &utf8) const
 
 inline bool SqliteDB::QueryResults::removeRow(unsigned int idx)
 {
-  if (idx >= d_values.size())
+  if (idx >= d_rows)
     return false;
 
-  d_values.erase(d_values.begin() + idx);
+  for (auto &c : d_columns)
+    c.erase(c.begin() + idx);
+  --d_rows;
   return true;
 }
 
-inline SqliteDB::QueryResults SqliteDB::QueryResults::getRow(unsigned int idx)
+inline SqliteDB::QueryResults SqliteDB::QueryResults::getRow(unsigned int idx) const
+{
+  return getRows(idx, 1);
+}
+
+// returns a copy of rows [idx, idx + count)
+inline SqliteDB::QueryResults SqliteDB::QueryResults::getRows(unsigned int idx, unsigned int count) const
 {
   QueryResults tmp;
   tmp.d_headers = d_headers;
-  tmp.d_values.push_back(d_values[idx]);
+  for (auto const &c : d_columns)
+    tmp.d_columns.emplace_back(c.begin() + idx, c.begin() + idx + count);
+  tmp.d_chunks = d_chunks; // shared, tmp will not append to them (see allocate())
+  tmp.d_rows = count;
   return tmp;
 }
 
+inline SqliteDB::Cursor SqliteDB::cursor(std::string const &q) const
+{
+  return Cursor(d_db, q);
+}
+
+inline SqliteDB::Cursor::Cursor(sqlite3 *db, std::string const &q)
+  :
+  d_db(db),
+  d_stmt(nullptr),
+  d_ok(false)
+{
+  if (sqlite3_prepare_v2(d_db, q.c_str(), -1, &d_stmt, nullptr) != SQLITE_OK) [[unlikely]]
+  {
+    Logger::error("During sqlite3_prepare_v2(): ", sqlite3_errmsg(d_db));
+    Logger::error_indent("-> Query: \"", q, "\"");
+    return;
+  }
+  d_ok = true;
+}
+
+inline SqliteDB::Cursor::Cursor(Cursor &&other)
+  :
+  d_db(other.d_db),
+  d_stmt(other.d_stmt),
+  d_ok(other.d_ok)
+{
+  other.d_stmt = nullptr;
+  other.d_ok = false;
+}
+
+inline SqliteDB::Cursor::~Cursor()
+{
+  sqlite3_finalize(d_stmt);
+}
+
+// false if the query could not be prepared, or stepping failed
+inline bool SqliteDB::Cursor::ok() const
+{
+  return d_ok;
+}
+
+// moves to the next row, returns false if there are no more rows (or on error, see ok())
+inline bool SqliteDB::Cursor::step()
+{
+  if (!d_ok) [[unlikely]]
+    return false;
+
+  int rc = sqlite3_step(d_stmt);
+  if (rc == SQLITE_ROW) [[likely]]
+    return true;
+
+  if (rc != SQLITE_DONE) [[unlikely]]
+  {
+    Logger::error("After sqlite3_step(): ", sqlite3_errmsg(d_db));
+    Logger::error_indent("-> Query: \"", sqlite3_sql(d_stmt), "\"");
+    d_ok = false;
+  }
+  return false;
+}
+
+inline int SqliteDB::Cursor::columns() const
+{
+  return sqlite3_column_count(d_stmt);
+}
+
+inline std::string SqliteDB::Cursor::header(int idx) const
+{
+  return sqlite3_column_name(d_stmt, idx);
+}
+
+inline int SqliteDB::Cursor::idxOfHeader(std::string const &header) const
+{
+  for (int i = 0; i < columns(); ++i)
+    if (header == sqlite3_column_name(d_stmt, i))
+      return i;
+  return -1;
+}
+
+/*
+  Types are the same as for QueryResults: long long int, double, std::string,
+  std::nullptr_t and std::pair<std::shared_ptr<unsigned char []>, size_t>. For
+  getValueAs(), std::string_view and std::pair<unsigned char const *, size_t>
+  can be used to get the data without copying it, these are only valid until
+  the next call to step().
+*/
+template <typename T>
+inline bool SqliteDB::Cursor::valueHasType(int idx) const
+{
+  int type = sqlite3_column_type(d_stmt, idx);
+  if constexpr (std::is_same_v<T, long long int>)
+    return type == SQLITE_INTEGER;
+  else if constexpr (std::is_same_v<T, double>)
+    return type == SQLITE_FLOAT;
+  else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>)
+    return type == SQLITE_TEXT;
+  else if constexpr (std::is_same_v<T, std::nullptr_t>)
+    return type == SQLITE_NULL;
+  else if constexpr (std::is_same_v<T, std::pair<std::shared_ptr<unsigned char []>, size_t>> ||
+                     std::is_same_v<T, std::pair<unsigned char const *, size_t>>)
+    return type == SQLITE_BLOB;
+  else
+    return false;
+}
+
+inline bool SqliteDB::Cursor::isNull(int idx) const
+{
+  return valueHasType<std::nullptr_t>(idx);
+}
+
+template <typename T>
+inline T SqliteDB::Cursor::getValueAs(int idx) const
+{
+  if constexpr (std::is_same_v<T, long long int>)
+    return sqlite3_column_int64(d_stmt, idx);
+  else if constexpr (std::is_same_v<T, double>)
+    return sqlite3_column_double(d_stmt, idx);
+  else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>)
+  {
+    char const *text = reinterpret_cast<char const *>(sqlite3_column_text(d_stmt, idx));
+    return text ? T(text) : T(); // note: like QueryResults, text stops at first '\0'
+  }
+  else if constexpr (std::is_same_v<T, std::nullptr_t>)
+    return nullptr;
+  else if constexpr (std::is_same_v<T, std::pair<unsigned char const *, size_t>>)
+    return {reinterpret_cast<unsigned char const *>(sqlite3_column_blob(d_stmt, idx)), sqlite3_column_bytes(d_stmt, idx)};
+  else // std::pair<std::shared_ptr<unsigned char []>, size_t>
+  {
+    size_t blobsize = sqlite3_column_bytes(d_stmt, idx);
+    std::shared_ptr<unsigned char []> blob(new unsigned char[blobsize]);
+    if (blobsize) // if 0, sqlite3_column_blob() is nullptr, which is UB for memcpy
+      std::memcpy(blob.get(), reinterpret_cast<unsigned char const *>(sqlite3_column_blob(d_stmt, idx)), blobsize);
+    return {blob, blobsize};
+  }
+}
+
+// steps through d_stmt (prepared and bound), storing any output in results
+inline bool SqliteDB::stepStatement(QueryResults *results) const
+{
+  if (results)
+    results->clear();
+  int rc;
+  while ((rc = sqlite3_step(d_stmt)) == SQLITE_ROW)
+    if (results)
+      results->appendRow(d_stmt);
+
+  if (rc != SQLITE_DONE)
+  {
+    Logger::error("After sqlite3_step(): ", sqlite3_errmsg(d_db));
+    char *expanded_query = sqlite3_expanded_sql(d_stmt);
+    if (expanded_query)
+    {
+      Logger::error_indent("-> Query: \"", expanded_query, "\"");
+      sqlite3_free(expanded_query);
+    }
+
+    return false;
+  }
+
+  if (schemaVersionChanged()) [[unlikely]]
+  {
+    clearTableCache();
+    clearStatementCache();
+  }
+
+  return true;
+}
+
+/*
+  Returns a prepared statement for query q, ready to be bound and stepped. Statements
+  are kept in a small LRU cache, so code alternating between a few queries does not
+  need to prepare them over and over. Returns nullptr on error.
+*/
+inline sqlite3_stmt *SqliteDB::statement(std::string_view q, bool countstats) const
+{
+  auto it = d_stmtcacheindex.find(q);
+  if (it != d_stmtcacheindex.end()) [[likely]]
+  {
+    if (countstats)
+      ++d_stmtcachehits;
+
+    // move to front
+    d_stmtcache.splice(d_stmtcache.begin(), d_stmtcache, it->second);
+    sqlite3_stmt *stmt = it->second->second;
+
+    // note: sqlite3_reset() returns the error of the last sqlite3_step(), if that failed. The
+    // statement is reset either way. Bindings are cleared, they may point to data that is gone.
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return stmt;
+  }
+
+  if (countstats)
+    ++d_stmtcachemisses;
+
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(d_db, q.data(), q.size(), &stmt, nullptr) != SQLITE_OK) [[unlikely]]
+  {
+    Logger::error("During sqlite3_prepare_v2(): ", sqlite3_errmsg(d_db));
+    Logger::error_indent("-> Query: \"", q, "\"");
+    sqlite3_finalize(stmt);
+    return nullptr;
+  }
+
+  d_stmtcache.emplace_front(q, stmt);
+  d_stmtcacheindex.emplace(d_stmtcache.front().first, d_stmtcache.begin());
+
+  if (d_stmtcache.size() > s_maxcachedstatements)
+  {
+    d_stmtcacheindex.erase(d_stmtcache.back().first);
+    sqlite3_finalize(d_stmtcache.back().second);
+    d_stmtcache.pop_back();
+  }
+  return stmt;
+}
+
+inline void SqliteDB::clearStatementCache() const
+{
+  d_stmtcacheindex.clear();
+  for (auto const &[q, stmt] : d_stmtcache)
+    sqlite3_finalize(stmt);
+  d_stmtcache.clear();
+  d_stmt = nullptr;
+}
+
+// Savepoints are (nestable) transactions: only pages changed after the savepoint
+// is set are journaled, so undoing a set of changes does not require a full copy
+// of the database.
+inline bool SqliteDB::savepoint(std::string const &name) const
+{
+  return exec("SAVEPOINT " + name);
+}
+
+inline bool SqliteDB::releaseSavepoint(std::string const &name) const
+{
+  return exec("RELEASE SAVEPOINT " + name);
+}
+
+// undo all changes since savepoint 'name' was set, and remove it
+inline bool SqliteDB::rollbackToSavepoint(std::string const &name) const
+{
+  // make sure no (cached) statement is still pending
+  for (auto const &[q, stmt] : d_stmtcache)
+    sqlite3_reset(stmt);
+  return exec("ROLLBACK TO SAVEPOINT " + name) && releaseSavepoint(name);
+}
+
+// hits and misses of the statement cache
+inline std::pair<uint64_t, uint64_t> SqliteDB::statementCacheStats() const
+{
+  return {d_stmtcachehits, d_stmtcachemisses};
+}
+
 inline bool SqliteDB::schemaVersionChanged() const
 {
-  std::pair<bool, char *> sv_data = {false, d_previous_schema_version};
-  sqlite3_exec(d_db, "SELECT schema_version FROM PRAGMA_SCHEMA_VERSION;",
-               [](void *sv, int /*count*/, char **data, char **)
-               {
-                 // assert(count == 1);
-
-                 // compare the new schema_version (data[0]) with the old one (passed through sv_data.second)
-                 if (strncmp(reinterpret_cast<std::pair<bool, char *> *>(sv)->second, data[0], 11) != 0) [[unlikely]]
-                 {
-                   // if not equal, set changed and copy the new version
-                   reinterpret_cast<std::pair<bool, char *> *>(sv)->first = true;
-                   std::strncpy(reinterpret_cast<std::pair<bool, char *> *>(sv)->second, data[0], 11);
-                 }
-                 return 0;
-               }, &sv_data, nullptr);
-  return sv_data.first;
+  // this runs after every statement, it is not counted in the cache stats
+  sqlite3_stmt *stmt = statement("SELECT schema_version FROM PRAGMA_SCHEMA_VERSION;", false);
+  if (!stmt) [[unlikely]]
+    return false;
+
+  bool changed = false;
+  if (sqlite3_step(stmt) == SQLITE_ROW) [[likely]]
+  {
+    long long int schema_version = sqlite3_column_int64(stmt, 0);
+    // compare the new schema_version with the old one
+    if (schema_version != d_previous_schema_version) [[unlikely]]
+    {
+      // if not equal, set changed and store the new version
+      changed = true;
+      d_previous_schema_version = schema_version;
+    }
+  }
+  sqlite3_reset(stmt); // do not keep the statement active
+  return changed;
 }
 
 inline bool SqliteDB::registerCustoms() const
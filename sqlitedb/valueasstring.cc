@@ -30,9 +30,11 @@ std::string SqliteDB::QueryResults::valueAsString(size_t row, size_t column) con
   if (valueHasType<long long int>(row, column))
     return bepaald::toString(getValueAs<long long int>(row, column));
 
-  if (valueHasType<std::pair<std::shared_ptr<unsigned char []>, size_t>>(row, column))
-    return Base64::bytesToBase64String(getValueAs<std::pair<std::shared_ptr<unsigned char []>, size_t>>(row, column).first.get(),
-                                       getValueAs<std::pair<std::shared_ptr<unsigned char []>, size_t>>(row, column).second);
+  if (valueHasType<std::pair<unsigned char const *, size_t>>(row, column))
+  {
+    auto [data, size] = getValueAs<std::pair<unsigned char const *, size_t>>(row, column);
+    return Base64::bytesToBase64String(data, size);
+  }
 
   if (valueHasType<unsigned int>(row, column))
     return bepaald::toString(getValueAs<unsigned int>(row, column));
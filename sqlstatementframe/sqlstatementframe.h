@@ -25,6 +25,8 @@
 #include <memory>
 #include <vector>
 #include <any>
+#include <string_view>
+#include <sqlite3.h>
 
 #include "../common_be.h"
 #include "../common_bytes.h"
@@ -86,8 +88,9 @@ class SqlStatementFrame : public BackupFrame
   inline void addDoubleParameter(double val);
   inline void addParameterField(PARAMETER_FIELD field, std::string const &val);
 
-  inline std::string bindStatement() const;
+  inline std::string_view bindStatement() const;
   inline std::vector<std::any> parameters() const;
+  inline int bindParameters(sqlite3_stmt *stmt) const;
 
   // inline void setParameter(unsigned int idx, unsigned char *data, uint32_t length);
   // inline void getParameter(unsigned int idx) const;
@@ -580,12 +583,13 @@ inline void SqlStatementFrame::addParameterField(PARAMETER_FIELD field, std::str
 //   return 0;
 // }
 
-inline std::string SqlStatementFrame::bindStatement() const
+// note: points into this frame's data
+inline std::string_view SqlStatementFrame::bindStatement() const
 {
   for (auto const &p : d_framedata)
     if (std::get<0>(p) == FIELD::STATEMENT)
-      return bepaald::bytesToString(std::get<1>(p), std::get<2>(p));
-  return std::string();
+      return std::string_view(reinterpret_cast<char const *>(std::get<1>(p)), std::get<2>(p));
+  return std::string_view();
 }
 
 inline std::vector<std::any> SqlStatementFrame::parameters() const
@@ -644,6 +648,52 @@ inline std::vector<std::any> SqlStatementFrame::parameters() const
   return parameters;
 }
 
+// binds the parameters straight from the frame data, without copying (so the frame must outlive
+// the statement's execution). Binds the same values as exec() does with the output of parameters().
+inline int SqlStatementFrame::bindParameters(sqlite3_stmt *stmt) const
+{
+  if (static_cast<int>(d_parameterdata.size()) != sqlite3_bind_parameter_count(stmt)) [[unlikely]]
+    Logger::warning("Number of parameters (", d_parameterdata.size(), ") does not match number of placeholders in query (",
+                    sqlite3_bind_parameter_count(stmt), ")");
+
+  int idx = 0;
+  for (auto const &[field, data, size] : d_parameterdata)
+  {
+    int rc = SQLITE_OK;
+    // this switch is ordered by occurrence
+    switch (field)
+    {
+      case PARAMETER_FIELD::INT:
+        rc = sqlite3_bind_int64(stmt, ++idx, static_cast<long long int>(bytesToUint64(data, size)));
+        break;
+      case PARAMETER_FIELD::NULLPARAMETER:
+        rc = sqlite3_bind_null(stmt, ++idx);
+        break;
+      case PARAMETER_FIELD::STRING:
+        // parameters() binds a std::string's c_str(), so the text ends at the first NUL. Empty (null) data
+        // must still bind an empty string, not NULL.
+        if (size) [[likely]]
+          rc = sqlite3_bind_text(stmt, ++idx, reinterpret_cast<char const *>(data),
+                                 strnlen(reinterpret_cast<char const *>(data), size), SQLITE_STATIC);
+        else
+          rc = sqlite3_bind_text(stmt, ++idx, "", 0, SQLITE_STATIC);
+        break;
+      case PARAMETER_FIELD::BLOB:
+        if (size) [[likely]]
+          rc = sqlite3_bind_blob(stmt, ++idx, data, size, SQLITE_STATIC);
+        else // a zero-length blob, not NULL
+          rc = sqlite3_bind_zeroblob(stmt, ++idx, 0);
+        break;
+      case PARAMETER_FIELD::DOUBLE:
+        rc = sqlite3_bind_double(stmt, ++idx, *reinterpret_cast<double *>(data));
+        break;
+    }
+    if (rc != SQLITE_OK) [[unlikely]]
+      return rc;
+  }
+  return SQLITE_OK;
+}
+
 inline bool SqlStatementFrame::validate() const
 {
   if (d_framedata.empty())